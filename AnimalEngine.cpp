@@ -0,0 +1,138 @@
+#include "AnimalEngine.h"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include "AnimalMetadata.h"
+#include "AnimalTree.h"
+
+bool AnimalEngine::Cursor::atGuess() const { return path.back()->isLeaf(); }
+
+const std::string& AnimalEngine::Cursor::question() const { return tree->questionText(path.back()); }
+
+std::string AnimalEngine::Cursor::guess() const { return AnimalTree::candidateName(path.back(), candidate); }
+
+std::string AnimalEngine::Cursor::route() const {
+    std::string answers;
+    for (std::size_t i = 1; i < path.size(); ++i) answers.push_back(path[i] == path[i - 1]->yes.get() ? 'y' : 'n');
+    return answers;
+}
+
+AnimalEngine::AnimalEngine(std::size_t bucketCapacity) : tree(std::make_unique<AnimalTree>(bucketCapacity)) {}
+AnimalEngine::~AnimalEngine() = default;
+AnimalEngine::AnimalEngine(AnimalEngine&&) noexcept = default;
+AnimalEngine& AnimalEngine::operator=(AnimalEngine&&) noexcept = default;
+
+AnimalEngine::Cursor AnimalEngine::start() const {
+    Cursor cursor;
+    cursor.tree = tree.get();
+    cursor.path.push_back(tree->getRoot());
+    return cursor;
+}
+
+bool AnimalEngine::resume(const std::string& route, Cursor& cursor) const {
+    cursor = start();
+    for (char answer : route) {
+        const Node* current = cursor.path.back();
+        if (current->isLeaf() || (answer != 'y' && answer != 'n')) {
+            cursor = start();
+            return false;
+        }
+        cursor.answered.emplace_back(current->question, answer == 'y');
+        cursor.path.push_back(answer == 'y' ? current->yes.get() : current->no.get());
+    }
+    skipAnswered(cursor);
+    return true;
+}
+
+void AnimalEngine::skipAnswered(Cursor& cursor) const {
+    while (!cursor.atGuess()) {
+        const Node* current = cursor.path.back();
+        auto known = std::find_if(cursor.answered.begin(), cursor.answered.end(),
+                                  [current](const auto& entry) { return entry.first == current->question; });
+        if (known == cursor.answered.end()) return;
+        cursor.path.push_back(known->second ? current->yes.get() : current->no.get());
+    }
+}
+
+void AnimalEngine::answer(Cursor& cursor, bool yes) const {
+    if (cursor.atGuess()) throw std::logic_error("the game has already reached its guess");
+    const Node* current = cursor.path.back();
+    cursor.answered.emplace_back(current->question, yes);
+    cursor.path.push_back(yes ? current->yes.get() : current->no.get());
+    skipAnswered(cursor);
+}
+
+bool AnimalEngine::nextGuess(Cursor& cursor) const {
+    if (!cursor.atGuess()) throw std::logic_error("nextGuess() needs a game that has reached its guess");
+    if (cursor.candidate + 1 >= AnimalTree::candidateCount(cursor.path.back())) return false;
+    ++cursor.candidate;
+    return true;
+}
+
+void AnimalEngine::confirm(Cursor& cursor) {
+    if (!cursor.atGuess()) throw std::logic_error("confirm() needs a game that has reached its guess");
+    // the tree hands out mutable nodes, and the cursor only ever points into this engine's tree
+    cursor.candidate = AnimalTree::recordHit(const_cast<Node*>(cursor.path.back()), cursor.candidate);
+}
+
+std::vector<std::string> AnimalEngine::candidates(const Cursor& cursor) const {
+    std::vector<std::string> names;
+    if (cursor.atGuess()) AnimalTree::forEachCandidate(cursor.path.back(), [&names](const std::string& name) { names.push_back(name); });
+    return names;
+}
+
+bool AnimalEngine::remember(Cursor& cursor, const std::string& animal) {
+    if (!cursor.atGuess()) throw std::logic_error("remember() needs a game that has reached its guess");
+    Node* leaf = const_cast<Node*>(cursor.path.back());
+    if (!tree->remember(leaf, animal)) return false;
+    // the new animal has no hits yet, so it is guessed after the ones already there
+    cursor.candidate = AnimalTree::candidateCount(leaf) - 1;
+    return true;
+}
+
+void AnimalEngine::learn(Cursor& cursor, const std::string& animal, const std::string& question, bool animalIsYes, const std::vector<bool>& candidateIsYes) {
+    if (!cursor.atGuess()) throw std::logic_error("learn() needs a game that has reached its guess");
+    Node* leaf = const_cast<Node*>(cursor.path.back());
+    tree->learn(leaf, animal, question, animalIsYes, candidateIsYes);
+    cursor.path.push_back(animalIsYes ? leaf->yes.get() : leaf->no.get());
+    // candidates that answered like the new animal may have joined it in its leaf
+    cursor.candidate = 0;
+    while (cursor.guess() != animal) ++cursor.candidate;
+}
+
+std::vector<std::string> AnimalEngine::suggestQuestions(const Cursor& cursor, std::size_t limit) const {
+    std::vector<std::string> texts;
+    for (const auto& suggestion : tree->suggestQuestions(cursor.path, limit)) texts.push_back(tree->questions().question(suggestion.question));
+    return texts;
+}
+
+std::vector<std::string> AnimalEngine::animals() const {
+    std::vector<std::string> names;
+    tree->collectAnimals(tree->getRoot(), names);
+    return names;
+}
+
+AnimalEngine::Stats AnimalEngine::stats() const {
+    TreeStats shape = tree->stats();
+    return {shape.animals, shape.questions, shape.leaves, shape.maxDepth, shape.averageDepth};
+}
+
+bool AnimalEngine::findPath(const std::string& animal, std::vector<std::pair<std::string, bool>>& path) const {
+    std::vector<std::pair<const Node*, bool>> nodes;
+    path.clear();
+    if (!tree->findPath(animal, nodes)) return false;
+    for (const auto& [node, answer] : nodes) path.emplace_back(tree->questionText(node), answer);
+    return true;
+}
+
+void AnimalEngine::reset() { tree->resetToInitialState(); }
+
+void AnimalEngine::save(std::ostream& out) const { tree->save(out); }
+
+bool AnimalEngine::load(std::istream& in) { return tree->load(in); }
+
+void AnimalEngine::openMetadata(const std::string& path) { metadataFile = std::make_unique<MetadataFile>(MetadataFile::open(path)); }
+
+bool AnimalEngine::metadata(const std::string& animal, AnimalMetadata& out) const { return metadataFile && metadataFile->find(animal, out); }
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class AnimalTree;
+class MetadataFile;
+class Node;
+struct AnimalMetadata;
+
+/**
+ * @class AnimalEngine
+ * @brief the animal game as a library: traversal, guessing, learning, listing and statistics, with no input or output of its own
+ *
+ * A program embeds the engine and drives each game through a Cursor, so it can play any number of games in-process,
+ * from any source of answers, instead of running AnimalGame and reading its prompts
+ * The tree itself stays behind this class (it is built into the AnimalEngine library), so programs using the engine
+ * only depend on this header and do not need to be rebuilt when the tree's internals change
+ *
+ * An engine is not thread-safe; calls that change the tree (learn, reset, load) invalidate every cursor except the one passed to learn
+ */
+class AnimalEngine {
+public:
+    /**
+     * @class Cursor
+     * @brief where one game is: the questions answered so far, and either the next question or the animal the engine is about to guess
+     */
+    class Cursor {
+    public:
+        /**
+         * @brief true once the answers lead to an animal, which guess() names
+         */
+        bool atGuess() const;
+        /**
+         * @brief the question to ask next, only valid while atGuess() is false
+         */
+        const std::string& question() const;
+        /**
+         * @brief the animal the engine guesses, only valid once atGuess() is true
+         * When the leaf holds several candidates this is the one being guessed now, see AnimalEngine::nextGuess()
+         */
+        std::string guess() const;
+        /**
+         * @brief the number of questions answered so far, including ones the engine answered itself because they came up a second time
+         */
+        std::size_t depth() const { return path.size() - 1; }
+        /**
+         * @brief the answers that led from the first question to where the game is, as a string of y and n
+         */
+        std::string route() const;
+
+    private:
+        friend class AnimalEngine;
+        const AnimalTree* tree = nullptr;
+        std::vector<const Node*> path;
+        // which of the leaf's candidates is being guessed
+        std::size_t candidate = 0;
+        // answers given so far this game, by question id, so a question that appears again deeper in the tree is not asked twice
+        std::vector<std::pair<uint32_t, bool>> answered;
+    };
+
+    /**
+     * @struct Stats
+     * @brief the shape of the question tree
+     */
+    struct Stats {
+        std::size_t animals = 0;
+        std::size_t questions = 0;
+        std::size_t leaves = 0;
+        std::size_t maxDepth = 0;
+        double averageDepth = 0.0;
+    };
+
+    /**
+     * @brief starts with the initial two-animal tree
+     * @param bucketCapacity how many animals one guess may hold before a wrong guess makes the player add a question;
+     * with more than one, the engine guesses a leaf's animals in order of how often each was right
+     */
+    explicit AnimalEngine(std::size_t bucketCapacity = 1);
+    ~AnimalEngine();
+    AnimalEngine(AnimalEngine&&) noexcept;
+    AnimalEngine& operator=(AnimalEngine&&) noexcept;
+
+    /**
+     * @brief starts a new game at the first question
+     */
+    Cursor start() const;
+
+    /**
+     * @brief picks a game up at the place a cursor's route() named, in this engine or another one holding the same tree,
+     * such as another process serving the same players
+     * @return false if the route does not fit this tree, in which case the cursor is left at the first question
+     */
+    bool resume(const std::string& route, Cursor& cursor) const;
+
+    /**
+     * @brief answers the cursor's current question and moves on to the next one, or to the guess
+     * Questions already answered earlier in the same game are answered again the same way without stopping
+     */
+    void answer(Cursor& cursor, bool yes) const;
+
+    /**
+     * @brief moves a game on to the leaf's next candidate after a wrong guess
+     * @return false if every candidate has been guessed, in which case the player has to teach the engine with remember() or learn()
+     */
+    bool nextGuess(Cursor& cursor) const;
+
+    /**
+     * @brief records that the current guess was right, so the leaf guesses it earlier in later games if it has been right more often than the others
+     */
+    void confirm(Cursor& cursor);
+
+    /**
+     * @brief the animals the leaf guesses, in order; more than one only when the engine allows buckets
+     */
+    std::vector<std::string> candidates(const Cursor& cursor) const;
+
+    /**
+     * @brief teaches the engine the animal the player was thinking of without a question, by adding it to the leaf's candidates
+     * @return false if the leaf is full, in which case learn() has to be called with a question instead
+     */
+    bool remember(Cursor& cursor, const std::string& animal);
+
+    /**
+     * @brief teaches the engine the animal the player was thinking of, after a wrong guess
+     * @param cursor a game that has reached its guess; afterwards it points at the new animal
+     * @param animal the animal the player was thinking of
+     * @param question the question that tells it apart from the animal guessed
+     * @param animalIsYes the answer to that question for the new animal
+     * @param candidateIsYes empty, or the answer to the question for each of candidates(cursor), so a full leaf's animals can be split up by it;
+     * when empty they all stay together opposite the new animal
+     */
+    void learn(Cursor& cursor, const std::string& animal, const std::string& question, bool animalIsYes, const std::vector<bool>& candidateIsYes = {});
+
+    /**
+     * @brief questions the engine already knows that best split the animals near a game's guess, best first, for offering before learn()
+     */
+    std::vector<std::string> suggestQuestions(const Cursor& cursor, std::size_t limit) const;
+
+    /**
+     * @brief every animal the engine knows
+     */
+    std::vector<std::string> animals() const;
+
+    Stats stats() const;
+
+    /**
+     * @brief the questions and answers that lead to an animal
+     * @return false if the engine does not know the animal
+     */
+    bool findPath(const std::string& animal, std::vector<std::pair<std::string, bool>>& path) const;
+
+    /**
+     * @brief forgets everything learned and goes back to the initial tree
+     */
+    void reset();
+
+    /**
+     * @brief writes the tree in the format AnimalGame saves
+     */
+    void save(std::ostream& out) const;
+
+    /**
+     * @brief replaces the tree with one written by save()
+     * @return false if the stream did not hold a complete tree, in which case the current tree is kept
+     */
+    bool load(std::istream& in);
+
+    /**
+     * @brief looks animals up in a file written by MetadataFile::write() from now on, in place of any file opened before
+     * The file is only mapped here; each record is read when metadata() asks for it, and the tree itself never holds any of it
+     * @throws std::runtime_error if the file cannot be opened or is not a metadata file
+     */
+    void openMetadata(const std::string& path);
+
+    /**
+     * @brief what the metadata file says about an animal, for showing alongside a guess or a listing
+     * @return false if no metadata file is open or it has no record for the animal
+     */
+    bool metadata(const std::string& animal, AnimalMetadata& out) const;
+
+private:
+    std::unique_ptr<AnimalTree> tree;
+    std::unique_ptr<MetadataFile> metadataFile;
+
+    // follows questions the cursor has already answered until it reaches one it has not, or an animal
+    void skipAnswered(Cursor& cursor) const;
+};
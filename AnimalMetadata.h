@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+#include "MappedFile.h"
+
+/**
+ * @struct AnimalMetadata
+ * @brief what the game can show about an animal besides its name: a description, other names it goes by,
+ * and images, kept as references (paths or URLs) rather than the images themselves
+ */
+struct AnimalMetadata {
+    std::string description;
+    std::vector<std::string> aliases;
+    std::vector<std::string> images;
+};
+
+/**
+ * @class MetadataFile
+ * @brief a read-only file of AnimalMetadata records, memory-mapped and looked up one animal at a time
+ *
+ * The tree's leaves only hold names, so a traversal never touches this data; a record is read, and its pages faulted in,
+ * only when the game shows a guess or lists an animal. Opening the file maps it and checks the header, nothing more,
+ * so a file of any size opens in the same time
+ *
+ * An animal's id in the file is a 64-bit hash of its name. The QuestionPool's interned ids are numbered afresh each time a tree
+ * is built or loaded, while the name is the one thing every saved tree and this file agree on
+ *
+ * Layout: a Header, then the records, each a name, a description, the aliases and the images, every string as a 32-bit length
+ * followed by its bytes and every list as a 32-bit count followed by its strings; then, 8-byte aligned, the index of
+ * (id, record offset) pairs sorted by id, which lookups binary search
+ */
+class MetadataFile {
+public:
+    struct Header {
+        char magic[8] = {'A', 'N', 'I', 'M', 'E', 'T', 'A', '1'};
+        uint64_t records = 0;
+        uint64_t indexOffset = 0;
+        uint64_t reserved = 0;
+    };
+
+    struct IndexEntry {
+        uint64_t id;
+        uint64_t offset;
+    };
+
+private:
+    MappedFile mapping;
+    const IndexEntry* index = nullptr;
+    std::size_t records = 0;
+
+    explicit MetadataFile(MappedFile mapping) : mapping(std::move(mapping)) {}
+
+    static void putString(std::string& out, const std::string& text) {
+        uint32_t length = static_cast<uint32_t>(text.size());
+        out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        out += text;
+    }
+
+    /**
+     * @class Reader
+     * @brief walks one record, refusing to step outside the file
+     */
+    class Reader {
+        const char* at;
+        const char* end;
+
+    public:
+        Reader(const char* at, const char* end) : at(at), end(end) {}
+
+        uint32_t count() {
+            if (end - at < static_cast<std::ptrdiff_t>(sizeof(uint32_t))) throw std::runtime_error("metadata record runs past the end of the file");
+            uint32_t value;
+            std::memcpy(&value, at, sizeof(value));
+            at += sizeof(value);
+            return value;
+        }
+
+        std::string text() {
+            uint32_t length = count();
+            if (static_cast<std::size_t>(end - at) < length) throw std::runtime_error("metadata record runs past the end of the file");
+            std::string value(at, length);
+            at += length;
+            return value;
+        }
+    };
+
+public:
+    /**
+     * @brief the id an animal is filed under
+     */
+    static uint64_t idOf(const std::string& animal) {
+        uint64_t h = 14695981039346656037ull;
+        for (char c : animal) h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /**
+     * @brief writes a metadata file for the given animals, replacing any file at path
+     * @throws std::invalid_argument if an animal is listed twice
+     * @throws std::runtime_error if the file cannot be written
+     */
+    static void write(const std::string& path, const std::vector<std::pair<std::string, AnimalMetadata>>& animals) {
+        std::string body;
+        std::vector<IndexEntry> entries;
+        entries.reserve(animals.size());
+        for (const auto& [name, metadata] : animals) {
+            entries.push_back({idOf(name), sizeof(Header) + body.size()});
+            putString(body, name);
+            putString(body, metadata.description);
+            for (const auto* list : {&metadata.aliases, &metadata.images}) {
+                uint32_t count = static_cast<uint32_t>(list->size());
+                body.append(reinterpret_cast<const char*>(&count), sizeof(count));
+                for (const auto& text : *list) putString(body, text);
+            }
+        }
+        body.resize((body.size() + 7) & ~std::size_t{7}, '\0');
+        // ids that collide stay next to each other, and a lookup checks the name stored in each record
+        std::sort(entries.begin(), entries.end(), [](const IndexEntry& a, const IndexEntry& b) { return a.id < b.id; });
+        std::vector<std::string> names;
+        names.reserve(animals.size());
+        for (const auto& animal : animals) names.push_back(animal.first);
+        std::sort(names.begin(), names.end());
+        if (std::adjacent_find(names.begin(), names.end()) != names.end()) throw std::invalid_argument("an animal has two metadata records");
+
+        Header header;
+        header.records = entries.size();
+        header.indexOffset = sizeof(Header) + body.size();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(body.data(), static_cast<std::streamsize>(body.size()));
+        out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(IndexEntry)));
+        out.flush();
+        if (!out) throw std::runtime_error("cannot write metadata to " + path);
+    }
+
+    /**
+     * @brief maps a file written by write()
+     * @throws std::runtime_error if the file cannot be mapped or is not a metadata file
+     */
+    static MetadataFile open(const std::string& path) {
+        MetadataFile file(MappedFile::open(path, false));
+        const auto* header = file.mapping.as<const Header>();
+        if (file.mapping.size() < sizeof(Header) || std::memcmp(header->magic, Header{}.magic, sizeof(header->magic)) != 0 ||
+            header->indexOffset % 8 != 0 || header->indexOffset > file.mapping.size() ||
+            (file.mapping.size() - header->indexOffset) / sizeof(IndexEntry) < header->records) {
+            throw std::runtime_error(path + " is not an animal metadata file");
+        }
+        // lookups land anywhere in the file, so reading ahead of them only wastes the page cache
+        file.mapping.advise(MADV_RANDOM);
+        file.records = static_cast<std::size_t>(header->records);
+        file.index = reinterpret_cast<const IndexEntry*>(file.mapping.as<const char>() + header->indexOffset);
+        return file;
+    }
+
+    std::size_t size() const { return records; }
+
+    /**
+     * @brief reads an animal's record
+     * @return false if the file has no record for the animal
+     * @throws std::runtime_error if the record is damaged
+     */
+    bool find(const std::string& animal, AnimalMetadata& metadata) const {
+        uint64_t id = idOf(animal);
+        const IndexEntry* first = std::lower_bound(index, index + records, id, [](const IndexEntry& entry, uint64_t key) { return entry.id < key; });
+        const char* base = mapping.as<const char>();
+        const char* end = base + mapping.size();
+        for (const IndexEntry* entry = first; entry != index + records && entry->id == id; ++entry) {
+            if (entry->offset > mapping.size()) throw std::runtime_error("metadata index points past the end of the file");
+            Reader reader(base + entry->offset, end);
+            if (reader.text() != animal) continue;
+            metadata.description = reader.text();
+            for (auto* list : {&metadata.aliases, &metadata.images}) {
+                list->clear();
+                for (uint32_t i = 0, count = reader.count(); i < count; ++i) list->push_back(reader.text());
+            }
+            return true;
+        }
+        return false;
+    }
+};
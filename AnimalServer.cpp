@@ -0,0 +1,55 @@
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "AnimalServer.h"
+
+/**
+ * Serves the animal game on a Unix socket: AnimalServer SOCKET [TREE_FILE]
+ * If a server is already running on SOCKET, this process takes over its players and its tree instead, and the old process exits,
+ * so an upgrade is just starting the new binary with the same SOCKET
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: AnimalServer SOCKET [TREE_FILE]\n"
+                     "Starts a game server on SOCKET, playing TREE_FILE (saved by the game) or the initial tree.\n"
+                     "If a server is already running on SOCKET, takes over its players without dropping any.\n";
+        return EXIT_FAILURE;
+    }
+    std::signal(SIGINT, AnimalServer::requestStop);
+    std::signal(SIGTERM, AnimalServer::requestStop);
+    const std::string socketPath = argv[1];
+    try {
+        if (AnimalServer::running(socketPath)) {
+            AnimalServer server = AnimalServer::takeOver(socketPath);
+            const auto& stats = server.handoffStats();
+            std::cerr << "took over " << stats.sessions << " sessions: tree mapped in " << stats.treeMapMs << " ms while the old server kept playing, "
+                      << "then players waited " << stats.pauseMs << " ms\n";
+            server.run();
+            return EXIT_SUCCESS;
+        }
+        std::stringstream initial;
+        std::ifstream file;
+        std::istream* tree = &initial;
+        if (argc == 3) {
+            file.open(argv[2]);
+            if (!file) {
+                std::cerr << "cannot open " << argv[2] << "\n";
+                return EXIT_FAILURE;
+            }
+            tree = &file;
+        } else {
+            AnimalTree{}.save(initial);
+        }
+        AnimalServer server(socketPath, *tree);
+        std::cerr << "serving on " << socketPath << "\n";
+        if (server.run()) std::cerr << "handed every session over to the new server\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,438 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "AnimalTree.h"
+#include "FdPassing.h"
+#include "MappedFile.h"
+#include "TimingWheel.h"
+#include "TreeImage.h"
+
+/**
+ * @class AnimalServer
+ * @brief plays the animal game with many players at once over a Unix socket, one game per connection, and can hand every game over to a new process
+ *
+ * The protocol is a line at a time: the server sends a question ending in "(yes/no)", and the player answers "yes" or "no"
+ * Each session is nothing more than the answers given since the root, so it can be written down as a string of y and n and resumed anywhere
+ * the same tree is loaded. The server never learns, so the tree is the same for its whole life, and it plays from a TreeImage of it
+ * in a sealed memory file (memfd) rather than from an AnimalTree
+ *
+ * Upgrading: a new process started with takeOver() connects to the upgrade socket next to the game socket. The old process passes it the memory file,
+ * which the new process maps and plays from as it is, without loading anything, while the old one keeps serving. Once the new process is ready, the old one stops, passes
+ * the listening socket, the upgrade socket and every player's connection over with SCM_RIGHTS, along with each session's answers, any
+ * input it had read but not processed yet and any output the player has not taken yet, and exits. No connection is ever closed, and the listening socket keeps queueing new players meanwhile
+ *
+ * A player who sends no line for the idle timeout is disconnected. Each session has a timer in a TimingWheel, reset on every line,
+ * and poll() sleeps until the next timer comes due, so an idle server does not wake up at all
+ */
+class AnimalServer {
+public:
+    /**
+     * @struct HandoffStats
+     * @brief what taking over from another process cost, reported by the new process
+     */
+    struct HandoffStats {
+        std::size_t sessions = 0;
+        double treeMapMs = 0.0;
+        double pauseMs = 0.0;
+    };
+
+private:
+    struct Session {
+        std::string answers;
+        std::string input;
+        OutputBuffer output;
+        uint32_t at = 0;
+    };
+
+    static constexpr std::size_t kMaxLine = 256;
+    // a player this far behind on reading its replies is dropped rather than buffered for without end
+    static constexpr std::size_t kMaxOutput = std::size_t{1} << 20;
+    static constexpr uint64_t kDefaultIdleTimeout = 10 * 60 * 1000;
+
+    TreeImage tree;
+    std::string socketPath;
+    int listener = -1;
+    int upgradeListener = -1;
+    std::unordered_map<int, Session> sessions;
+    std::unique_ptr<FdChannel> successor;
+    bool handedOff = false;
+    HandoffStats stats;
+    // idle timers by session descriptor, in milliseconds since epoch
+    TimingWheel idle;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    uint64_t idleTimeout = kDefaultIdleTimeout;
+
+    static inline StopSignal stop;
+
+    AnimalServer() = default;
+
+    static std::string upgradePath(const std::string& socketPath) { return socketPath + ".upgrade"; }
+
+    std::string prompt(const Session& session) const {
+        if (tree.isLeaf(session.at)) return "Is it a " + std::string(tree.text(session.at)) + "? (yes/no)\n";
+        return std::string(tree.text(session.at)) + " (yes/no)\n";
+    }
+
+    /**
+     * @brief follows a session's answers from the root, or returns TreeImage::kNone if they do not fit this tree
+     */
+    uint32_t follow(const std::string& answers) const {
+        uint32_t current = tree.root();
+        for (char answer : answers) {
+            if (tree.isLeaf(current) || (answer != 'y' && answer != 'n')) return TreeImage::kNone;
+            current = tree.child(current, answer == 'y');
+        }
+        return current;
+    }
+
+    uint64_t tick() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    // tick() rounds down, so the line may have come up to a tick's worth later than it says; one more tick makes sure the whole timeout has passed
+    void touch(int fd) { idle.schedule(static_cast<TimingWheel::Id>(fd), tick() + idleTimeout + 1); }
+
+    // how long poll() may sleep: until the next idle timer comes due, or for good if there are no sessions
+    int pollTimeout() const {
+        uint64_t next = idle.nextExpiry();
+        if (next == UINT64_MAX) return -1;
+        uint64_t now = tick();
+        return next <= now ? 0 : static_cast<int>(std::min<uint64_t>(next - now, INT_MAX));
+    }
+
+    void startSession(int fd) {
+        touch(fd);
+        Session& session = sessions[fd];
+        session.at = tree.root();
+        session.output.append(prompt(session));
+        flushSession(fd, session);
+    }
+
+    void closeSession(int fd) {
+        idle.cancel(static_cast<TimingWheel::Id>(fd));
+        sessions.erase(fd);
+        ::close(fd);
+    }
+
+    // closes every session whose idle timer has run out since the last turn, all together
+    void dropIdle(std::vector<TimingWheel::Id>& expired) {
+        expired.clear();
+        idle.advance(tick(), [&expired](TimingWheel::Id fd) { expired.push_back(fd); });
+        for (TimingWheel::Id id : expired) {
+            int fd = static_cast<int>(id);
+            auto found = sessions.find(fd);
+            if (found == sessions.end()) continue;
+            found->second.output.append("You have been idle too long. Goodbye.\n");
+            found->second.output.flush(fd);
+            closeSession(fd);
+        }
+    }
+
+    // sends what the socket takes of a session's replies; a player that went away or stopped reading is closed
+    void flushSession(int fd, Session& session) {
+        if (!session.output.flush(fd) || session.output.size() > kMaxOutput) closeSession(fd);
+    }
+
+    // plays every complete line a session has received; returns false if the player quit
+    bool processInput(Session& session) {
+        std::size_t end;
+        while ((end = session.input.find('\n')) != std::string::npos) {
+            std::string line = session.input.substr(0, end);
+            session.input.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line == "quit") return false;
+            if (line != "yes" && line != "no") {
+                session.output.append("Please answer 'yes' or 'no'.\n" + prompt(session));
+                continue;
+            }
+            bool yes = line == "yes";
+            std::string reply;
+            if (tree.isLeaf(session.at)) {
+                reply = yes ? "Yay! I guessed it right!\n" : "I give up! Let's play again.\n";
+                session.at = tree.root();
+                session.answers.clear();
+            } else {
+                session.at = tree.child(session.at, yes);
+                session.answers.push_back(yes ? 'y' : 'n');
+            }
+            session.output.append(reply + prompt(session));
+        }
+        return session.input.size() <= kMaxLine;
+    }
+
+    void readSession(int fd) {
+        char buffer[4096];
+        ssize_t got = ::read(fd, buffer, sizeof(buffer));
+        if (got < 0 && (errno == EINTR || errno == EAGAIN)) return;
+        Session& session = sessions[fd];
+        if (got <= 0) {
+            closeSession(fd);
+            return;
+        }
+        if (std::find(buffer, buffer + got, '\n') != buffer + got) touch(fd);
+        session.input.append(buffer, static_cast<std::size_t>(got));
+        if (!processInput(session)) closeSession(fd);
+        else flushSession(fd, session);
+    }
+
+    /**
+     * @brief a new process has connected to the upgrade socket: give it the tree's memory file, and keep playing until it says it is ready
+     */
+    void offerTree() {
+        int fd = accept4(upgradeListener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (successor) {
+            // only one upgrade at a time
+            ::close(fd);
+            return;
+        }
+        successor = std::make_unique<FdChannel>(fd);
+        try {
+            successor->send("TREE", {tree.descriptor()});
+        } catch (const std::exception&) {
+            successor.reset();
+        }
+    }
+
+    /**
+     * @brief the new process has mapped the tree: pass it every descriptor and session, after which this process has nothing left to do
+     */
+    void handOver() {
+        std::string ready;
+        std::vector<int> fds;
+        try {
+            if (!successor->receive(ready, fds) || ready != "READY") {
+                successor.reset();
+                return;
+            }
+            successor->send("LISTENERS", {listener, upgradeListener});
+            std::string batch;
+            std::vector<int> batchFds;
+            auto flush = [&] {
+                successor->send("SESSIONS\n" + batch, batchFds);
+                batch.clear();
+                batchFds.clear();
+            };
+            for (const auto& [fd, session] : sessions) {
+                // a line of the answers and the sizes of the unsent output and the unprocessed input, then those bytes as they are
+                const std::string& output = session.output.queued();
+                batch += (session.answers.empty() ? "-" : session.answers) + " " + std::to_string(output.size()) + " " +
+                         std::to_string(session.input.size()) + "\n" + output + session.input;
+                batchFds.push_back(fd);
+                if (batchFds.size() == FdChannel::kMaxFds) flush();
+            }
+            if (!batchFds.empty()) flush();
+            successor->send("DONE");
+        } catch (const std::exception&) {
+            // the new process died halfway: it may hold duplicates of some sockets, but this process still owns them all, so carry on
+            successor.reset();
+            return;
+        }
+        for (const auto& [fd, session] : sessions) ::close(fd);
+        sessions.clear();
+        ::close(listener);
+        ::close(upgradeListener);
+        listener = upgradeListener = -1;
+        handedOff = true;
+    }
+
+public:
+    /**
+     * @brief starts serving a tree read from a stream (as written by AnimalTree::save()) on a new socket
+     * @throws std::runtime_error if the tree cannot be read or the sockets cannot be created
+     */
+    AnimalServer(const std::string& socketPath, std::istream& treeSource) : socketPath(socketPath) {
+        std::string image;
+        {
+            AnimalTree source;
+            if (!source.load(treeSource)) throw std::runtime_error("not a question tree");
+            image = TreeImage::build(source);
+        }
+        int treeFile = memfd_create("animal-tree", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (treeFile < 0) throw std::runtime_error(std::string("cannot create tree memory file: ") + std::strerror(errno));
+        // sealed so that no process holding it can change the image under another one playing from it
+        if (ftruncate(treeFile, static_cast<off_t>(image.size())) != 0 ||
+            pwrite(treeFile, image.data(), image.size(), 0) != static_cast<ssize_t>(image.size()) ||
+            fcntl(treeFile, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+            std::string reason = std::strerror(errno);
+            ::close(treeFile);
+            throw std::runtime_error("cannot fill tree memory file: " + reason);
+        }
+        tree = TreeImage::open(MappedFile::adopt(treeFile, false, "tree memory file"));
+        listener = listenUnix(socketPath);
+        upgradeListener = listenUnix(upgradePath(socketPath));
+    }
+
+    AnimalServer(AnimalServer&& other) noexcept
+        : tree(std::move(other.tree)), socketPath(std::move(other.socketPath)), listener(std::exchange(other.listener, -1)),
+          upgradeListener(std::exchange(other.upgradeListener, -1)),
+          sessions(std::move(other.sessions)), successor(std::move(other.successor)), handedOff(other.handedOff), stats(other.stats),
+          idle(std::move(other.idle)), epoch(other.epoch), idleTimeout(other.idleTimeout) {
+        other.sessions.clear();
+    }
+    AnimalServer(const AnimalServer&) = delete;
+    AnimalServer& operator=(const AnimalServer&) = delete;
+
+    ~AnimalServer() {
+        for (const auto& [fd, session] : sessions) ::close(fd);
+        if (listener >= 0) ::close(listener);
+        if (upgradeListener >= 0) ::close(upgradeListener);
+        if (!handedOff && listener >= 0) {
+            ::unlink(socketPath.c_str());
+            ::unlink(upgradePath(socketPath).c_str());
+        }
+    }
+
+    /**
+     * @brief true if a server is running at socketPath that a new process could take over from
+     */
+    static bool running(const std::string& socketPath) {
+        int fd = connectUnix(upgradePath(socketPath));
+        if (fd < 0) return false;
+        ::close(fd);
+        return true;
+    }
+
+    /**
+     * @brief takes over every player and the tree from the server running at socketPath, which exits once it has handed them over
+     * @throws std::runtime_error if there is no server to take over from or the handoff fails
+     */
+    static AnimalServer takeOver(const std::string& socketPath) {
+        AnimalServer server;
+        server.socketPath = socketPath;
+        int fd = connectUnix(upgradePath(socketPath));
+        if (fd < 0) throw std::runtime_error("no server to take over at " + socketPath);
+        FdChannel channel(fd);
+
+        std::string message;
+        std::vector<int> fds;
+        auto start = std::chrono::steady_clock::now();
+        if (!channel.receive(message, fds) || message != "TREE" || fds.size() != 1) throw std::runtime_error("expected the tree from the old server");
+        // the image is played from where it is mapped, so taking the tree over costs the same however large it is
+        server.tree = TreeImage::open(MappedFile::adopt(fds[0], false, "tree memory file"));
+        auto ready = std::chrono::steady_clock::now();
+        server.stats.treeMapMs = std::chrono::duration<double, std::milli>(ready - start).count();
+
+        // from here until DONE nobody is serving the players, so this part must stay short
+        channel.send("READY");
+        if (!channel.receive(message, fds) || message != "LISTENERS" || fds.size() != 2) throw std::runtime_error("expected the listening sockets");
+        server.listener = fds[0];
+        server.upgradeListener = fds[1];
+        while (channel.receive(message, fds) && message != "DONE") {
+            std::size_t at = message.find('\n') + 1;
+            for (int fd : fds) {
+                std::size_t end = message.find('\n', at);
+                std::istringstream line(message.substr(at, end - at));
+                std::string answers;
+                std::size_t outputSize = 0, inputSize = 0;
+                line >> answers >> outputSize >> inputSize;
+                if (end == std::string::npos || !line || message.size() - end - 1 < outputSize + inputSize) {
+                    throw std::runtime_error("the old server sent a damaged session");
+                }
+                at = end + 1 + outputSize + inputSize;
+                if (answers == "-") answers.clear();
+                uint32_t node = server.follow(answers);
+                if (node == TreeImage::kNone) {
+                    ::close(fd);
+                    continue;
+                }
+                setNonBlocking(fd);
+                Session& session = server.sessions[fd];
+                session.answers = answers;
+                session.output.append(message.substr(end + 1, outputSize));
+                session.input = message.substr(end + 1 + outputSize, inputSize);
+                session.at = node;
+                // idle timers start over in the new process
+                server.touch(fd);
+            }
+        }
+        if (message != "DONE") throw std::runtime_error("the old server stopped in the middle of the handoff");
+        server.stats.sessions = server.sessions.size();
+        server.stats.pauseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ready).count();
+        return server;
+    }
+
+    const HandoffStats& handoffStats() const { return stats; }
+    std::size_t sessionCount() const { return sessions.size(); }
+
+    /**
+     * @brief how long a player may go without sending a line before the session is closed; 10 minutes unless set
+     * Timers already running keep the timeout they were started with until the player's next line
+     */
+    void setIdleTimeout(std::chrono::milliseconds timeout) { idleTimeout = static_cast<uint64_t>(std::max<std::chrono::milliseconds::rep>(timeout.count(), 1)); }
+
+    /**
+     * @brief makes run() return at its next turn; safe to call from a signal handler
+     */
+    static void requestStop(int = 0) { stop.request(); }
+
+    /**
+     * @brief serves players until requestStop() is called or another process takes them over
+     * @return true if the players were handed over, false if the server was stopped
+     */
+    bool run() {
+        stop.arm();
+        std::vector<pollfd> polled;
+        std::vector<pollfd> ready;
+        std::vector<TimingWheel::Id> expired;
+        while (!handedOff && !stop.requested()) {
+            dropIdle(expired);
+            polled.clear();
+            polled.push_back({listener, POLLIN, 0});
+            polled.push_back({upgradeListener, POLLIN, 0});
+            polled.push_back({stop.descriptor(), POLLIN, 0});
+            // offerTree() below may set successor partway through this turn, so remember whether it was polled
+            bool successorPolled = successor != nullptr;
+            if (successorPolled) polled.push_back({successor->descriptor(), POLLIN, 0});
+            for (const auto& [fd, session] : sessions) polled.push_back({fd, static_cast<short>(POLLIN | (session.output.empty() ? 0 : POLLOUT)), 0});
+            // sleeps until a descriptor is ready, requestStop() writes to its pipe or the next idle timer comes due
+            int events = poll(polled.data(), polled.size(), pollTimeout());
+            if (events < 0 && errno != EINTR) throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+            if (events <= 0) continue;
+
+            if (polled[0].revents & POLLIN) {
+                int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+                if (fd >= 0) startSession(fd);
+            }
+            if (polled[1].revents & POLLIN) offerTree();
+            if (polled[2].revents) stop.drain();
+            std::size_t first = 3;
+            if (successorPolled) {
+                ++first;
+                if (polled[3].revents) {
+                    handOver();
+                    continue;
+                }
+            }
+            ready.clear();
+            for (std::size_t i = first; i < polled.size(); ++i) {
+                if (polled[i].revents) ready.push_back(polled[i]);
+            }
+            for (const pollfd& entry : ready) {
+                auto found = sessions.find(entry.fd);
+                if (found == sessions.end()) continue;
+                if (entry.revents & POLLOUT) flushSession(entry.fd, found->second);
+                if ((entry.revents & ~POLLOUT) && sessions.count(entry.fd)) readSession(entry.fd);
+            }
+        }
+        return handedOff;
+    }
+};
@@ -0,0 +1,558 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "QuestionPool.h"
+
+/**
+ * @class Animal
+ * @brief A virtual base animal class
+ * 
+ * This is a polymorphic base class to be built upon by the DynamicAnimal class
+ * it has a virtual constructor and destructor to ensure that any class that builds on it
+ * is able to provide its own constructor and not be limited by the base class.
+ * Another benefit of a purely virtual class means it cannot be ininitialized directly, solely through classes that build upon it.
+ */
+class Animal {
+public:
+    virtual ~Animal() = default;
+    virtual std::string getName() const = 0;
+};
+
+/**
+ * @class DynamicAnimal
+ * @brief a concrete implementation of the abstract Animal class. Stores names of animals as answers by the program for use in the game.
+ * 
+ * Encapsulates the name field as private to store the names of animals in a controlled manner
+ * Also overrides the getName method of the Animal base class to return the shared name. Since the name field is private, this is the only way to get the name field from outside of the class
+ */
+class DynamicAnimal : public Animal {
+private:
+    std::string name;
+public:
+    explicit DynamicAnimal(const std::string& name) : name(name) {}
+    std::string getName() const override { return name; }
+};
+
+/**
+ * @class AnimalBucket
+ * @brief a leaf's answer when it holds several candidate animals instead of one, ranked by how many games each was the right guess in
+ *
+ * The game guesses the candidates in rank order, so getName() is the one it tries first
+ * Leaves only turn into buckets when the tree allows more than one animal per leaf (see AnimalTree's bucketCapacity); a leaf with one animal stays a DynamicAnimal
+ */
+class AnimalBucket : public Animal {
+public:
+    struct Candidate {
+        std::string name;
+        uint32_t hits = 0;
+    };
+
+private:
+    std::vector<Candidate> candidates;
+
+public:
+    std::string getName() const override { return candidates.front().name; }
+
+    std::size_t size() const { return candidates.size(); }
+    const Candidate& operator[](std::size_t index) const { return candidates[index]; }
+
+    /**
+     * @brief adds a candidate behind every candidate with more hits than it
+     */
+    void add(const std::string& name, uint32_t hits = 0) {
+        auto after = std::find_if(candidates.begin(), candidates.end(), [hits](const Candidate& c) { return c.hits < hits; });
+        candidates.insert(after, {name, hits});
+    }
+    /**
+     * @brief counts a game the candidate was the right guess in, moving it ahead of the candidates it now outranks
+     * @return the candidate's new index
+     */
+    std::size_t hit(std::size_t index) {
+        ++candidates[index].hits;
+        for (; index > 0 && candidates[index - 1].hits < candidates[index].hits; --index) std::swap(candidates[index - 1], candidates[index]);
+        return index;
+    }
+    Candidate remove(std::size_t index) {
+        Candidate removed = std::move(candidates[index]);
+        candidates.erase(candidates.begin() + static_cast<std::ptrdiff_t>(index));
+        return removed;
+    }
+};
+
+/**
+ * @class Node
+ * @brief an implementation of the Node class, utilized to generate the question tree
+ * 
+ * Each question node holds the id of its question in the tree's QuestionPool, rather than its own copy of the text, so a question asked in many subtrees is stored once
+ * Each leaf holds the id of its row of answers in the same pool, which fits in the padding after the question id
+ * Each node has at most one yes child and at most one no child, corresponding to the responses to the question
+ * Once the user has traversed the tree to a leaf node, it will attempt to guess the animal
+ */
+class Node {
+public:
+    uint32_t question = 0;
+    uint32_t row = 0;
+    std::unique_ptr<Node> yes;
+    std::unique_ptr<Node> no;
+    std::unique_ptr<Animal> animal;
+
+    explicit Node(uint32_t question) : question(question) {}
+    Node(std::unique_ptr<Animal> animal) : animal(std::move(animal)) {}
+
+    bool isLeaf() const { return animal != nullptr; }
+};
+
+/**
+ * @struct TreeStats
+ * @brief a summary of the shape of a question tree, as reported by AnimalTree::stats()
+ */
+struct TreeStats {
+    std::size_t animals = 0;
+    std::size_t questions = 0;
+    std::size_t leaves = 0;
+    std::size_t maxDepth = 0;
+    double averageDepth = 0.0;
+};
+
+/**
+ * @class AnimalTree
+ * @brief This class is responsible for generating the question tree that forms the basis for the game's logic
+ * 
+ * Making this its own separate class instead of the part of the AnimalGame class enables us to use object lifetimes to reset the memory of the game
+ * Under Resource Acquisition Is Initialization, the lifetime of any instance of this class will be controlled by the AnimalGame class
+ * When an instance of the AnimalGame class is initialized, it will initialize an instance of this class as well
+ */
+class AnimalTree {
+private:
+    std::unique_ptr<Node> root;
+    QuestionPool pool;
+    std::size_t bucketCapacity = 1;
+
+    /**
+     * @brief refills the answers in a question pool from scratch by walking every path in a tree
+     * Used whenever the whole tree is replaced, learn() keeps the pool up to date for single animals
+     * Every leaf is given a fresh row, so the ids leaves held before are no longer valid
+     */
+    static void rebuildAnswers(Node* root, QuestionPool& pool) {
+        pool.clearAnswers();
+        struct Visit { Node* node; std::size_t depth; uint32_t parentQuestion; bool answer; };
+        std::vector<std::pair<uint32_t, bool>> path;
+        std::vector<Visit> pending{{root, 0, 0, false}};
+        while (!pending.empty()) {
+            Visit visit = pending.back();
+            pending.pop_back();
+            if (visit.depth > 0) {
+                path.resize(visit.depth - 1);
+                path.emplace_back(visit.parentQuestion, visit.answer);
+            }
+            if (visit.node->isLeaf()) {
+                visit.node->row = pool.addRow();
+                for (const auto& [question, answer] : path) pool.setAnswer(visit.node->row, question, answer);
+            } else {
+                pending.push_back({visit.node->no.get(), visit.depth + 1, visit.node->question, false});
+                pending.push_back({visit.node->yes.get(), visit.depth + 1, visit.node->question, true});
+            }
+        }
+    }
+
+    // adds a candidate to a leaf, turning its single animal into a bucket first if need be
+    static void addCandidate(Node* leaf, const std::string& name, uint32_t hits) {
+        auto* bucket = dynamic_cast<AnimalBucket*>(leaf->animal.get());
+        if (!bucket) {
+            auto created = std::make_unique<AnimalBucket>();
+            created->add(leaf->animal->getName());
+            bucket = created.get();
+            leaf->animal = std::move(created);
+        }
+        bucket->add(name, hits);
+    }
+
+    // turns a bucket left with a single candidate back into a plain animal, which is all a one-animal leaf needs
+    static void settle(Node* leaf) {
+        auto* bucket = dynamic_cast<AnimalBucket*>(leaf->animal.get());
+        if (bucket && bucket->size() == 1) leaf->animal = std::make_unique<DynamicAnimal>(bucket->getName());
+    }
+
+    // reads the candidate lines that follow a "B <count>" line written by save()
+    static std::unique_ptr<AnimalBucket> readBucket(std::istream& in, const std::string& countText) {
+        std::size_t count = 0;
+        auto [end, error] = std::from_chars(countText.data(), countText.data() + countText.size(), count);
+        if (error != std::errc() || end != countText.data() + countText.size() || count == 0) return nullptr;
+        auto bucket = std::make_unique<AnimalBucket>();
+        std::string line;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!std::getline(in, line) || line.size() < 2 || line[0] != 'C' || line[1] != ' ') return nullptr;
+            auto space = line.find(' ', 2);
+            uint32_t hits = 0;
+            if (space == std::string::npos) return nullptr;
+            auto [hitsEnd, hitsError] = std::from_chars(line.data() + 2, line.data() + space, hits);
+            if (hitsError != std::errc() || hitsEnd != line.data() + space) return nullptr;
+            bucket->add(line.substr(space + 1), hits);
+        }
+        return bucket;
+    }
+
+public:
+    /**
+     * @param bucketCapacity how many candidate animals a leaf may hold before a wrong guess has to add a question;
+     * 1 keeps the classic game, where every animal learned brings a question with it
+     */
+    explicit AnimalTree(std::size_t bucketCapacity = 1) : bucketCapacity(std::max<std::size_t>(bucketCapacity, 1)) {
+        resetToInitialState();
+    }
+
+    /**
+     * @brief is utilized with a clean root node to build the initial version of the tree for use in the game
+     * This function creates the unique state by re-assigning the root of the tree to a new unique pointer
+     * If there was a pre-existing question tree in use by the game, re-assigning the root of the tree will cause the old tree to no longer be owned by the instance of the AnimalGame class, marking it for garbage collection
+     * This function will then create the initial tree
+     */
+    void resetToInitialState() {
+        pool.clear();
+        root = std::make_unique<Node>(pool.questionId("Is your animal warm or cold blooded?"));
+        root->yes = std::make_unique<Node>(std::make_unique<DynamicAnimal>("Dog"));
+        root->no = std::make_unique<Node>(std::make_unique<DynamicAnimal>("Snake"));
+        rebuildAnswers(root.get(), pool);
+    }
+    /**
+     * @brief public method to allow access to the private root field
+     * The root field, pointing to the root node of the question tree, is private
+     * This getter method allows the AnimalGame to access the root node of the question tree, essential to causing the game to operate correctly
+     */
+    Node* getRoot() const {
+        return root.get();
+    }
+    /**
+     * @brief the most candidate animals one leaf may hold
+     */
+    std::size_t capacity() const { return bucketCapacity; }
+
+    /**
+     * @brief the leaf's animals as a bucket, or nullptr if it holds a single animal
+     */
+    static const AnimalBucket* bucketAt(const Node* leaf) { return dynamic_cast<const AnimalBucket*>(leaf->animal.get()); }
+    static std::size_t candidateCount(const Node* leaf) {
+        const AnimalBucket* bucket = bucketAt(leaf);
+        return bucket ? bucket->size() : 1;
+    }
+    /**
+     * @brief the name of a leaf's candidate, in the order the game guesses them
+     */
+    static std::string candidateName(const Node* leaf, std::size_t index) {
+        const AnimalBucket* bucket = bucketAt(leaf);
+        return bucket ? (*bucket)[index].name : leaf->animal->getName();
+    }
+    /**
+     * @brief calls visit with the name of every animal a leaf holds, in guessing order
+     */
+    template <typename Visit>
+    static void forEachCandidate(const Node* leaf, Visit visit) {
+        if (const AnimalBucket* bucket = bucketAt(leaf)) {
+            for (std::size_t i = 0; i < bucket->size(); ++i) visit((*bucket)[i].name);
+        } else {
+            visit(leaf->animal->getName());
+        }
+    }
+
+    /**
+     * @brief turns a leaf into a question node that separates a new animal from the one the leaf guessed
+     * The old animal moves into a new leaf on the opposite side of the question from the new animal
+     * When the leaf is a bucket, all of its candidates move with the first one, unless candidateIsYes says how each of them answers the question,
+     * in which case the ones that answer like the new animal join it in its leaf
+     * @param leaf the leaf node whose guess was wrong
+     * @param newAnimalName the name of the animal the player was thinking of
+     * @param newQuestion the question distinguishing the new animal from the old one
+     * @param newAnimalIsYes true if the answer to newQuestion is yes for the new animal
+     * @param candidateIsYes empty, or the answer to newQuestion for each of the leaf's candidates in guessing order
+     * @throws std::invalid_argument if candidateIsYes does not match the candidates or leaves none of them opposite the new animal
+     */
+    void learn(Node* leaf, const std::string& newAnimalName, const std::string& newQuestion, bool newAnimalIsYes,
+               const std::vector<bool>& candidateIsYes = {}) {
+        std::size_t candidates = candidateCount(leaf);
+        if (!candidateIsYes.empty() && (candidateIsYes.size() != candidates ||
+                                        std::find(candidateIsYes.begin(), candidateIsYes.end(), !newAnimalIsYes) == candidateIsYes.end())) {
+            throw std::invalid_argument("candidate answers must cover every candidate and leave one opposite the new animal");
+        }
+        uint32_t question = pool.questionId(newQuestion);
+        split(leaf, question, newAnimalName, newAnimalIsYes);
+        // the old leaf's row moves down with its animals, and the new leaf starts from a copy of it, since both share the path so far
+        Node* newLeaf = newAnimalIsYes ? leaf->yes.get() : leaf->no.get();
+        Node* oldLeaf = newAnimalIsYes ? leaf->no.get() : leaf->yes.get();
+        newLeaf->row = pool.copyRow(oldLeaf->row);
+        pool.setAnswer(oldLeaf->row, question, !newAnimalIsYes);
+        pool.setAnswer(newLeaf->row, question, newAnimalIsYes);
+        if (candidates == 1 || candidateIsYes.empty()) return;
+
+        auto* bucket = static_cast<AnimalBucket*>(oldLeaf->animal.get());
+        for (std::size_t i = candidates; i-- > 0;) {
+            if (candidateIsYes[i] != newAnimalIsYes) continue;
+            AnimalBucket::Candidate moved = bucket->remove(i);
+            addCandidate(newLeaf, moved.name, moved.hits);
+        }
+        settle(oldLeaf);
+    }
+    /**
+     * @brief adds the animal the player was thinking of to a leaf's bucket instead of asking for a question
+     * The new animal shares the leaf's row of answers, since the player's answers led to the same leaf
+     * @return false if the leaf already holds capacity() animals, in which case the caller has to learn() a question instead
+     */
+    bool remember(Node* leaf, const std::string& newAnimalName) {
+        if (candidateCount(leaf) >= bucketCapacity) return false;
+        addCandidate(leaf, newAnimalName, 0);
+        return true;
+    }
+    /**
+     * @brief counts a game won by guessing one of a leaf's candidates, which may move it up the guessing order
+     * @return the candidate's index afterwards
+     */
+    static std::size_t recordHit(Node* leaf, std::size_t candidate) {
+        auto* bucket = dynamic_cast<AnimalBucket*>(leaf->animal.get());
+        return bucket ? bucket->hit(candidate) : candidate;
+    }
+    /**
+     * @brief the part of learn() that reshapes the tree, without recording the new answers in the question pool
+     * Touches nothing but the leaf itself, so leaves in different subtrees can be split on different threads at once;
+     * call refreshAnswers() once afterwards to bring the pool up to date
+     * @param question the id of the distinguishing question, from internQuestion()
+     */
+    static void split(Node* leaf, uint32_t question, const std::string& newAnimalName, bool newAnimalIsYes) {
+        auto newAnimalNode = std::make_unique<Node>(std::make_unique<DynamicAnimal>(newAnimalName));
+        auto oldAnimalNode = std::make_unique<Node>(std::move(leaf->animal));
+        oldAnimalNode->row = leaf->row;
+        leaf->question = question;
+
+        if (newAnimalIsYes) {
+            leaf->yes = std::move(newAnimalNode);
+            leaf->no = std::move(oldAnimalNode);
+        } else {
+            leaf->yes = std::move(oldAnimalNode);
+            leaf->no = std::move(newAnimalNode);
+        }
+    }
+    /**
+     * @brief returns the id of a question, adding it to the tree's pool the first time it is seen
+     */
+    uint32_t internQuestion(const std::string& text) { return pool.questionId(text); }
+    /**
+     * @brief rebuilds every animal's answers from the tree, after leaves have been split directly with split()
+     */
+    void refreshAnswers() { rebuildAnswers(root.get(), pool); }
+    /**
+     * @brief traverses the question tree to collect all animals currently in memory
+     * This creates a full list of animals and works with the AnimalGame.listAnimals() function to display them to the user
+     */
+    void collectAnimals(const Node* current, std::vector<std::string>& animals) const {
+        if (!current) return;
+        if (current->isLeaf()) {
+            forEachCandidate(current, [&animals](const std::string& name) { animals.push_back(name); });
+        } else {
+            collectAnimals(current->yes.get(), animals);
+            collectAnimals(current->no.get(), animals);
+        }
+    }
+    /**
+     * @brief walks the whole tree to count animals and questions and measure how deep the leaves are
+     * The walk uses an explicit stack instead of recursion so a very deep tree cannot overflow the call stack
+     */
+    TreeStats stats() const {
+        TreeStats result;
+        std::size_t depthSum = 0;
+        std::vector<std::pair<const Node*, std::size_t>> pending{{root.get(), 0}};
+        while (!pending.empty()) {
+            auto [current, depth] = pending.back();
+            pending.pop_back();
+            if (current->isLeaf()) {
+                std::size_t candidates = candidateCount(current);
+                ++result.leaves;
+                result.animals += candidates;
+                depthSum += depth * candidates;
+                result.maxDepth = std::max(result.maxDepth, depth);
+            } else {
+                ++result.questions;
+                pending.emplace_back(current->no.get(), depth + 1);
+                pending.emplace_back(current->yes.get(), depth + 1);
+            }
+        }
+        if (result.animals) result.averageDepth = static_cast<double>(depthSum) / static_cast<double>(result.animals);
+        return result;
+    }
+    /**
+     * @brief finds the questions and answers that lead from the root to the named animal
+     * @param name the animal to look for
+     * @param path receives each question node on the way down, paired with true when the path follows its yes branch
+     * @return true if the animal is in the tree
+     */
+    bool findPath(const std::string& name, std::vector<std::pair<const Node*, bool>>& path) const {
+        path.clear();
+        struct Visit { const Node* node; const Node* parent; bool answer; std::size_t depth; };
+        std::vector<Visit> pending{{root.get(), nullptr, false, 0}};
+        while (!pending.empty()) {
+            Visit visit = pending.back();
+            pending.pop_back();
+            // cut the path back to the parent of this node, then record the answer that led here
+            if (visit.parent) {
+                path.resize(visit.depth - 1);
+                path.emplace_back(visit.parent, visit.answer);
+            }
+            if (visit.node->isLeaf()) {
+                bool found = false;
+                forEachCandidate(visit.node, [&](const std::string& candidate) { found = found || candidate == name; });
+                if (found) return true;
+                continue;
+            }
+            pending.push_back({visit.node->no.get(), visit.node, false, visit.depth + 1});
+            pending.push_back({visit.node->yes.get(), visit.node, true, visit.depth + 1});
+        }
+        path.clear();
+        return false;
+    }
+    /**
+     * @brief a hash of the shape of the tree and the text at every node, equal for two trees exactly when they would save() the same
+     * Question ids are not part of it, so trees built in different orders compare equal if they ended up the same
+     */
+    uint64_t structuralHash() const {
+        // 64-bit FNV-1a over the nodes in pre-order, each as its kind, its text and a terminating zero
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const std::string& text, char kind) {
+            hash = (hash ^ static_cast<unsigned char>(kind)) * 1099511628211ull;
+            for (char c : text) hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+            hash *= 1099511628211ull;
+        };
+        std::vector<const Node*> pending{root.get()};
+        while (!pending.empty()) {
+            const Node* current = pending.back();
+            pending.pop_back();
+            if (const AnimalBucket* bucket = bucketAt(current)) {
+                mix(std::to_string(bucket->size()), 'B');
+                for (std::size_t i = 0; i < bucket->size(); ++i) mix(std::to_string((*bucket)[i].hits) + ' ' + (*bucket)[i].name, 'C');
+            } else if (current->isLeaf()) {
+                mix(current->animal->getName(), 'A');
+            } else {
+                mix(pool.question(current->question), 'Q');
+                pending.push_back(current->no.get());
+                pending.push_back(current->yes.get());
+            }
+        }
+        return hash;
+    }
+    /**
+     * @brief writes the tree to a stream, one node per line in pre-order
+     * Questions are written as "Q <question>" and animals as "A <name>", after a header line naming the format version
+     * A bucket is written as "B <count>" followed by one "C <hits> <name>" line per candidate, in guessing order
+     */
+    void save(std::ostream& out) const {
+        out << kFormatHeader << '\n';
+        std::vector<const Node*> pending{root.get()};
+        while (!pending.empty()) {
+            const Node* current = pending.back();
+            pending.pop_back();
+            if (const AnimalBucket* bucket = bucketAt(current)) {
+                out << "B " << bucket->size() << '\n';
+                for (std::size_t i = 0; i < bucket->size(); ++i) out << "C " << (*bucket)[i].hits << ' ' << (*bucket)[i].name << '\n';
+            } else if (current->isLeaf()) {
+                out << "A " << current->animal->getName() << '\n';
+            } else {
+                out << "Q " << pool.question(current->question) << '\n';
+                pending.push_back(current->no.get());
+                pending.push_back(current->yes.get());
+            }
+        }
+    }
+    /**
+     * @brief replaces the tree with one previously written by save()
+     * Trees saved in the first version of the format, before buckets existed, load as well
+     * @return false if the stream did not hold a complete tree, in which case the current tree is left untouched
+     */
+    bool load(std::istream& in) {
+        std::string line;
+        if (!std::getline(in, line) || (line != kFormatHeader && line != kFirstFormatHeader)) return false;
+
+        std::unique_ptr<Node> newRoot;
+        QuestionPool newPool;
+        // question nodes still waiting for a child, paired with whether their yes child has been read already
+        std::vector<std::pair<Node*, bool>> open;
+        while ((!newRoot || !open.empty()) && std::getline(in, line)) {
+            if (line.size() < 2 || line[1] != ' ') return false;
+            std::string text = line.substr(2);
+            std::unique_ptr<Node> node;
+            if (line[0] == 'Q') {
+                node = std::make_unique<Node>(newPool.questionId(text));
+            } else if (line[0] == 'A') {
+                node = std::make_unique<Node>(std::make_unique<DynamicAnimal>(text));
+            } else if (line[0] == 'B') {
+                auto bucket = readBucket(in, text);
+                if (!bucket) return false;
+                node = std::make_unique<Node>(std::move(bucket));
+            } else {
+                return false;
+            }
+            Node* created = node.get();
+            if (!newRoot) {
+                newRoot = std::move(node);
+            } else if (!open.back().second) {
+                open.back().first->yes = std::move(node);
+                open.back().second = true;
+            } else {
+                open.back().first->no = std::move(node);
+                open.pop_back();
+            }
+            if (!created->isLeaf()) open.emplace_back(created, false);
+        }
+        if (!newRoot || !open.empty()) return false;
+        rebuildAnswers(newRoot.get(), newPool);
+        root = std::move(newRoot);
+        pool = std::move(newPool);
+        return true;
+    }
+
+    /**
+     * @brief suggests questions the game already knows that best split the animals near a leaf
+     * The animals considered are those below the node kSuggestionLevels questions above the leaf (or the root, if the leaf is shallower)
+     * Questions already asked on the path are never suggested, since every animal in that part of the tree shares their answer
+     * @param path the nodes visited from the root down to the leaf, inclusive
+     * @param limit the largest number of suggestions to return
+     */
+    std::vector<QuestionPool::Suggestion> suggestQuestions(const std::vector<const Node*>& path, std::size_t limit) const {
+        std::size_t scope = path.size() > kSuggestionLevels + 1 ? path.size() - 1 - kSuggestionLevels : 0;
+
+        std::vector<QuestionPool::Group> groups;
+        std::vector<const Node*> pending{path[scope]};
+        while (!pending.empty()) {
+            const Node* current = pending.back();
+            pending.pop_back();
+            if (current->isLeaf()) {
+                groups.push_back({current->row, static_cast<uint32_t>(candidateCount(current))});
+            } else {
+                pending.push_back(current->no.get());
+                pending.push_back(current->yes.get());
+            }
+        }
+
+        std::vector<uint32_t> asked;
+        for (const Node* node : path) {
+            if (!node->isLeaf()) asked.push_back(node->question);
+        }
+        return pool.suggest(groups, asked, limit);
+    }
+
+    const QuestionPool& questions() const { return pool; }
+
+    /**
+     * @brief returns the text of the question asked at a question node
+     */
+    const std::string& questionText(const Node* node) const { return pool.question(node->question); }
+
+    static constexpr std::size_t kSuggestionLevels = 3;
+    static constexpr const char* kFormatHeader = "ANIMALTREE 2";
+    static constexpr const char* kFirstFormatHeader = "ANIMALTREE 1";
+};
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AnimalTree.h"
+#include "PerfCounters.h"
+
+/**
+ * @brief walks from the root to a leaf picking yes or no at random
+ */
+static Node* randomLeaf(const AnimalTree& tree, std::mt19937& rng, std::vector<const Node*>* path = nullptr) {
+    Node* current = tree.getRoot();
+    if (path) path->assign(1, current);
+    while (!current->isLeaf()) {
+        current = (rng() & 1) ? current->yes.get() : current->no.get();
+        if (path) path->push_back(current);
+    }
+    return current;
+}
+
+/**
+ * @brief times one benchmark case and prints its wall time per operation next to its hardware counters
+ * @param operations the number of operations the case performs, used to report nanoseconds per operation
+ */
+template <typename Body>
+static void runCase(const std::string& label, uint64_t operations, Body body) {
+    PerfCounters counters;
+    auto start = std::chrono::steady_clock::now();
+    counters.start();
+    body();
+    counters.stop();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << label << ": " << operations << " ops, " << elapsed / static_cast<double>(operations) << " ns/op\n";
+    counters.print(std::cout);
+}
+
+static bool sameSuggestions(const std::vector<QuestionPool::Suggestion>& a, const std::vector<QuestionPool::Suggestion>& b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (a[i].question != b[i].question || a[i].score != b[i].score) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief learns the same animal name at two leaves and checks the first leaf keeps its own answers
+ * With four animals split evenly by the two new questions, each question scores exactly 0.5 from the root
+ */
+static int checkDuplicateNames() {
+    AnimalTree tree;
+    tree.learn(tree.getRoot()->yes.get(), "Cat", "Does it purr?", true);
+    tree.learn(tree.getRoot()->no.get(), "Cat", "Is it a cartoon?", true);
+    auto suggestions = tree.suggestQuestions({tree.getRoot()}, 3);
+    bool even = suggestions.size() == 2 && suggestions[0].score == 0.5 && suggestions[1].score == 0.5;
+    std::cout << "same name at two leaves: " << (even ? "each leaf kept its own answers" : "answers were shared between the leaves") << '\n';
+    return even ? 0 : 1;
+}
+
+int main() {
+    constexpr int kAnimals = 200000;
+    constexpr int kWalks = 1000000;
+    constexpr int kLists = 20;
+    constexpr int kSuggestions = 100000;
+    constexpr int kRootSuggestions = 20;
+    constexpr int kConcurrentPaths = 2000;
+    constexpr int kSuggestThreads = 4;
+    // questions are drawn from a fixed vocabulary so the same question appears in many subtrees, as it does in a real game
+    constexpr int kQuestionTexts = 1024;
+
+    int problems = checkDuplicateNames();
+    AnimalTree tree;
+    std::mt19937 rng(42);
+
+    runCase("learn", kAnimals, [&] {
+        for (int i = 0; i < kAnimals; ++i) {
+            tree.learn(randomLeaf(tree, rng), "Animal " + std::to_string(i), "Question " + std::to_string(i % kQuestionTexts) + "?", rng() & 1);
+        }
+    });
+
+    uint64_t steps = 0;
+    runCase("traversal", kWalks, [&] {
+        for (int i = 0; i < kWalks; ++i) {
+            Node* current = tree.getRoot();
+            while (!current->isLeaf()) {
+                current = (rng() & 1) ? current->yes.get() : current->no.get();
+                ++steps;
+            }
+        }
+    });
+    std::cout << "  average depth " << static_cast<double>(steps) / kWalks << '\n';
+
+    runCase("list", kLists, [&] {
+        for (int i = 0; i < kLists; ++i) {
+            std::vector<std::string> animals;
+            tree.collectAnimals(tree.getRoot(), animals);
+            if (animals.size() != kAnimals + 2) std::cerr << "unexpected animal count " << animals.size() << '\n';
+        }
+    });
+
+    std::size_t suggested = 0;
+    runCase("suggest near leaf", kSuggestions, [&] {
+        std::vector<const Node*> path;
+        for (int i = 0; i < kSuggestions; ++i) {
+            randomLeaf(tree, rng, &path);
+            suggested += tree.suggestQuestions(path, 3).size();
+        }
+    });
+    std::cout << "  average suggestions " << static_cast<double>(suggested) / kSuggestions << '\n';
+
+    runCase("suggest whole tree", kRootSuggestions, [&] {
+        std::vector<const Node*> path{tree.getRoot()};
+        for (int i = 0; i < kRootSuggestions; ++i) {
+            suggested += tree.suggestQuestions(path, 3).size();
+        }
+    });
+
+    // suggestQuestions() is const, so several threads may ask at once and must each get what one thread alone would
+    std::vector<std::vector<const Node*>> paths(kConcurrentPaths);
+    std::vector<std::vector<QuestionPool::Suggestion>> expected;
+    for (auto& path : paths) {
+        randomLeaf(tree, rng, &path);
+        // stop a few questions short of the leaf, so the threads scan subtrees of different sizes
+        path.resize(std::max<std::size_t>(1, path.size() - rng() % 4));
+        expected.push_back(tree.suggestQuestions(path, 3));
+    }
+    std::vector<int> mismatches(kSuggestThreads, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kSuggestThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < kConcurrentPaths; ++i) mismatches[t] += !sameSuggestions(tree.suggestQuestions(paths[i], 3), expected[i]);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    int mismatched = 0;
+    for (int count : mismatches) mismatched += count;
+    std::cout << "suggest on " << kSuggestThreads << " threads at once: " << mismatched << " of " << kSuggestThreads * kConcurrentPaths
+              << " answers differed from one thread's\n";
+    problems += mismatched;
+    return problems ? EXIT_FAILURE : EXIT_SUCCESS;
+}
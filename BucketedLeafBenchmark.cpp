@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AnimalEngine.h"
+#include "PerfCounters.h"
+
+// every allocation in the program is counted, so the heap an engine holds can be read off before and after building it
+// (the bytes requested, not counting the allocator's own headers and rounding)
+static std::size_t liveBytes = 0;
+
+void* operator new(std::size_t size) {
+    auto* block = static_cast<std::max_align_t*>(std::malloc(size + sizeof(std::max_align_t)));
+    if (!block) throw std::bad_alloc();
+    *reinterpret_cast<std::size_t*>(block) = size;
+    liveBytes += size;
+    return block + 1;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer) return;
+    auto* block = static_cast<std::max_align_t*>(pointer) - 1;
+    liveBytes -= *reinterpret_cast<std::size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept { operator delete(pointer); }
+
+static constexpr int kAnimals = 5000;
+static constexpr int kQuestions = 256;
+static constexpr int kGames = 400000;
+
+/**
+ * @struct World
+ * @brief the simulated players' knowledge: every animal's true answer to every question, and how often players think of each animal
+ * Animal 0 and 1 are the engine's starting Dog and Snake, and question 0 is its starting question, so the first games need no special case
+ */
+struct World {
+    std::vector<std::bitset<kQuestions>> traits;
+    std::vector<std::string> names;
+    std::vector<std::string> questions;
+    std::unordered_map<std::string, int> animalIndex;
+    std::unordered_map<std::string, int> questionIndex;
+    std::vector<double> popularity;  // cumulative, Zipf-distributed
+
+    World() {
+        std::mt19937 rng(96);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::vector<double> bias(kQuestions);
+        for (double& p : bias) p = 0.1 + 0.8 * unit(rng);
+        questions.push_back("Is your animal warm or cold blooded?");
+        for (int q = 1; q < kQuestions; ++q) questions.push_back("Trait " + std::to_string(q) + "?");
+        names = {"Dog", "Snake"};
+        for (int a = 2; a < kAnimals; ++a) names.push_back("Animal " + std::to_string(a));
+        traits.resize(kAnimals);
+        for (int a = 0; a < kAnimals; ++a) {
+            for (int q = 0; q < kQuestions; ++q) traits[a][q] = unit(rng) < bias[q];
+        }
+        traits[0][0] = true;
+        traits[1][0] = false;
+        for (int a = 0; a < kAnimals; ++a) animalIndex[names[a]] = a;
+        for (int q = 0; q < kQuestions; ++q) questionIndex[questions[q]] = q;
+
+        // players think of popular animals far more often than rare ones, which is what ranking a leaf's candidates by hits exploits
+        std::vector<int> rank(kAnimals);
+        for (int a = 0; a < kAnimals; ++a) rank[a] = a;
+        std::shuffle(rank.begin(), rank.end(), rng);
+        double total = 0.0;
+        popularity.resize(kAnimals);
+        for (int a = 0; a < kAnimals; ++a) popularity[a] = total += 1.0 / (1.0 + rank[a]);
+        for (double& p : popularity) p /= total;
+    }
+
+    int pick(std::mt19937& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return static_cast<int>(std::lower_bound(popularity.begin(), popularity.end(), u) - popularity.begin()) % kAnimals;
+    }
+};
+
+/**
+ * @struct Tally
+ * @brief what the players of a run of games went through
+ */
+struct Tally {
+    std::size_t games = 0, questions = 0, guesses = 0, learned = 0, added = 0;
+
+    void print(std::ostream& out) const {
+        double n = static_cast<double>(games);
+        out << static_cast<double>(questions) / n << " questions + " << static_cast<double>(guesses) / n << " guesses per game, "
+            << 100.0 * static_cast<double>(learned) / n << "% of games taught a new animal";
+    }
+};
+
+/**
+ * @brief plays one game with a truthful player thinking of animal, teaching the engine the animal if it does not guess it
+ * A full leaf is split by a question the player's animal and the leaf's first candidate answer differently, with every candidate sorted by its own answer
+ * @return false if the engine's guesses stopped making sense (a known animal not guessed at the end of its own answers)
+ */
+static bool playGame(AnimalEngine& engine, const World& world, int animal, std::mt19937& rng, Tally& tally) {
+    const auto& truth = world.traits[animal];
+    AnimalEngine::Cursor cursor = engine.start();
+    ++tally.games;
+    while (!cursor.atGuess()) {
+        engine.answer(cursor, truth[world.questionIndex.at(cursor.question())]);
+        ++tally.questions;
+    }
+    int first = world.animalIndex.at(cursor.guess());
+    do {
+        ++tally.guesses;
+        if (cursor.guess() == world.names[animal]) {
+            engine.confirm(cursor);
+            return true;
+        }
+    } while (engine.nextGuess(cursor));
+
+    ++tally.learned;
+    if (engine.remember(cursor, world.names[animal])) {
+        ++tally.added;
+        return true;
+    }
+    const auto& other = world.traits[first];
+    int start = static_cast<int>(rng() % kQuestions);
+    for (int k = 0; k < kQuestions; ++k) {
+        int q = (start + k) % kQuestions;
+        if (truth[q] == other[q]) continue;
+        std::vector<bool> candidateIsYes;
+        for (const auto& name : engine.candidates(cursor)) candidateIsYes.push_back(world.traits[world.animalIndex.at(name)][q]);
+        engine.learn(cursor, world.names[animal], world.questions[q], truth[q], candidateIsYes);
+        return cursor.atGuess() && cursor.guess() == world.names[animal];
+    }
+    return false;  // two animals with identical answers to every question, which 256 random traits make vanishingly unlikely
+}
+
+/**
+ * @brief plays kGames games against an engine holding up to capacity animals per leaf and reports cost per game and memory per animal
+ * @return the number of problems found
+ */
+static int runCase(const World& world, std::size_t capacity) {
+    std::size_t before = liveBytes;
+    int problems = 0;
+    {
+        AnimalEngine engine(capacity);
+        std::mt19937 rng(7);
+        Tally early, late;
+        PerfCounters counters;
+        auto start = std::chrono::steady_clock::now();
+        counters.start();
+        for (int game = 0; game < kGames; ++game) {
+            Tally& tally = game >= kGames * 3 / 4 ? late : early;
+            problems += !playGame(engine, world, world.pick(rng), rng, tally);
+        }
+        counters.stop();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::size_t heap = liveBytes - before;
+
+        AnimalEngine::Stats stats = engine.stats();
+        std::cout << "up to " << capacity << " animal(s) per leaf: " << stats.animals << " animals in " << stats.leaves << " leaves, "
+                  << stats.questions << " questions, " << static_cast<double>(stats.questions + stats.leaves) / static_cast<double>(stats.animals)
+                  << " nodes and " << static_cast<double>(heap) / static_cast<double>(stats.animals) << " heap bytes per animal, average depth "
+                  << stats.averageDepth << "\n  last quarter of games: ";
+        late.print(std::cout);
+        std::cout << "\n  " << seconds * 1e9 / kGames << " ns per game; ";
+        counters.print(std::cout);
+
+        // every animal learned is guessed by a game that gives its own answers, within its leaf's candidates, and appears once
+        auto known = engine.animals();
+        std::sort(known.begin(), known.end());
+        problems += std::adjacent_find(known.begin(), known.end()) != known.end();
+        for (const auto& name : known) {
+            Tally check;
+            problems += !playGame(engine, world, world.animalIndex.at(name), rng, check) || check.learned != 0 || check.guesses > capacity;
+        }
+        problems += engine.animals().size() != known.size();
+
+        // a tree with buckets survives a save and load unchanged
+        std::stringstream saved, resaved;
+        engine.save(saved);
+        AnimalEngine copy(capacity);
+        problems += !copy.load(saved);
+        copy.save(resaved);
+        problems += saved.str() != resaved.str();
+    }
+    problems += liveBytes != before;
+    if (problems) std::cout << "  " << problems << " problem(s) found\n";
+    return problems;
+}
+
+int main() {
+    World world;
+    std::cout << kGames << " games over " << kAnimals << " animals with Zipf popularity and " << kQuestions << " yes/no traits\n";
+    int problems = 0;
+    for (std::size_t capacity : {1, 2, 4, 8, 16}) problems += runCase(world, capacity);
+    return problems ? EXIT_FAILURE : EXIT_SUCCESS;
+}
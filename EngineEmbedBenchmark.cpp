@@ -0,0 +1,124 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "AnimalEngine.h"
+#include "PerfCounters.h"
+
+// the answers one short game takes: yes to the first question, yes to the guess (Dog), then 4 to quit from the menu
+static const std::string kScript = "yes\nyes\n4\n";
+
+/**
+ * @brief plays one game by running AnimalGame and piping the script into it, the way a service without the library has to
+ * @return true if the game ran to the end
+ */
+static bool playSpawned() {
+    int input[2];
+    if (pipe(input) != 0) return false;
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(input[0], STDIN_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        close(input[0]);
+        close(input[1]);
+        execl(ANIMAL_GAME_PATH, ANIMAL_GAME_PATH, static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(input[0]);
+    bool written = pid > 0 && write(input[1], kScript.data(), kScript.size()) == static_cast<ssize_t>(kScript.size());
+    close(input[1]);
+    int status = 0;
+    if (pid > 0) waitpid(pid, &status, 0);
+    return written && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * @brief plays the same game through the engine in-process
+ */
+static bool playEmbedded(AnimalEngine& engine) {
+    AnimalEngine::Cursor cursor = engine.start();
+    engine.answer(cursor, true);
+    return cursor.atGuess() && cursor.guess() == "Dog";
+}
+
+/**
+ * @brief plays many random games through the engine, learning a new animal after every wrong guess, and checks the engine keeps count
+ * @return the number of inconsistencies found
+ */
+static int exerciseEngine() {
+    constexpr int kGames = 100000;
+    AnimalEngine engine;
+    std::mt19937 rng(8);
+    int learned = 0, problems = 0;
+    std::string lastLearned = "Dog";
+    std::size_t questionsAsked = 0;
+    for (int game = 0; game < kGames; ++game) {
+        AnimalEngine::Cursor cursor = engine.start();
+        while (!cursor.atGuess()) {
+            engine.answer(cursor, rng() & 1);
+            ++questionsAsked;
+        }
+        if (rng() % 4 == 0) continue;  // the guess was right
+        auto suggestions = engine.suggestQuestions(cursor, 3);
+        std::string question = !suggestions.empty() && rng() % 2 ? suggestions[0] : "Question " + std::to_string(rng() % 2048) + "?";
+        std::string animal = "Animal " + std::to_string(game);
+        engine.learn(cursor, animal, question, rng() & 1);
+        ++learned;
+        lastLearned = animal;
+        problems += !cursor.atGuess() || cursor.guess() != animal;
+    }
+    AnimalEngine::Stats stats = engine.stats();
+    problems += stats.animals != static_cast<std::size_t>(learned) + 2 || engine.animals().size() != stats.animals;
+
+    std::vector<std::pair<std::string, bool>> path;
+    problems += !engine.findPath(lastLearned, path) || path.size() > stats.maxDepth || engine.findPath("Unicorn", path);
+
+    std::stringstream saved;
+    engine.save(saved);
+    AnimalEngine copy;
+    problems += !copy.load(saved) || copy.animals() != engine.animals();
+    copy.reset();
+    problems += copy.stats().animals != 2;
+
+    std::cout << "engine: " << kGames << " random games, " << questionsAsked << " questions, " << learned << " animals learned, average depth "
+              << stats.averageDepth << ", " << problems << " problems\n";
+    return problems;
+}
+
+int main() {
+    int problems = exerciseEngine();
+
+    constexpr int kSpawned = 200;
+    constexpr int kEmbedded = 10000000;
+    int failures = 0;
+
+    PerfCounters counters;
+    auto start = std::chrono::steady_clock::now();
+    counters.start();
+    for (int i = 0; i < kSpawned; ++i) failures += !playSpawned();
+    counters.stop();
+    double spawned = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kSpawned;
+    std::cout << "AnimalGame process per game: " << spawned << " us per game\n";
+    counters.print(std::cout);
+
+    AnimalEngine engine;
+    start = std::chrono::steady_clock::now();
+    counters.start();
+    for (int i = 0; i < kEmbedded; ++i) failures += !playEmbedded(engine);
+    counters.stop();
+    double embedded = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kEmbedded;
+    std::cout << "AnimalEngine in-process: " << embedded * 1000 << " ns per game, " << spawned / embedded << "x faster\n";
+    counters.print(std::cout);
+
+    std::cout << failures << " games failed\n";
+    return problems == 0 && failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
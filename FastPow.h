@@ -0,0 +1,228 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief how closely FastPow results must follow the exact value of x^y
+ * Precise stays within about 1 ULP, Balanced within about 4 ULP, and Fast within about 1e-4 relative error
+ * PowAccuracyBenchmark measures the actual worst case of each tier against a long double reference
+ */
+enum class PowAccuracy { Precise, Balanced, Fast };
+
+/**
+ * @class FastPow
+ * @brief x^y for floating point x and real y, computed as exp(y * log(x)) with polynomial approximations
+ *
+ * Precise and Balanced reduce log(x) through a 128-entry table and carry it as a hi/lo pair of doubles, so y * log(x) keeps
+ * about 64 bits of precision before it is exponentiated through a second 128-entry table of 2^(i/128). Precise additionally keeps the
+ * rounding error of the reduced argument, which matters once y is large. Fast uses no tables and short polynomials, and is meant for
+ * media-style pipelines that only need a few digits
+ *
+ * The core of every tier is branch free so batch loops over it can be vectorized by the compiler. Inputs the core does not cover
+ * (x that is not a positive normal number, non-finite y, or results that would overflow or underflow) are patched afterwards with std::pow,
+ * so every tier gives the same answer as std::pow for special values
+ *
+ * The table tiers keep their products exact with fused multiply-add. Without FMA in hardware (build with HW3_NATIVE_ARCH) std::fma is a
+ * library call, and those tiers were slower than std::pow itself, so they simply are std::pow there; see runsOwnCore
+ */
+class FastPow {
+public:
+    static constexpr int kTableBits = 7;
+    static constexpr int kTableSize = 1 << kTableBits;
+
+#if defined(__FMA__)
+    static constexpr bool kHasTableTiers = true;
+#else
+    static constexpr bool kHasTableTiers = false;
+#endif
+
+    // false for a tier that is std::pow in this build
+    template <PowAccuracy A>
+    static constexpr bool runsOwnCore = A == PowAccuracy::Fast || kHasTableTiers;
+
+private:
+    struct Tables {
+        double invc[kTableSize];
+        double logcHi[kTableSize];
+        double logcLo[kTableSize];
+        // bit patterns of 2^(i/128) with i << 45 already subtracted, so adding k << 45 both selects the entry and scales it by 2^(k/128)
+        uint64_t expBits[kTableSize];
+        double expTail[kTableSize];
+        double ln2HiN;
+        double ln2LoN;
+
+        Tables() {
+            for (int i = 0; i < kTableSize; ++i) {
+                // z values reaching entry i lie between these two bit patterns, see tableCore()
+                double low = std::bit_cast<double>(kLogOffset + (uint64_t(i) << (52 - kTableBits)));
+                double high = std::bit_cast<double>(kLogOffset + (uint64_t(i + 1) << (52 - kTableBits)) - 1);
+                double center = 0.5 * (low + high);
+                // the entry holding 1.0 uses exactly 1, so inputs close to 1 get an exact reduced argument
+                invc[i] = (low <= 1.0 && 1.0 <= high) ? 1.0 : 1.0 / center;
+                long double logc = -std::log(static_cast<long double>(invc[i]));
+                // rounded to a multiple of 2^-42 like kLn2Hi, so k * kLn2Hi + logcHi is exact in the core
+                logcHi[i] = static_cast<double>(std::nearbyint(logc * 0x1p42L) * 0x1p-42L);
+                logcLo[i] = static_cast<double>(logc - logcHi[i]);
+
+                long double value = std::exp2(static_cast<long double>(i) / kTableSize);
+                double hi = static_cast<double>(value);
+                expBits[i] = std::bit_cast<uint64_t>(hi) - (uint64_t(i) << (52 - kTableBits));
+                expTail[i] = static_cast<double>((value - hi) / hi);
+            }
+            long double ln2N = std::log(2.0L) / kTableSize;
+            // the high part keeps only 35 significant bits, so kd * ln2HiN is exact for every kd the core can produce
+            ln2HiN = std::bit_cast<double>(std::bit_cast<uint64_t>(static_cast<double>(ln2N)) & ~((uint64_t{1} << 18) - 1));
+            ln2LoN = static_cast<double>(ln2N - ln2HiN);
+        }
+    };
+
+    static constexpr uint64_t kLogOffset = 0x3fe6955500000000ULL;
+    static constexpr double kLn2Hi = 0x1.62e42fefa3800p-1;
+    static constexpr double kLn2Lo = 0x1.ef35793c76730p-45;
+    static constexpr double kRoundShift = 0x1.8p52;
+    // beyond this |y * log(x)| the result may overflow or underflow, and std::pow takes over
+    static constexpr double kMaxExponent = 700.0;
+
+    template <int Degree>
+    static double log1pTail(double r) {
+        // ln(1 + r) - r = -r^2/2 + r^3/3 - ..., evaluated by Horner's rule from the highest degree down
+        double p = 0.0;
+        for (int d = Degree; d >= 3; --d) p = r * (p + ((d & 1) ? 1.0 : -1.0) / d);
+        return r * r * (p - 0.5);
+    }
+
+    template <int Degree>
+    static double expm1Poly(double r) {
+        // e^r - 1 = r + r^2/2! + ... + r^Degree/Degree!
+        double p = 0.0;
+        double factorial = 1.0;
+        for (int d = 2; d <= Degree; ++d) factorial *= d;
+        for (int d = Degree; d >= 2; --d) {
+            p = r * (p + 1.0 / factorial);
+            factorial /= d;
+        }
+        return r + r * p;
+    }
+
+    template <int LogDegree, int ExpDegree, bool ExactReduction>
+    static double tableCore(double x, double y, const Tables& t) {
+        uint64_t ix = std::bit_cast<uint64_t>(x);
+        uint64_t tmp = ix - kLogOffset;
+        // table indices stay 64-bit, which lets the compiler turn the table loads into gathers and vectorize batch loops
+        uint64_t i = (tmp >> (52 - kTableBits)) % kTableSize;
+        double k = static_cast<double>(static_cast<int64_t>(tmp) >> 52);
+        double z = std::bit_cast<double>(ix - (tmp & (uint64_t{0xfff} << 52)));
+
+        // log(x) = k*ln2 + log(c) + log(1 + r), accumulated as hi + lo
+        double r;
+        double rTail = 0.0;
+        if constexpr (ExactReduction) {
+            // z * invc is split into an exact hi + lo pair, so the rounding error of r is kept instead of being amplified by large y
+            double product = z * t.invc[i];
+            r = product - 1.0;
+            double productLo = std::fma(z, t.invc[i], -product);
+            rTail = productLo - productLo * r;
+        } else {
+            r = std::fma(z, t.invc[i], -1.0);
+        }
+        double t1 = k * kLn2Hi + t.logcHi[i];
+        double t2 = t1 + r;
+        double lo = k * kLn2Lo + t.logcLo[i] + (t1 - t2 + r) + log1pTail<LogDegree>(r) + rTail;
+        double logHi = t2 + lo;
+        double logLo = t2 - logHi + lo;
+
+        // y * log(x) as hi + lo, with the rounding error of the product recovered exactly by fma
+        double eHi = y * logHi;
+        double eLo = std::fma(y, logHi, -eHi) + y * logLo;
+
+        double kd = eHi * (kTableSize / 0.6931471805599453) + kRoundShift;
+        uint64_t ki = std::bit_cast<uint64_t>(kd);
+        kd -= kRoundShift;
+        double rr = (eHi - kd * t.ln2HiN) - kd * t.ln2LoN + eLo;
+        uint64_t j = ki % kTableSize;
+        double scale = std::bit_cast<double>(t.expBits[j] + (ki << (52 - kTableBits)));
+        return scale + scale * (t.expTail[j] + expm1Poly<ExpDegree>(rr));
+    }
+
+    static double fastCore(double x, double y) {
+        uint64_t ix = std::bit_cast<uint64_t>(x);
+        uint64_t tmp = ix - kLogOffset;
+        double k = static_cast<double>(static_cast<int64_t>(tmp) >> 52);
+        double z = std::bit_cast<double>(ix - (tmp & (uint64_t{0xfff} << 52)));
+
+        // log(z) = 2 atanh(s) with s = (z - 1) / (z + 1), and |s| < 0.18 over the reduced range
+        double s = (z - 1.0) / (z + 1.0);
+        double s2 = s * s;
+        double logx = k * 0.6931471805599453 + 2.0 * s * (1.0 + s2 * (1.0 / 3.0 + s2 * (1.0 / 5.0)));
+
+        double e = y * logx;
+        double kd = e * 1.4426950408889634 + kRoundShift;
+        uint64_t ki = std::bit_cast<uint64_t>(kd);
+        kd -= kRoundShift;
+        double rr = e - kd * 0.6931471805599453;
+        double scale = std::bit_cast<double>((ki + 1023) << 52);
+        return scale * (1.0 + expm1Poly<4>(rr));
+    }
+
+    static const Tables& tables() {
+        static const Tables instance;
+        return instance;
+    }
+
+    template <PowAccuracy A>
+    static double core(double x, double y, const Tables& t) {
+        if constexpr (A == PowAccuracy::Precise) return tableCore<7, 5, true>(x, y, t);
+        else if constexpr (A == PowAccuracy::Balanced) return tableCore<7, 5, false>(x, y, t);
+        else return fastCore(x, y);
+    }
+
+    // true when the branch-free core cannot be trusted for these inputs and std::pow must be used instead
+    // |log2(x)| is bounded by the binary exponent of x plus one, which keeps this check to a few integer operations
+    static bool needsFallback(double x, double y) {
+        bool positiveNormal = x >= 0x1p-1022 && x <= 0x1.fffffffffffffp1023;
+        double exponent = static_cast<double>(static_cast<int>((std::bit_cast<uint64_t>(x) >> 52) & 0x7ff) - 1023);
+        return !positiveNormal || !(std::fabs(y) * (std::fabs(exponent) + 1.0) < kMaxExponent * 1.4426950408889634);
+    }
+
+public:
+    /**
+     * @brief computes x^y at the requested accuracy
+     */
+    template <PowAccuracy A>
+    static double pow(double x, double y) {
+        if (!runsOwnCore<A> || needsFallback(x, y)) return std::pow(x, y);
+        return core<A>(x, y, tables());
+    }
+
+    /**
+     * @brief computes in[i]^y for a whole buffer, in a branch-free pass followed by a pass that patches special inputs
+     * @param in The values to be raised to the power y.
+     * @param out Receives in[i]^y, may be the same buffer as in.
+     * @param count The number of values in both buffers.
+     * @param y The real exponent.
+     */
+    template <PowAccuracy A, typename T>
+    static void apply(const T* in, T* out, std::size_t count, double y) {
+        if constexpr (!runsOwnCore<A>) {
+            for (std::size_t i = 0; i < count; ++i) out[i] = static_cast<T>(std::pow(static_cast<double>(in[i]), y));
+            return;
+        }
+        const Tables& t = tables();
+        // the patch pass needs the original input, so in-place batches are processed in chunks through a small buffer
+        constexpr std::size_t kChunk = 256;
+        double results[kChunk];
+        for (std::size_t start = 0; start < count; start += kChunk) {
+            std::size_t n = count - start < kChunk ? count - start : kChunk;
+            const T* src = in + start;
+            for (std::size_t i = 0; i < n; ++i) results[i] = core<A>(static_cast<double>(src[i]), y, t);
+            for (std::size_t i = 0; i < n; ++i) {
+                double x = static_cast<double>(src[i]);
+                if (needsFallback(x, y)) results[i] = std::pow(x, y);
+            }
+            for (std::size_t i = 0; i < n; ++i) out[start + i] = static_cast<T>(results[i]);
+        }
+    }
+};
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief creates a Unix stream socket listening at path, replacing any stale socket file left there
+ * @throws std::runtime_error if the socket cannot be created or bound
+ */
+inline int listenUnix(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) throw std::runtime_error("socket path too long: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw std::runtime_error(std::string("cannot create socket: ") + std::strerror(errno));
+    ::unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("cannot listen on " + path + ": " + std::strerror(error));
+    }
+    return fd;
+}
+
+/**
+ * @brief connects to a Unix stream socket
+ * @return the connected socket, or -1 if nothing is listening at path
+ */
+inline int connectUnix(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief switches a descriptor to non-blocking mode, so reads and writes on it return EAGAIN instead of waiting
+ * @throws std::runtime_error if the flags cannot be changed
+ */
+inline void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) throw std::runtime_error(std::string("cannot make socket non-blocking: ") + std::strerror(errno));
+}
+
+/**
+ * @class OutputBuffer
+ * @brief bytes waiting to go out on a non-blocking socket, so one peer that stops reading never holds up a poll loop serving many others
+ *
+ * append() only queues; flush() sends as much as the socket takes and keeps the rest. A loop flushes after each turn's work,
+ * and polls the socket for POLLOUT while anything is still queued
+ */
+class OutputBuffer {
+    std::string pending;
+
+public:
+    void append(const std::string& text) { pending += text; }
+    bool empty() const { return pending.empty(); }
+    std::size_t size() const { return pending.size(); }
+    const std::string& queued() const { return pending; }
+
+    /**
+     * @brief sends what is queued until the socket is full or the queue is empty
+     * @return false if the peer has gone away, in which case the queue is dropped and errno says why
+     */
+    bool flush(int fd) {
+        std::size_t sent = 0;
+        while (sent < pending.size()) {
+            ssize_t written = ::send(fd, pending.data() + sent, pending.size() - sent, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) continue;
+            if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (written <= 0) {
+                pending.clear();
+                return false;
+            }
+            sent += static_cast<std::size_t>(written);
+        }
+        pending.erase(0, sent);
+        return true;
+    }
+};
+
+/**
+ * @class StopSignal
+ * @brief a stop request made from a signal handler that also wakes the poll() loop it is meant for, so the loop needs no timeout to notice it
+ *
+ * request() sets a flag and writes a byte to a pipe. The loop calls arm() before it starts, polls descriptor() with its other descriptors,
+ * calls drain() when that is readable and checks requested() every turn. The pipe stays open for the life of the process,
+ * and request() only reaches it through an atomic, so it is async-signal-safe even before arm()
+ */
+class StopSignal {
+    volatile std::sig_atomic_t flag = 0;
+    std::atomic<int> writeEnd{-1};
+    int readEnd = -1;
+
+public:
+    /**
+     * @throws std::runtime_error if the pipe cannot be created
+     */
+    void arm() {
+        if (readEnd >= 0) return;
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) != 0) throw std::runtime_error(std::string("cannot create stop pipe: ") + std::strerror(errno));
+        readEnd = fds[0];
+        writeEnd = fds[1];
+    }
+
+    void request() {
+        flag = 1;
+        int fd = writeEnd.load();
+        if (fd < 0) return;
+        int saved = errno;
+        [[maybe_unused]] ssize_t written = ::write(fd, "", 1);
+        errno = saved;
+    }
+
+    bool requested() const { return flag != 0; }
+    int descriptor() const { return readEnd; }
+
+    void drain() {
+        char buffer[64];
+        while (::read(readEnd, buffer, sizeof(buffer)) > 0) {}
+    }
+};
+
+/**
+ * @class FdChannel
+ * @brief a connected Unix socket that carries whole messages, each optionally with open file descriptors attached
+ *
+ * Descriptors travel as SCM_RIGHTS ancillary data, so the receiving process gets its own descriptors for the same open sockets and files
+ * (the same connection, the same file offset and mapping) rather than just their numbers
+ * Every message is a 4-byte length followed by the payload, and its descriptors ride along with the length
+ */
+class FdChannel {
+    int fd = -1;
+
+    static std::runtime_error failure(const char* what) { return std::runtime_error(std::string(what) + ": " + std::strerror(errno)); }
+
+    void readExactly(char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t got = ::read(fd, data, size);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) throw got == 0 ? std::runtime_error("channel closed in the middle of a message") : failure("cannot read from channel");
+            data += got;
+            size -= static_cast<std::size_t>(got);
+        }
+    }
+
+public:
+    // the kernel limits how many descriptors one message may carry (SCM_MAX_FD is 253)
+    static constexpr std::size_t kMaxFds = 250;
+
+    explicit FdChannel(int fd) : fd(fd) {}
+    FdChannel(FdChannel&& other) noexcept : fd(std::exchange(other.fd, -1)) {}
+    FdChannel& operator=(FdChannel&& other) noexcept {
+        std::swap(fd, other.fd);
+        return *this;
+    }
+    FdChannel(const FdChannel&) = delete;
+    FdChannel& operator=(const FdChannel&) = delete;
+    ~FdChannel() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    int descriptor() const { return fd; }
+
+    /**
+     * @brief sends one message, passing the given descriptors along with it; the caller keeps its own copies of them open
+     * @throws std::runtime_error if the message cannot be sent
+     */
+    void send(const std::string& payload, const std::vector<int>& fds = {}) {
+        if (fds.size() > kMaxFds) throw std::runtime_error("too many descriptors for one message");
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        iovec header{&length, sizeof(length)};
+        msghdr message{};
+        message.msg_iov = &header;
+        message.msg_iovlen = 1;
+        std::vector<char> control(CMSG_SPACE(sizeof(int) * std::max<std::size_t>(fds.size(), 1)));
+        if (!fds.empty()) {
+            message.msg_control = control.data();
+            message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+            cmsghdr* rights = CMSG_FIRSTHDR(&message);
+            rights->cmsg_level = SOL_SOCKET;
+            rights->cmsg_type = SCM_RIGHTS;
+            rights->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+            std::memcpy(CMSG_DATA(rights), fds.data(), sizeof(int) * fds.size());
+        }
+        ssize_t sent;
+        while ((sent = sendmsg(fd, &message, MSG_NOSIGNAL)) < 0 && errno == EINTR) {}
+        if (sent != static_cast<ssize_t>(sizeof(length))) throw failure("cannot send on channel");
+
+        const char* data = payload.data();
+        std::size_t left = payload.size();
+        while (left > 0) {
+            ssize_t written = ::send(fd, data, left, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) continue;
+            if (written < 0) throw failure("cannot send on channel");
+            data += written;
+            left -= static_cast<std::size_t>(written);
+        }
+    }
+
+    /**
+     * @brief receives one message and the descriptors that came with it, which now belong to the caller
+     * @return false if the other side closed the channel between messages
+     * @throws std::runtime_error if the channel fails or closes in the middle of a message
+     */
+    bool receive(std::string& payload, std::vector<int>& fds) {
+        fds.clear();
+        uint32_t length = 0;
+        iovec header{&length, sizeof(length)};
+        msghdr message{};
+        message.msg_iov = &header;
+        message.msg_iovlen = 1;
+        std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxFds));
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+        ssize_t got;
+        while ((got = recvmsg(fd, &message, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) {}
+        if (got == 0) return false;
+        if (got < 0) throw failure("cannot receive on channel");
+        for (cmsghdr* c = CMSG_FIRSTHDR(&message); c; c = CMSG_NXTHDR(&message, c)) {
+            if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+            std::size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            std::size_t first = fds.size();
+            fds.resize(first + count);
+            std::memcpy(fds.data() + first, CMSG_DATA(c), sizeof(int) * count);
+        }
+        if (message.msg_flags & MSG_CTRUNC) throw std::runtime_error("descriptors were dropped from a message");
+        // the length itself may arrive in pieces on a stream socket
+        if (got < static_cast<ssize_t>(sizeof(length))) readExactly(reinterpret_cast<char*>(&length) + got, sizeof(length) - static_cast<std::size_t>(got));
+
+        payload.resize(length);
+        readExactly(payload.data(), length);
+        return true;
+    }
+};
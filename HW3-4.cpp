@@ -1,106 +1,53 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
+#include "AnimalEngine.h"
+#include "AnimalMetadata.h"
+#include "LatencyHistogram.h"
+#include "Transcript.h"
 
 /**
- * @class Animal
- * @brief A virtual base animal class
- * 
- * This is a polymorphic base class to be built upon by the DynamicAnimal class
- * it has a virtual constructor and destructor to ensure that any class that builds on it
- * is able to provide its own constructor and not be limited by the base class.
- * Another benefit of a purely virtual class means it cannot be ininitialized directly, solely through classes that build upon it.
+ * @class GameMetrics
+ * @brief latency histograms for every operation the game performs on the question tree
+ *
+ * Only the time spent inside the engine is recorded, the time a player spends typing an answer is never counted
+ * The percentiles are written to std::cerr every kDumpInterval rounds and once more when the game exits, so they never mix with the game's own prompts
  */
-class Animal {
+class GameMetrics {
 public:
-    virtual ~Animal() = default;
-    virtual std::string getName() const = 0;
-};
+    enum Operation { TraversalStep, Learn, List, Reset, Snapshot, Load, OperationCount };
+    static constexpr int kDumpInterval = 10;
 
-/**
- * @class DynamicAnimal
- * @brief a concrete implementation of the abstract Animal class. Stores names of animals as answers by the program for use in the game.
- * 
- * Encapsulates the name field as private to store the names of animals in a controlled manner
- * Also overrides the getName method of the Animal base class to return the shared name. Since the name field is private, this is the only way to get the name field from outside of the class
- */
-class DynamicAnimal : public Animal {
 private:
-    std::string name;
-public:
-    explicit DynamicAnimal(const std::string& name) : name(name) {}
-    std::string getName() const override { return name; }
-};
+    LatencyHistogram histograms[OperationCount];
+    int rounds = 0;
 
-/**
- * @class Node
- * @brief an implementation of the Node class, utilized to generate the question tree
- * 
- * Each node contains a string question, that is used to generate the questions asked to the user while playing the game
- * Each node has at most one yes child and at most one no child, corresponding to the responses to the question
- * Once the user has traversed the tree to a leaf node, it will attempt to guess the animal
- */
-class Node {
-public:
-    std::string question;
-    std::unique_ptr<Node> yes;
-    std::unique_ptr<Node> no;
-    std::unique_ptr<Animal> animal;
-
-    Node(const std::string& question) : question(question) {}
-    Node(std::unique_ptr<Animal> animal) : animal(std::move(animal)) {}
-
-    bool isLeaf() const { return animal != nullptr; }
-};
-
-/**
- * @class AnimalTree
- * @brief This class is responsible for generating the question tree that forms the basis for the game's logic
- * 
- * Making this its own separate class instead of the part of the AnimalGame class enables us to use object lifetimes to reset the memory of the game
- * Under Resource Acquisition Is Initialization, the lifetime of any instance of this class will be controlled by the AnimalGame class
- * When an instance of the AnimalGame class is initialized, it will initialize an instance of this class as well
- */
-class AnimalTree {
-private:
-    std::unique_ptr<Node> root;
+    static const char* nameOf(Operation op) {
+        static const char* names[OperationCount] = {"traversal step", "learn", "list", "reset", "snapshot", "load"};
+        return names[op];
+    }
 
 public:
-    AnimalTree() {
-        resetToInitialState();
-    }
+    LatencyHistogram& operator[](Operation op) { return histograms[op]; }
 
     /**
-     * @brief is utilized with a clean root node to build the initial version of the tree for use in the game
-     * This function creates the unique state by re-assigning the root of the tree to a new unique pointer
-     * If there was a pre-existing question tree in use by the game, re-assigning the root of the tree will cause the old tree to no longer be owned by the instance of the AnimalGame class, marking it for garbage collection
-     * This function will then create the initial tree
-     */
-    void resetToInitialState() {
-        root = std::make_unique<Node>("Is your animal warm or cold blooded?");
-        root->yes = std::make_unique<Node>(std::make_unique<DynamicAnimal>("Dog"));
-        root->no = std::make_unique<Node>(std::make_unique<DynamicAnimal>("Snake"));
-    }
-    /**
-     * @brief public method to allow access to the private root field
-     * The root field, pointing to the root node of the question tree, is private
-     * This getter method allows the AnimalGame to access the root node of the question tree, essential to causing the game to operate correctly
+     * @brief counts a finished round and dumps the percentiles every kDumpInterval rounds
      */
-    Node* getRoot() const {
-        return root.get();
+    void endRound() {
+        if (++rounds % kDumpInterval == 0) dump(std::cerr);
     }
-    /**
-     * @brief traverses the question tree to collect all animals currently in memory
-     * This creates a full list of animals and works with the AnimalGame.listAnimals() function to display them to the user
-     */
-    void collectAnimals(const Node* current, std::vector<std::string>& animals) const {
-        if (!current) return;
-        if (current->isLeaf()) {
-            animals.push_back(current->animal->getName());
-        } else {
-            collectAnimals(current->yes.get(), animals);
-            collectAnimals(current->no.get(), animals);
+
+    void dump(std::ostream& out) const {
+        out << "Latency percentiles after " << rounds << " round(s):\n";
+        for (int op = 0; op < OperationCount; ++op) {
+            if (histograms[op].count()) histograms[op].printPercentiles(out, nameOf(static_cast<Operation>(op)));
         }
     }
 };
@@ -108,46 +55,83 @@ public:
 /**
  * @class AnimalGame
  * @brief class that controls actual in-game operations
- * The class, upon initialization, initializes an instance of the AnimalTree class, and uses it to run the game
+ * The class, upon initialization, initializes an instance of the AnimalEngine library, and uses it to run the game
+ * All of the game's logic lives in the engine; this class only reads the player's answers and prints the engine's questions
  * This class handles the logic to traverse the tree and attempt to guess the users animal
  * It also handles the logic to learn new animals and install them into the question tree (along with new questions)
  * It also displays the post-game menu, as well as 
  */
 class AnimalGame {
 private:
-    AnimalTree tree;
+    static constexpr std::size_t kMaxSuggestions = 3;
+
+    AnimalEngine engine;
+    GameMetrics metrics;
+    // records every game when the player asked for a transcript file
+    std::unique_ptr<TranscriptWriter> transcript;
+
+    /**
+     * @brief plays one round and, if a transcript is being kept, records how it went
+     * The transcript counts the time from the first question to the end of the round, including the player's typing
+     */
+    void askQuestions() {
+        GameTranscript game;
+        game.startMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        auto started = std::chrono::steady_clock::now();
+        game.outcome = playRound(game);
+        game.durationMicros = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count());
+        if (transcript) transcript->record(game);
+    }
     /**
      * @brief function to control inner-game logic
-     * This class uses the tree instance of the AnimalTree class to run game logic
-     * The user traverses the tree based on their answers until a leaf node is reached
+     * This class uses a cursor of the AnimalEngine to run game logic
+     * The user traverses the tree based on their answers until the engine is ready to guess
+     * If the same question is reached twice in one round, the engine reuses the earlier answer instead of asking again
      * At this point, the game is ready to guess their animal
      * If the guess is correct, the game is over and the user is returned to the post-game menu
      * If the guess is incorrect, the user is prompted for a question to add to a new node in the tree (making the node the game ended on a non-leaf node for future playthroughs), along with a new animal learned by the game
+     * When the game allows several animals per leaf, it guesses each of them in turn first, and only asks for a question once the leaf is full
+     * @param game receives the number of questions and guesses and the leaf the round ended at
+     * @return how the round ended
      */
-    void askQuestions(Node* current) {
-        while (!current->isLeaf()) {
-            std::cout << current->question << " (yes/no): ";
+    GameOutcome playRound(GameTranscript& game) {
+        AnimalEngine::Cursor cursor = engine.start();
+        while (!cursor.atGuess()) {
+            std::cout << cursor.question() << " (yes/no): ";
             std::string answer;
-            std::cin >> answer;
-            if (answer == "yes") {
-                current = current->yes.get();
-            } else if (answer == "no") {
-                current = current->no.get();
-            } else {
+            if (!(std::cin >> answer)) return GameOutcome::Abandoned;
+            if (answer != "yes" && answer != "no") {
                 std::cout << "Please answer 'yes' or 'no'.\n";
+                continue;
             }
+            ScopedLatency timer(metrics[GameMetrics::TraversalStep]);
+            engine.answer(cursor, answer == "yes");
+            ++game.questions;
         }
+        game.leaf = TranscriptFormat::leafCode(cursor.route());
 
-        std::cout << "Is it a " << current->animal->getName() << "? (yes/no): ";
-        std::string answer;
-        std::cin >> answer;
+        // a leaf may hold several animals, which are guessed in turn until one is right or they run out
+        while (true) {
+            // the metadata file is only read here, once the guess is known, so the questions above never wait on it
+            AnimalMetadata details;
+            if (engine.metadata(cursor.guess(), details) && !details.description.empty()) std::cout << details.description << "\n";
+            std::cout << "Is it a " << cursor.guess() << "? (yes/no): ";
+            std::string answer;
+            if (!(std::cin >> answer)) return GameOutcome::Abandoned;
 
-        if (answer == "yes") {
-            std::cout << "Yay! I guessed it right!\n";
-        } else if (answer == "no") {
-            learnNewAnimal(current);
-        } else {
-            std::cout << "Please answer 'yes' or 'no'.\n";
+            if (answer == "yes") {
+                ++game.guesses;
+                engine.confirm(cursor);
+                std::cout << "Yay! I guessed it right!\n";
+                return GameOutcome::Guessed;
+            } else if (answer == "no") {
+                ++game.guesses;
+                if (engine.nextGuess(cursor)) continue;
+                return learnNewAnimal(cursor);
+            } else {
+                std::cout << "Please answer 'yes' or 'no'.\n";
+            }
         }
     }
     /**
@@ -155,107 +139,314 @@ private:
      * This function is called by the askQuestions function
      * After an unsuccessful guess, the user is prompted by this function for the name of their animal, as well as a question that would distinguish it at this point in the tree
      * Both of these values are added to a new node on the tree
+     * Before the user types a question, questions the game already knows that split the nearby animals well are offered, and the user can pick one by number instead
+     * Reusing questions keeps the game's vocabulary consistent across the tree
+     * @return whether the animal joined the leaf's candidates or was learned with a question
      */
-    void learnNewAnimal(Node* current) {
+    GameOutcome learnNewAnimal(AnimalEngine::Cursor& cursor) {
         std::cout << "I give up! What is your animal? ";
         std::string newAnimalName;
         std::cin.ignore();
         std::getline(std::cin, newAnimalName);
 
+        if (engine.remember(cursor, newAnimalName)) {
+            std::cout << "Got it! I'll guess a " << newAnimalName << " here next time.\n";
+            return GameOutcome::Remembered;
+        }
+
         std::cout << "What question distinguishes a " << newAnimalName << " from a "
-                  << current->animal->getName() << "?\n";
+                  << cursor.guess() << "?\n";
+        auto suggestions = engine.suggestQuestions(cursor, kMaxSuggestions);
+        if (!suggestions.empty()) {
+            std::cout << "Questions I already know (enter a number to use one, or type your own):\n";
+            for (std::size_t i = 0; i < suggestions.size(); ++i) {
+                std::cout << i + 1 << ". " << suggestions[i] << "\n";
+            }
+        }
         std::string newQuestion;
         std::getline(std::cin, newQuestion);
+        if (newQuestion.size() == 1 && newQuestion[0] >= '1' && static_cast<std::size_t>(newQuestion[0] - '0') <= suggestions.size()) {
+            newQuestion = suggestions[newQuestion[0] - '1'];
+        }
 
         std::cout << "For a " << newAnimalName << ", what is the answer to that question? (yes/no): ";
         std::string answer;
         std::cin >> answer;
 
-        auto newAnimalNode = std::make_unique<Node>(std::make_unique<DynamicAnimal>(newAnimalName));
-        auto oldAnimalNode = std::make_unique<Node>(std::move(current->animal));
-        current->question = newQuestion;
+        // a full leaf's other animals are sorted by the new question too, as long as at least one of them stays opposite the new animal
+        std::vector<bool> candidateIsYes;
+        auto candidates = engine.candidates(cursor);
+        if (candidates.size() > 1) {
+            for (const auto& candidate : candidates) {
+                std::cout << "And for a " << candidate << "? (yes/no): ";
+                std::string candidateAnswer;
+                std::cin >> candidateAnswer;
+                candidateIsYes.push_back(candidateAnswer == "yes");
+            }
+            if (std::find(candidateIsYes.begin(), candidateIsYes.end(), answer != "yes") == candidateIsYes.end()) candidateIsYes.clear();
+        }
 
-        if (answer == "yes") {
-            current->yes = std::move(newAnimalNode);
-            current->no = std::move(oldAnimalNode);
-        } else {
-            current->yes = std::move(oldAnimalNode);
-            current->no = std::move(newAnimalNode);
+        {
+            ScopedLatency timer(metrics[GameMetrics::Learn]);
+            engine.learn(cursor, newAnimalName, newQuestion, answer == "yes", candidateIsYes);
         }
 
         std::cout << "Got it! I'll remember that for next time.\n";
+        return GameOutcome::Learned;
+    }
+
+    /**
+     * @brief what the post-game menu should do after a command has run
+     */
+    enum class MenuResult { Stay, Play, Quit };
+
+    /**
+     * @struct MenuCommand
+     * @brief one entry of the post-game menu, the label shown to the user and the member function that carries it out
+     */
+    struct MenuCommand {
+        const char* label;
+        MenuResult (AnimalGame::*run)();
+    };
+
+    /**
+     * @brief the table of post-game menu entries, numbered from 1 in the order listed
+     * Adding a command only needs a new entry here and a member function to run it
+     */
+    static const std::vector<MenuCommand>& menuCommands() {
+        static const std::vector<MenuCommand> commands = {
+            {"Play again", &AnimalGame::playAgain},
+            {"Reset memory and play again", &AnimalGame::resetAndPlay},
+            {"List all animals", &AnimalGame::listCommand},
+            {"Quit", &AnimalGame::quit},
+            {"Show statistics", &AnimalGame::showStats},
+            {"Save animals to a file", &AnimalGame::saveTree},
+            {"Load animals from a file", &AnimalGame::loadTree},
+            {"Search for an animal", &AnimalGame::searchAnimal},
+        };
+        return commands;
     }
 
     /**
      * @brief function that runs the post-game menu
-     * After each round of the game, this menu is displayed
-     * Play Again restarts the game with the current question tree
-     * Reset memory resets the question tree to the default state (with one question and two total animals) and automatically begins the game again after
-     * List All Animals lists all animals currently in the question tree, available to be guessed by the game, then brings this menu up again
-     * Quit exits the program
+     * After each round of the game, this menu is displayed until the user picks a command that starts a new round or quits
+     * The menu is a loop over the menuCommands() table rather than a function that calls itself, so listing animals or typing an invalid choice any number of times never grows the call stack
+     * The end of input is treated the same as choosing Quit
+     * @return true if another round should be played, false to quit
      */
-    void promptAfterRound() {
-        std::cout << "What would you like to do next?\n";
-        std::cout << "1. Play again\n";
-        std::cout << "2. Reset memory and play again\n";
-        std::cout << "3. List all animals\n";
-        std::cout << "4. Quit\n";
-        std::cout << "Enter your choice (1/2/3/4): ";
-
-        int choice;
-        std::cin >> choice;
-
-        switch (choice) {
-            case 1:
-                break;
-            case 2:
-                tree.resetToInitialState();
-                std::cout << "Game has been reset to initial state.\n";
-                break;
-            case 3:
-                listAnimals();
-                promptAfterRound(); 
-                break;
-            case 4:
-                std::exit(0);
-            default:
+    bool promptAfterRound() {
+        const auto& commands = menuCommands();
+        while (true) {
+            std::cout << "What would you like to do next?\n";
+            for (std::size_t i = 0; i < commands.size(); ++i) {
+                std::cout << i + 1 << ". " << commands[i].label << "\n";
+            }
+            std::cout << "Enter your choice (1-" << commands.size() << "): ";
+
+            std::string choice;
+            if (!(std::cin >> choice)) return false;
+
+            std::size_t index = 0;
+            try {
+                std::size_t parsed = 0;
+                index = std::stoul(choice, &parsed);
+                if (parsed != choice.size()) index = 0;
+            } catch (const std::exception&) {
+                index = 0;
+            }
+            if (index < 1 || index > commands.size()) {
                 std::cout << "Invalid choice. Please try again.\n";
-                promptAfterRound();
+                continue;
+            }
+
+            switch ((this->*commands[index - 1].run)()) {
+                case MenuResult::Stay:
+                    break;
+                case MenuResult::Play:
+                    return true;
+                case MenuResult::Quit:
+                    return false;
+            }
+        }
+    }
+
+    MenuResult playAgain() { return MenuResult::Play; }
+
+    MenuResult resetAndPlay() {
+        resetMemory();
+        std::cout << "Game has been reset to initial state.\n";
+        return MenuResult::Play;
+    }
+
+    MenuResult listCommand() {
+        listAnimals();
+        return MenuResult::Stay;
+    }
+
+    MenuResult quit() { return MenuResult::Quit; }
+
+    /**
+     * @brief prints the shape of the question tree followed by the latency percentiles recorded so far
+     */
+    MenuResult showStats() {
+        AnimalEngine::Stats stats = engine.stats();
+        std::cout << "Animals: " << stats.animals << "\n";
+        std::cout << "Questions: " << stats.questions << "\n";
+        std::cout << "Deepest animal: " << stats.maxDepth << " questions\n";
+        std::cout << "Average questions per animal: " << stats.averageDepth << "\n";
+        metrics.dump(std::cout);
+        return MenuResult::Stay;
+    }
+
+    /**
+     * @brief writes the question tree to a file chosen by the user, so it can be loaded again in a later session
+     */
+    MenuResult saveTree() {
+        std::cout << "Enter a file name: ";
+        std::string fileName;
+        if (!(std::cin >> fileName)) return MenuResult::Quit;
+
+        std::ofstream file(fileName);
+        if (file) {
+            ScopedLatency timer(metrics[GameMetrics::Snapshot]);
+            engine.save(file);
+        }
+        if (!file) {
+            std::cout << "Could not write to " << fileName << ".\n";
+        } else {
+            std::cout << "Saved animals to " << fileName << ".\n";
+        }
+        return MenuResult::Stay;
+    }
+
+    /**
+     * @brief replaces the question tree with one read from a file written by saveTree()
+     * If the file is missing or not a complete tree, the current tree is kept
+     */
+    MenuResult loadTree() {
+        std::cout << "Enter a file name: ";
+        std::string fileName;
+        if (!(std::cin >> fileName)) return MenuResult::Quit;
+
+        std::ifstream file(fileName);
+        bool loaded = false;
+        if (file) {
+            ScopedLatency timer(metrics[GameMetrics::Load]);
+            loaded = engine.load(file);
         }
+        if (loaded) {
+            std::cout << "Loaded animals from " << fileName << ".\n";
+        } else {
+            std::cout << "Could not load a question tree from " << fileName << ".\n";
+        }
+        return MenuResult::Stay;
+    }
+
+    /**
+     * @brief shows the answers that lead the game to a named animal
+     */
+    MenuResult searchAnimal() {
+        std::cout << "Which animal are you looking for? ";
+        std::string name;
+        std::cin.ignore();
+        if (!std::getline(std::cin, name)) return MenuResult::Quit;
+
+        std::vector<std::pair<std::string, bool>> path;
+        if (!engine.findPath(name, path)) {
+            std::cout << "I don't know a " << name << " yet.\n";
+            return MenuResult::Stay;
+        }
+        std::cout << "To reach a " << name << ":\n";
+        for (const auto& [question, answer] : path) {
+            std::cout << "- " << question << " " << (answer ? "yes" : "no") << "\n";
+        }
+        return MenuResult::Stay;
+    }
+
+    /**
+     * @brief resets the question tree to its initial state, recording how long the old tree took to tear down
+     */
+    void resetMemory() {
+        ScopedLatency timer(metrics[GameMetrics::Reset]);
+        engine.reset();
     }
 
     /**
      * @brief a function to print all animals known by the game
-     * This function works with the AnimalTree.collectAnimals() class to collect all animals in the question tree and display them
+     * This function works with the AnimalEngine.animals() function to collect all animals in the question tree and display them
      * I created this function to make testing my program easier (without this, you have to play the game again and traverse the tree in the same way to ensure a new animal and question were successfully added to it)
      * The requirements in the homework do not require this, but I think keeping this in will make my homework easier to grade for exactly the same reasons adding it made it easier to test
      */
-    void listAnimals() const {
-        std::vector<std::string> animals;
-        tree.collectAnimals(tree.getRoot(), animals);
+    void listAnimals() {
+        ScopedLatency timer(metrics[GameMetrics::List]);
+        std::vector<std::string> animals = engine.animals();
 
         std::cout << "Animals currently in memory:\n";
+        AnimalMetadata details;
         for (const auto& animal : animals) {
-            std::cout << "- " << animal << "\n";
+            std::cout << "- " << animal;
+            if (engine.metadata(animal, details)) {
+                for (std::size_t i = 0; i < details.aliases.size(); ++i) std::cout << (i ? ", " : " (also ") << details.aliases[i];
+                if (!details.aliases.empty()) std::cout << ")";
+                if (!details.description.empty()) std::cout << ": " << details.description;
+            }
+            std::cout << "\n";
         }
     }
 
 public:
+    /**
+     * @param bucketCapacity how many animals one guess may hold, see AnimalEngine
+     * @param transcriptPath a file to append a transcript of every game to, or empty to keep none
+     * @param metadataPath a file of animal descriptions and aliases written by MetadataFile::write(), or empty for none
+     * @throws std::runtime_error if the transcript or metadata file cannot be opened
+     */
+    explicit AnimalGame(std::size_t bucketCapacity = 1, const std::string& transcriptPath = "", const std::string& metadataPath = "")
+        : engine(bucketCapacity) {
+        if (!transcriptPath.empty()) transcript = std::make_unique<TranscriptWriter>(transcriptPath);
+        if (!metadataPath.empty()) engine.openMetadata(metadataPath);
+    }
+
     /**
      * @brief a function that encapsulates other helper functions of the AnimalGame class to yield the desired core gameplay loop
      */
     void play() {
         std::cout << "Welcome to The Animal Game!\n";
 
-        while (true) {
-            askQuestions(tree.getRoot());
-            promptAfterRound();
+        do {
+            askQuestions();
+            metrics.endRound();
+        } while (promptAfterRound());
+
+        metrics.dump(std::cerr);
+        if (transcript) {
+            try {
+                transcript->flush();
+            } catch (const std::exception& error) {
+                std::cerr << error.what() << "\n";
+            }
         }
     }
 };
 
-int main() {
-    AnimalGame game;
-    game.play();
+// the optional arguments set how many animals one guess may hold before the game asks for a question (1, the classic game, by default)
+// a file to append a transcript of every game to, for TranscriptQuery, and a file of animal metadata shown with guesses and listings
+int main(int argc, char* argv[]) {
+    std::size_t bucketCapacity = 1;
+    if (argc > 1) {
+        try {
+            bucketCapacity = std::stoul(argv[1]);
+        } catch (const std::exception&) {
+            std::cerr << "usage: " << argv[0] << " [animals per guess] [transcript file] [metadata file]\n";
+            return 1;
+        }
+    }
+    try {
+        AnimalGame game(bucketCapacity, argc > 2 ? argv[2] : "", argc > 3 ? argv[3] : "");
+        game.play();
+    } catch (const std::runtime_error& error) {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
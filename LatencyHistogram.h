@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @class LatencyHistogram
+ * @brief a high-dynamic-range histogram for recording latencies in nanoseconds
+ *
+ * Values are stored in log-linear buckets: every power of two is split into 2^kSubBucketBits equal sub-buckets,
+ * so any recorded value is reproduced to within 1/128 (under 1%) of its real size, from 1ns up to the full 64-bit range.
+ * Recording is a single relaxed atomic increment, so many threads can record into the same histogram without a lock
+ * Histograms filled on different threads can also be merged together afterwards to produce a combined report
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 7;
+    static constexpr uint64_t kSubBucketCount = uint64_t{1} << kSubBucketBits;
+    static constexpr size_t kBucketCount = (65 - kSubBucketBits) * kSubBucketCount;
+
+private:
+    std::vector<std::atomic<uint64_t>> counts;
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> minValue{UINT64_MAX};
+    std::atomic<uint64_t> maxValue{0};
+
+    static size_t indexFor(uint64_t value) {
+        if (value < kSubBucketCount) return static_cast<size_t>(value);
+        unsigned shift = static_cast<unsigned>(std::bit_width(value)) - 1 - kSubBucketBits;
+        uint64_t top = value >> shift;
+        return static_cast<size_t>((shift + 1) * kSubBucketCount + (top - kSubBucketCount));
+    }
+
+    // largest value that would have been recorded into the bucket at this index
+    static uint64_t highestValueAt(size_t index) {
+        if (index < kSubBucketCount) return index;
+        unsigned shift = static_cast<unsigned>(index / kSubBucketCount) - 1;
+        uint64_t top = kSubBucketCount + index % kSubBucketCount;
+        return ((top + 1) << shift) - 1;
+    }
+
+    static void updateMin(std::atomic<uint64_t>& target, uint64_t value) {
+        uint64_t current = target.load(std::memory_order_relaxed);
+        while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    static void updateMax(std::atomic<uint64_t>& target, uint64_t value) {
+        uint64_t current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+public:
+    LatencyHistogram() : counts(kBucketCount) {}
+
+    /**
+     * @brief records a single latency sample
+     * Safe to call concurrently from any number of threads
+     */
+    void record(uint64_t nanoseconds) {
+        counts[indexFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        updateMin(minValue, nanoseconds);
+        updateMax(maxValue, nanoseconds);
+    }
+
+    /**
+     * @brief adds every sample of another histogram into this one
+     * This is how per-thread histograms are combined into a single report
+     */
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            uint64_t c = other.counts[i].load(std::memory_order_relaxed);
+            if (c) counts[i].fetch_add(c, std::memory_order_relaxed);
+        }
+        total.fetch_add(other.count(), std::memory_order_relaxed);
+        if (other.count()) {
+            updateMin(minValue, other.min());
+            updateMax(maxValue, other.max());
+        }
+    }
+
+    void reset() {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        minValue.store(UINT64_MAX, std::memory_order_relaxed);
+        maxValue.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t min() const { return count() ? minValue.load(std::memory_order_relaxed) : 0; }
+    uint64_t max() const { return maxValue.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief returns the value below which the given percentage of samples fall
+     * @param percentile a value between 0 and 100, e.g. 99.9 for p999
+     */
+    uint64_t valueAtPercentile(double percentile) const {
+        uint64_t n = count();
+        if (n == 0) return 0;
+        percentile = std::clamp(percentile, 0.0, 100.0);
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(n) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= target) return std::min(highestValueAt(i), max());
+        }
+        return max();
+    }
+
+    /**
+     * @brief prints a single line summary (count, p50, p99, p999, max) in nanoseconds
+     */
+    void printPercentiles(std::ostream& out, const std::string& label) const {
+        out << label << ": count=" << count()
+            << " p50=" << valueAtPercentile(50.0) << "ns"
+            << " p99=" << valueAtPercentile(99.0) << "ns"
+            << " p999=" << valueAtPercentile(99.9) << "ns"
+            << " max=" << max() << "ns\n";
+    }
+};
+
+/**
+ * @class ScopedLatency
+ * @brief records the time between its construction and destruction into a LatencyHistogram
+ */
+class ScopedLatency {
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedLatency() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+};
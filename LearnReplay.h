@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AnimalTree.h"
+
+/**
+ * @struct LearnEvent
+ * @brief one animal learned by the game: the answers that led to the leaf whose guess was wrong, and what the player taught it there
+ * The path is a string of y and n from the root, the same form the server uses for its sessions
+ */
+struct LearnEvent {
+    std::string path;
+    std::string animal;
+    std::string question;
+    bool newAnimalIsYes = false;
+};
+
+/**
+ * @class LearnLog
+ * @brief reads and writes learn events as text, one per line: the path ("-" at the root), y or n for the new animal's answer,
+ * the animal and the question, separated by tabs
+ */
+class LearnLog {
+public:
+    static void write(std::ostream& out, const LearnEvent& event) {
+        out << (event.path.empty() ? "-" : event.path) << '\t' << (event.newAnimalIsYes ? 'y' : 'n') << '\t' << event.animal << '\t' << event.question
+            << '\n';
+    }
+
+    /**
+     * @brief reads every event from a stream
+     * @return false if a line is not a learn event, in which case events holds the ones before it
+     */
+    static bool read(std::istream& in, std::vector<LearnEvent>& events) {
+        std::string line;
+        while (std::getline(in, line)) {
+            auto first = line.find('\t');
+            auto second = first == std::string::npos ? first : line.find('\t', first + 1);
+            auto third = second == std::string::npos ? second : line.find('\t', second + 1);
+            if (third == std::string::npos || second != first + 2 || (line[first + 1] != 'y' && line[first + 1] != 'n')) return false;
+            LearnEvent event;
+            event.path = line.substr(0, first);
+            if (event.path == "-") event.path.clear();
+            event.newAnimalIsYes = line[first + 1] == 'y';
+            event.animal = line.substr(second + 1, third - second - 1);
+            event.question = line.substr(third + 1);
+            events.push_back(std::move(event));
+        }
+        return true;
+    }
+};
+
+/**
+ * @class LearnReplay
+ * @brief rebuilds a question tree from a learn log, either one event after another or in parallel by subtree
+ *
+ * Two learns commute when they split leaves in different subtrees, so the parallel replay cuts the tree at a fixed depth:
+ * events that split a leaf above that depth are replayed first, in order, on one thread, which settles the top of the tree for good,
+ * and every other event belongs to the subtree under the first splitDepth answers of its path. Those subtrees share no nodes,
+ * so each is replayed in log order on whichever thread picks it up, and the result is the same tree the sequential replay builds.
+ * Question ids are handed out last, in log order over the events that were applied, so they match the sequential replay's too
+ *
+ * An event whose path does not end at a leaf when its turn comes is skipped by both replays, since the game could never have produced it
+ */
+class LearnReplay {
+public:
+    struct Report {
+        std::size_t applied = 0;
+        std::size_t skipped = 0;
+    };
+
+private:
+    // follows answers from a node, returning the leaf they end at, or nullptr if they end at a question or run past a leaf
+    static Node* leafAt(Node* current, const std::string& path, std::size_t from) {
+        for (std::size_t i = from; i < path.size(); ++i) {
+            if (current->isLeaf()) return nullptr;
+            current = path[i] == 'y' ? current->yes.get() : current->no.get();
+        }
+        return current->isLeaf() ? current : nullptr;
+    }
+
+public:
+    /**
+     * @brief replays events one at a time with AnimalTree::learn(), the way the game learned them
+     */
+    static Report sequential(AnimalTree& tree, const std::vector<LearnEvent>& events) {
+        Report report;
+        for (const LearnEvent& event : events) {
+            Node* leaf = leafAt(tree.getRoot(), event.path, 0);
+            if (!leaf) {
+                ++report.skipped;
+                continue;
+            }
+            tree.learn(leaf, event.animal, event.question, event.newAnimalIsYes);
+            ++report.applied;
+        }
+        return report;
+    }
+
+    /**
+     * @brief replays events into tree on up to threads threads, producing the same tree as sequential()
+     * @param splitDepth the depth at which the tree is cut into subtrees; 2^splitDepth subtrees should comfortably outnumber the threads
+     */
+    static Report parallel(AnimalTree& tree, const std::vector<LearnEvent>& events, unsigned threads, unsigned splitDepth = 12) {
+        const std::size_t partitions = std::size_t{1} << splitDepth;
+        // the node each applied event split; its question id is filled in at the end
+        std::vector<Node*> splitAt(events.size(), nullptr);
+        std::vector<std::vector<uint32_t>> byPartition(partitions);
+        Report report;
+
+        // one pass in log order to replay the top of the tree
+        for (std::size_t i = 0; i < events.size(); ++i) {
+            const LearnEvent& event = events[i];
+            if (event.path.size() >= splitDepth) {
+                // a deeper event is only valid if, at its point in the log, the top of the tree already had questions all the way down its path;
+                // later events may still add them, so this has to be checked now rather than in the subtree
+                const Node* current = tree.getRoot();
+                std::size_t partition = 0;
+                for (std::size_t d = 0; d < splitDepth && current; ++d) {
+                    current = current->isLeaf() ? nullptr : (event.path[d] == 'y' ? current->yes.get() : current->no.get());
+                    partition = partition << 1 | (event.path[d] == 'y');
+                }
+                if (current) byPartition[partition].push_back(static_cast<uint32_t>(i));
+                else ++report.skipped;
+                continue;
+            }
+            Node* leaf = leafAt(tree.getRoot(), event.path, 0);
+            if (!leaf) {
+                ++report.skipped;
+                continue;
+            }
+            AnimalTree::split(leaf, 0, event.animal, event.newAnimalIsYes);
+            splitAt[i] = leaf;
+            ++report.applied;
+        }
+
+        // the largest subtrees go first, so one big subtree does not start last and leave the other threads idle
+        std::vector<std::size_t> order(partitions);
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return byPartition[a].size() > byPartition[b].size(); });
+
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> applied{0}, skipped{0};
+        auto work = [&] {
+            std::size_t localApplied = 0, localSkipped = 0;
+            for (std::size_t k = next.fetch_add(1, std::memory_order_relaxed); k < partitions; k = next.fetch_add(1, std::memory_order_relaxed)) {
+                const auto& indices = byPartition[order[k]];
+                if (indices.empty()) break;
+                // every event here was checked to pass through questions down to splitDepth, so this walk never meets a leaf
+                Node* subtree = tree.getRoot();
+                const std::string& prefix = events[indices.front()].path;
+                for (std::size_t d = 0; d < splitDepth; ++d) subtree = prefix[d] == 'y' ? subtree->yes.get() : subtree->no.get();
+                for (uint32_t i : indices) {
+                    Node* leaf = leafAt(subtree, events[i].path, splitDepth);
+                    if (!leaf) {
+                        ++localSkipped;
+                        continue;
+                    }
+                    AnimalTree::split(leaf, 0, events[i].animal, events[i].newAnimalIsYes);
+                    splitAt[i] = leaf;
+                    ++localApplied;
+                }
+            }
+            applied += localApplied;
+            skipped += localSkipped;
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < std::max(threads, 1u); ++t) workers.emplace_back(work);
+        work();
+        for (auto& worker : workers) worker.join();
+
+        // interning only the applied events' questions, in log order, gives every question the id the sequential replay gives it,
+        // which a skipped event's question would otherwise take
+        for (std::size_t i = 0; i < events.size(); ++i) {
+            if (splitAt[i]) splitAt[i]->question = tree.internQuestion(events[i].question);
+        }
+        tree.refreshAnswers();
+        report.applied += applied;
+        report.skipped += skipped;
+        return report;
+    }
+};
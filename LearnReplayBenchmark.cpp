@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LearnReplay.h"
+#include "PerfCounters.h"
+
+static constexpr int kEvents = 1000000;
+
+/**
+ * @brief plays a long game history into a tree, recording every learn as an event, with a few events that could never happen mixed in
+ */
+static std::vector<LearnEvent> generateLog(AnimalTree& tree) {
+    std::vector<LearnEvent> events;
+    events.reserve(kEvents);
+    std::mt19937 rng(7);
+    for (int i = 0; i < kEvents; ++i) {
+        LearnEvent event;
+        Node* leaf = tree.getRoot();
+        while (!leaf->isLeaf()) {
+            bool yes = rng() & 1;
+            event.path.push_back(yes ? 'y' : 'n');
+            leaf = yes ? leaf->yes.get() : leaf->no.get();
+        }
+        event.animal = "Animal " + std::to_string(i);
+        event.question = "Question " + std::to_string(rng() % 4096) + "?";
+        event.newAnimalIsYes = rng() & 1;
+        tree.learn(leaf, event.animal, event.question, event.newAnimalIsYes);
+        events.push_back(event);
+        // now and then a corrupted entry: a path that stops at a question or runs past a leaf, with a question no good entry asks,
+        // which a replay must not give an id to
+        if (i % 1000 == 999) {
+            if (rng() & 1) event.path.pop_back();
+            else event.path += "yy";
+            event.animal += " (bad)";
+            event.question = "Bad question " + std::to_string(i) + "?";
+            events.push_back(std::move(event));
+        }
+    }
+    return events;
+}
+
+/**
+ * @brief true if two trees gave the same ids to the same questions
+ */
+static bool sameQuestions(const AnimalTree& a, const AnimalTree& b) {
+    const QuestionPool& first = a.questions();
+    const QuestionPool& second = b.questions();
+    if (first.questionCount() != second.questionCount()) return false;
+    for (uint32_t id = 0; id < first.questionCount(); ++id) {
+        if (first.question(id) != second.question(id)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief times one replay and checks its tree against the one the events were recorded from
+ * @return true if the replay built the same tree, with the same question ids
+ */
+template <typename Replay>
+static bool runCase(const std::string& label, const AnimalTree& original, uint64_t expected, std::size_t events, Replay replay) {
+    AnimalTree tree;
+    PerfCounters counters;
+    auto start = std::chrono::steady_clock::now();
+    counters.start();
+    LearnReplay::Report report = replay(tree);
+    counters.stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    bool same = tree.structuralHash() == expected;
+    bool questions = sameQuestions(tree, original);
+    std::cout << label << ": " << seconds << " s, " << static_cast<double>(events) / seconds / 1e6 << " M events/s, " << report.applied
+              << " applied, " << report.skipped << " skipped, tree " << (same ? "identical" : "DIFFERENT") << ", question ids "
+              << (questions ? "identical" : "DIFFERENT") << "\n";
+    counters.print(std::cout);
+    return same && questions;
+}
+
+int main() {
+    AnimalTree original;
+    std::vector<LearnEvent> events = generateLog(original);
+    const uint64_t expected = original.structuralHash();
+    TreeStats stats = original.stats();
+    std::cout << events.size() << " learn events, " << stats.animals << " animals, average depth " << stats.averageDepth << ", deepest "
+              << stats.maxDepth << "\n";
+
+    // the log survives a round trip through its text form
+    std::stringstream text;
+    for (const LearnEvent& event : events) LearnLog::write(text, event);
+    std::vector<LearnEvent> reread;
+    bool roundTrip = LearnLog::read(text, reread) && reread.size() == events.size();
+    for (std::size_t i = 0; roundTrip && i < events.size(); ++i) {
+        roundTrip = reread[i].path == events[i].path && reread[i].animal == events[i].animal && reread[i].question == events[i].question &&
+                    reread[i].newAnimalIsYes == events[i].newAnimalIsYes;
+    }
+    std::cout << "log text round trip: " << (roundTrip ? "ok" : "FAILED") << "\n";
+
+    bool same = roundTrip;
+    same &= runCase("sequential", original, expected, events.size(), [&](AnimalTree& tree) { return LearnReplay::sequential(tree, events); });
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts{1, 2, 4};
+    if (cores > 4) threadCounts.push_back(cores);
+    for (unsigned threads : threadCounts) {
+        same &= runCase("parallel, " + std::to_string(threads) + " thread(s)", original, expected, events.size(),
+                        [&](AnimalTree& tree) { return LearnReplay::parallel(tree, events, threads); });
+    }
+    // cutting shallower than the log reaches in its first events still has to give the same tree
+    same &= runCase("parallel, split at depth 2", original, expected, events.size(), [&](AnimalTree& tree) { return LearnReplay::parallel(tree, events, 4, 2); });
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
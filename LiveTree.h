@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AnimalTree.h"
+
+/**
+ * @struct TreeVersion
+ * @brief one published question tree, which is never changed again once it is published
+ */
+struct TreeVersion {
+    uint64_t number;
+    AnimalTree tree;
+};
+
+/**
+ * @class LiveTree
+ * @brief the question tree a server is playing right now, which can be replaced by a new one without stopping any game
+ *
+ * A session pins the current version when it starts by holding a shared_ptr to it, and walks that version's nodes with plain pointers until it ends,
+ * so traversal never touches anything shared between threads
+ * A new tree is loaded into its own AnimalTree off to the side and then published with one atomic store: sessions that start afterwards get
+ * the new version, and sessions already running finish on the one they pinned
+ *
+ * Replaced versions are not destroyed by whichever session happens to let go of them last, since tearing down a big tree would stall that game;
+ * they are kept on a retired list and destroyed by collect(), which the reloading thread calls after publishing
+ */
+class LiveTree {
+    std::atomic<std::shared_ptr<const TreeVersion>> published;
+    std::mutex writer;
+    std::vector<std::shared_ptr<const TreeVersion>> retired;
+    uint64_t versions = 0;
+
+public:
+    /**
+     * @brief starts out playing the initial two-animal tree as version 1
+     */
+    LiveTree() { publish(AnimalTree{}); }
+
+    /**
+     * @brief pins the current version for a new session, which keeps it alive for as long as the returned pointer is held
+     */
+    std::shared_ptr<const TreeVersion> acquire() const { return published.load(std::memory_order_acquire); }
+
+    /**
+     * @brief makes a tree the current version, for every session that starts from now on
+     * @return the number of the new version
+     */
+    uint64_t publish(AnimalTree tree) {
+        std::lock_guard<std::mutex> lock(writer);
+        auto version = std::make_shared<const TreeVersion>(TreeVersion{++versions, std::move(tree)});
+        auto previous = published.exchange(std::move(version), std::memory_order_acq_rel);
+        if (previous) retired.push_back(std::move(previous));
+        return versions;
+    }
+
+    /**
+     * @brief reads a tree written by AnimalTree::save() and publishes it
+     * @return false if the stream did not hold a complete tree, in which case the current version stays
+     */
+    bool reload(std::istream& in) {
+        AnimalTree tree;
+        if (!tree.load(in)) return false;
+        publish(std::move(tree));
+        collect();
+        return true;
+    }
+
+    /**
+     * @brief loads and publishes a tree file on a thread of its own, so the caller and every session carry on meanwhile
+     * @return becomes true once the new version is published, or false if the file could not be read
+     */
+    std::future<bool> reloadInBackground(std::string path) {
+        return std::async(std::launch::async, [this, path = std::move(path)] {
+            std::ifstream file(path);
+            return file && reload(file);
+        });
+    }
+
+    /**
+     * @brief destroys the retired versions that no session is playing anymore
+     * A retired version can never be pinned again, so once the retired list holds its only reference it is safe to destroy
+     * @return the number of retired versions still in use
+     */
+    std::size_t collect() {
+        std::vector<std::shared_ptr<const TreeVersion>> unused;
+        {
+            std::lock_guard<std::mutex> lock(writer);
+            auto inUse = std::partition(retired.begin(), retired.end(), [](const auto& version) { return version.use_count() > 1; });
+            unused.assign(std::make_move_iterator(inUse), std::make_move_iterator(retired.end()));
+            retired.erase(inUse, retired.end());
+        }
+        // the trees are destroyed here, after the lock is released, so publishing is never held up behind a teardown
+        unused.clear();
+        std::lock_guard<std::mutex> lock(writer);
+        return retired.size();
+    }
+};
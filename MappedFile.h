@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @class MappedFile
+ * @brief a whole file mapped into memory with MAP_SHARED, so every process forked afterwards reads and writes the same pages
+ * Writes land in the page cache and reach the file without any copy; flush() waits until they are on disk
+ */
+class MappedFile {
+    int fd = -1;
+    void* address = nullptr;
+    std::size_t length = 0;
+
+    static std::runtime_error failure(const std::string& what, const std::string& path) {
+        return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+    }
+
+    MappedFile(int fd, std::size_t length, bool writable, const std::string& path) : fd(fd), length(length) {
+        if (length == 0) return;
+        int protection = PROT_READ | (writable ? PROT_WRITE : 0);
+        address = mmap(nullptr, length, protection, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            address = nullptr;
+            ::close(fd);
+            throw failure("cannot map", path);
+        }
+        madvise(address, length, MADV_SEQUENTIAL);
+    }
+
+public:
+    /**
+     * @brief maps an existing file, read-only unless writable is set
+     * @throws std::runtime_error if the file cannot be opened or mapped
+     */
+    static MappedFile open(const std::string& path, bool writable) {
+        int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd < 0) throw failure("cannot open", path);
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw failure("cannot stat", path);
+        }
+        return MappedFile(fd, static_cast<std::size_t>(info.st_size), writable, path);
+    }
+
+    /**
+     * @brief creates (or truncates) a file of the given size and maps it writable
+     * @throws std::runtime_error if the file cannot be created, sized or mapped
+     */
+    static MappedFile create(const std::string& path, std::size_t bytes) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) throw failure("cannot create", path);
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            throw failure("cannot size", path);
+        }
+        return MappedFile(fd, bytes, true, path);
+    }
+
+    /**
+     * @brief maps a file through a descriptor that is already open, such as a memory file (memfd) passed from another process
+     * The mapping takes over the descriptor and closes it when it goes
+     * @throws std::runtime_error if the file cannot be mapped
+     */
+    static MappedFile adopt(int fd, bool writable, const std::string& name) {
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw failure("cannot stat", name);
+        }
+        return MappedFile(fd, static_cast<std::size_t>(info.st_size), writable, name);
+    }
+
+    // maps nothing until another mapping is moved into it
+    MappedFile() = default;
+    MappedFile(MappedFile&& other) noexcept
+        : fd(std::exchange(other.fd, -1)), address(std::exchange(other.address, nullptr)), length(std::exchange(other.length, 0)) {}
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        std::swap(fd, other.fd);
+        std::swap(address, other.address);
+        std::swap(length, other.length);
+        return *this;
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (address) munmap(address, length);
+        if (fd >= 0) ::close(fd);
+    }
+
+    void flush() {
+        if (address && msync(address, length, MS_SYNC) != 0) throw std::runtime_error(std::string("msync failed: ") + std::strerror(errno));
+    }
+
+    /**
+     * @brief tells the kernel how the pages will be read, e.g. MADV_RANDOM for lookups that should not read ahead
+     */
+    void advise(int advice) const {
+        if (address) madvise(address, length, advice);
+    }
+
+    template <typename T>
+    T* as() const { return static_cast<T*>(address); }
+    std::size_t size() const { return length; }
+    int descriptor() const { return fd; }
+};
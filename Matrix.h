@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "Monoid.h"
+
+/**
+ * @struct StandardSemiring
+ * @brief ordinary addition and multiplication, for counting paths or computing linear recurrences
+ */
+template <typename T>
+struct StandardSemiring {
+    using value_type = T;
+    static T zero() { return T{0}; }
+    static T one() { return T{1}; }
+    static T add(T a, T b) { return a + b; }
+    static T mul(T a, T b) { return a * b; }
+};
+
+/**
+ * @struct MinPlusSemiring
+ * @brief the tropical semiring, where "addition" is min and "multiplication" is +
+ * Raising a graph's weight matrix to the kth power in this semiring gives the cheapest path using exactly k edges
+ * Infinity marks a missing edge, so T should be a floating point type
+ */
+template <typename T>
+struct MinPlusSemiring {
+    using value_type = T;
+    static T zero() { return std::numeric_limits<T>::infinity(); }
+    static T one() { return T{0}; }
+    static T add(T a, T b) { return std::min(a, b); }
+    static T mul(T a, T b) { return a + b; }
+};
+
+/**
+ * @class Matrix
+ * @brief a square matrix stored row by row, with multiplication defined by a semiring
+ *
+ * Multiplication works on kBlock x kBlock tiles so the rows of all three matrices being read and written stay in cache together
+ * The innermost loop runs along contiguous rows, which lets the compiler vectorize it for both semirings above
+ */
+template <typename Semiring>
+class Matrix {
+public:
+    using value_type = typename Semiring::value_type;
+    static constexpr std::size_t kBlock = 32;
+
+private:
+    std::size_t n;
+    std::vector<value_type> cells;
+
+public:
+    /**
+     * @brief creates an n x n matrix with every cell set to the semiring's zero
+     */
+    explicit Matrix(std::size_t n) : n(n), cells(n * n, Semiring::zero()) {}
+
+    static Matrix identity(std::size_t n) {
+        Matrix result(n);
+        for (std::size_t i = 0; i < n; ++i) result(i, i) = Semiring::one();
+        return result;
+    }
+
+    std::size_t size() const { return n; }
+
+    value_type& operator()(std::size_t row, std::size_t column) { return cells[row * n + column]; }
+    const value_type& operator()(std::size_t row, std::size_t column) const { return cells[row * n + column]; }
+
+    bool operator==(const Matrix& other) const = default;
+
+    /**
+     * @brief multiplies two matrices of the same size with a cache-blocked i-k-j loop
+     * @throws std::invalid_argument if the sizes differ
+     */
+    friend Matrix operator*(const Matrix& a, const Matrix& b) {
+        if (a.n != b.n) throw std::invalid_argument("Matrix: cannot multiply matrices of different sizes");
+        const std::size_t n = a.n;
+        Matrix c(n);
+        for (std::size_t ii = 0; ii < n; ii += kBlock) {
+            std::size_t iEnd = std::min(ii + kBlock, n);
+            for (std::size_t kk = 0; kk < n; kk += kBlock) {
+                std::size_t kEnd = std::min(kk + kBlock, n);
+                for (std::size_t jj = 0; jj < n; jj += kBlock) {
+                    std::size_t jEnd = std::min(jj + kBlock, n);
+                    for (std::size_t i = ii; i < iEnd; ++i) {
+                        value_type* cRow = &c.cells[i * n];
+                        for (std::size_t k = kk; k < kEnd; ++k) {
+                            const value_type aik = a.cells[i * n + k];
+                            const value_type* bRow = &b.cells[k * n];
+                            for (std::size_t j = jj; j < jEnd; ++j) {
+                                cRow[j] = Semiring::add(cRow[j], Semiring::mul(aik, bRow[j]));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return c;
+    }
+};
+
+template <typename Semiring>
+struct MonoidTraits<Matrix<Semiring>> {
+    static Matrix<Semiring> identity(const Matrix<Semiring>& like) { return Matrix<Semiring>::identity(like.size()); }
+};
@@ -0,0 +1,201 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AnimalEngine.h"
+#include "AnimalMetadata.h"
+#include "AnimalTree.h"
+#include "PerfCounters.h"
+
+// every allocation in the program is counted, so the heap a tree holds can be read off before and after building it
+// (the bytes requested, not counting the allocator's own headers and rounding)
+static std::size_t liveBytes = 0;
+
+void* operator new(std::size_t size) {
+    auto* block = static_cast<std::max_align_t*>(std::malloc(size + sizeof(std::max_align_t)));
+    if (!block) throw std::bad_alloc();
+    *reinterpret_cast<std::size_t*>(block) = size;
+    liveBytes += size;
+    return block + 1;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer) return;
+    auto* block = static_cast<std::max_align_t*>(pointer) - 1;
+    liveBytes -= *reinterpret_cast<std::size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept { operator delete(pointer); }
+
+static constexpr int kAnimals = 200000;
+static constexpr int kWalks = 2000000;
+static const char* kMetadataPath = "MetadataBenchmark.meta";
+
+/**
+ * @class RichAnimal
+ * @brief an animal carrying its metadata in the leaf itself, the layout the metadata file avoids
+ */
+class RichAnimal : public Animal {
+    std::string name;
+
+public:
+    AnimalMetadata metadata;
+
+    RichAnimal(std::string name, AnimalMetadata metadata) : name(std::move(name)), metadata(std::move(metadata)) {}
+    std::string getName() const override { return name; }
+};
+
+static std::string animalName(int i) { return "Animal " + std::to_string(i); }
+
+// a few hundred bytes of made-up but distinct metadata per animal, about what a short encyclopedia entry holds
+static AnimalMetadata metadataFor(int i) {
+    std::mt19937 rng(static_cast<unsigned>(i));
+    AnimalMetadata metadata;
+    metadata.description = "Animal " + std::to_string(i) + " is a";
+    for (int words = 30 + static_cast<int>(rng() % 20); words > 0; --words) metadata.description += " word" + std::to_string(rng() % 1000);
+    metadata.description += ".";
+    for (int a = static_cast<int>(rng() % 4); a > 0; --a) metadata.aliases.push_back("Alias " + std::to_string(rng() % 100000) + " of " + std::to_string(i));
+    for (int m = 1 + static_cast<int>(rng() % 3); m > 0; --m) {
+        metadata.images.push_back("images/animal-" + std::to_string(i) + "-" + std::to_string(m) + ".jpg");
+    }
+    return metadata;
+}
+
+static bool same(const AnimalMetadata& a, const AnimalMetadata& b) {
+    return a.description == b.description && a.aliases == b.aliases && a.images == b.images;
+}
+
+/**
+ * @brief grows a tree of kAnimals animals, learned at random leaves, optionally putting each animal's metadata in its leaf as it is learned,
+ * so the metadata is allocated among the nodes the way it would be if the game kept it there
+ */
+static std::unique_ptr<AnimalTree> grow(bool inlineMetadata) {
+    auto tree = std::make_unique<AnimalTree>();
+    std::mt19937 rng(99);
+    if (inlineMetadata) {
+        tree->getRoot()->yes->animal = std::make_unique<RichAnimal>("Dog", AnimalMetadata{});
+        tree->getRoot()->no->animal = std::make_unique<RichAnimal>("Snake", AnimalMetadata{});
+    }
+    for (int i = 0; i < kAnimals; ++i) {
+        Node* leaf = tree->getRoot();
+        while (!leaf->isLeaf()) leaf = (rng() & 1) ? leaf->yes.get() : leaf->no.get();
+        bool yes = rng() & 1;
+        // learning moves the old animal, metadata and all, into its new leaf
+        tree->learn(leaf, animalName(i), "Question " + std::to_string(i % 1024) + "?", yes);
+        if (inlineMetadata) (yes ? leaf->yes : leaf->no)->animal = std::make_unique<RichAnimal>(animalName(i), metadataFor(i));
+    }
+    return tree;
+}
+
+/**
+ * @brief times kWalks games' worth of traversal, each from the root to a leaf along precomputed random answers,
+ * naming the animal at the end the way a guess does; lookup is then called with the leaf and that name
+ */
+template <typename Lookup>
+static std::size_t runCase(const std::string& label, const AnimalTree& tree, const std::vector<uint64_t>& answers, Lookup lookup) {
+    std::size_t checksum = 0;
+    PerfCounters counters;
+    auto start = std::chrono::steady_clock::now();
+    counters.start();
+    for (int walk = 0; walk < kWalks; ++walk) {
+        uint64_t bits = answers[walk];
+        const Node* at = tree.getRoot();
+        while (!at->isLeaf()) {
+            checksum += at->question;
+            at = (bits & 1) ? at->yes.get() : at->no.get();
+            bits = bits >> 1 | bits << 63;
+        }
+        std::string name = at->animal->getName();
+        checksum += name.size() + lookup(at, name);
+    }
+    counters.stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << label << ": " << seconds * 1e9 / kWalks << " ns per game\n  ";
+    counters.print(std::cout);
+    return checksum;
+}
+
+int main() {
+    int problems = 0;
+    try {
+        std::vector<std::pair<std::string, AnimalMetadata>> records;
+        for (int i = 0; i < kAnimals; ++i) records.emplace_back(animalName(i), metadataFor(i));
+        auto start = std::chrono::steady_clock::now();
+        MetadataFile::write(kMetadataPath, records);
+        double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::size_t before = liveBytes;
+        auto compact = grow(false);
+        std::size_t compactBytes = liveBytes - before;
+        before = liveBytes;
+        auto rich = grow(true);
+        std::size_t richBytes = liveBytes - before;
+
+        start = std::chrono::steady_clock::now();
+        MetadataFile file = MetadataFile::open(kMetadataPath);
+        double openMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::FILE* stream = std::fopen(kMetadataPath, "rb");
+        std::fseek(stream, 0, SEEK_END);
+        long fileBytes = std::ftell(stream);
+        std::fclose(stream);
+
+        std::cout << kAnimals << " animals, " << kWalks << " games per case\n"
+                  << "tree with names only:       " << compactBytes / 1e6 << " MB of heap\n"
+                  << "tree with metadata inline:  " << richBytes / 1e6 << " MB of heap\n"
+                  << "metadata file:              " << fileBytes / 1e6 << " MB, written in " << writeSeconds << " s, opened in " << openMicros
+                  << " us\n";
+
+        std::mt19937_64 rng(99);
+        std::vector<uint64_t> answers(kWalks);
+        for (auto& bits : answers) bits = rng();
+        auto none = [](const Node*, const std::string&) { return std::size_t{0}; };
+        // both ways of reading a guess's metadata copy it out, as the game does before printing it
+        AnimalMetadata details;
+        auto fromFile = [&](const Node*, const std::string& name) {
+            if (!file.find(name, details)) return std::size_t{0};
+            return details.description.size();
+        };
+        auto fromLeaf = [&](const Node* leaf, const std::string&) {
+            const auto* animal = dynamic_cast<const RichAnimal*>(leaf->animal.get());
+            if (!animal) return std::size_t{0};
+            details = animal->metadata;
+            return details.description.size();
+        };
+
+        std::size_t plain = runCase("names only, no metadata", *compact, answers, none);
+        std::size_t open = runCase("names only, metadata file open but not read", *compact, answers, none);
+        std::size_t inlined = runCase("metadata inline in the leaves, not read", *rich, answers, none);
+        std::size_t filed = runCase("names only, metadata read from the file at every guess", *compact, answers, fromFile);
+        std::size_t leafed = runCase("metadata inline, read from the leaf at every guess", *rich, answers, fromLeaf);
+        problems += plain != open || plain != inlined || filed != leafed;
+
+        // every record comes back as written, and an animal without one is reported as such
+        for (const auto& [name, metadata] : records) problems += !file.find(name, details) || !same(details, metadata);
+        problems += file.find("Dog", details) || file.size() != records.size();
+
+        // the engine reads the same file on demand, and a file that is not metadata is refused
+        AnimalEngine engine;
+        problems += engine.metadata(animalName(7), details);
+        engine.openMetadata(kMetadataPath);
+        problems += !engine.metadata(animalName(7), details) || !same(details, records[7].second) || engine.metadata("Dog", details);
+        try {
+            MetadataFile::open("CMakeCache.txt");
+            ++problems;
+        } catch (const std::runtime_error&) {
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        ++problems;
+    }
+    std::remove(kMetadataPath);
+    std::cout << (problems ? std::to_string(problems) + " problem(s) found" : std::string("every metadata record matched what was written")) << "\n";
+    return problems ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <concepts>
+#include <type_traits>
+
+/**
+ * @struct MonoidTraits
+ * @brief tells generic code how to build the multiplicative identity of a type
+ *
+ * The identity is built from an existing value so types whose identity depends on a runtime size, like an n x n matrix, can be supported
+ * Arithmetic types use 1; other types specialize this struct next to their definition
+ */
+template <typename T>
+struct MonoidTraits {
+    static T identity(const T&) { return T{1}; }
+};
+
+/**
+ * @concept MultiplicativeMonoid
+ * @brief a type with an associative operator* and an identity element provided by MonoidTraits
+ * Associativity cannot be checked by the compiler, it is a promise made by the type
+ */
+template <typename T>
+concept MultiplicativeMonoid = std::copyable<T> && requires(const T& a, const T& b) {
+    { a * b } -> std::convertible_to<T>;
+    { MonoidTraits<T>::identity(a) } -> std::convertible_to<T>;
+};
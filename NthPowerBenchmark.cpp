@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "LatencyHistogram.h"
+#include "Matrix.h"
+#include "Nth_Power.h"
+#include "PerfCounters.h"
+#include "PowerSums.h"
+#include "PoweredView.h"
+
+/**
+ * @brief runs the Nth_Power batch kernel over one buffer size and exponent
+ * Every thread records its own batch latencies into a private histogram, which are merged into a single report at the end
+ * The merged percentiles are printed once per case so tail latency is visible next to the median, followed by the hardware counters for the case
+ */
+static void runCase(int power, std::size_t batchSize, int batches, unsigned threads) {
+    PerfCounters counters;
+    std::vector<LatencyHistogram> perThread(threads);
+    std::vector<std::thread> workers;
+    Nth_Power kernel{power};
+
+    counters.start();
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::vector<int> in(batchSize), out(batchSize);
+            std::iota(in.begin(), in.end(), 1);
+            for (int b = 0; b < batches; ++b) {
+                ScopedLatency timer(perThread[t]);
+                kernel.apply(in.data(), out.data(), batchSize);
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    counters.stop();
+
+    LatencyHistogram merged;
+    for (const auto& histogram : perThread) merged.merge(histogram);
+    merged.printPercentiles(std::cout, "power=" + std::to_string(power) + (kernel.isSpecialized() ? " specialized" : " generic") +
+                                           " batch=" + std::to_string(batchSize));
+    counters.print(std::cout);
+}
+
+/**
+ * @brief times raising a random size x size matrix to a power in the given semiring
+ * Each repetition is one full Nth_Power call, so the histogram shows the latency of a whole exponentiation by squaring
+ */
+template <typename Semiring>
+static void runMatrixCase(const std::string& semiring, std::size_t size, int power, int repetitions) {
+    using Value = typename Semiring::value_type;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> weights(0, 9);
+    Matrix<Semiring> m(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        for (std::size_t j = 0; j < size; ++j) m(i, j) = static_cast<Value>(weights(rng));
+    }
+
+    PerfCounters counters;
+    LatencyHistogram histogram;
+    Nth_Power<Matrix<Semiring>> kernel{power};
+    Value checksum{};
+    counters.start();
+    for (int r = 0; r < repetitions; ++r) {
+        ScopedLatency timer(histogram);
+        checksum = checksum + kernel(m)(0, size - 1);
+    }
+    counters.stop();
+
+    histogram.printPercentiles(std::cout, semiring + " " + std::to_string(size) + "x" + std::to_string(size) + " ^" + std::to_string(power));
+    counters.print(std::cout);
+    if (checksum == Value{1}) std::cout << "  (checksum collision)\n";
+}
+
+/**
+ * @brief times one way of reducing a buffer to power sums, and prints its throughput and result next to the counters
+ */
+static void runReductionCase(const std::string& label, std::size_t count, int repetitions, const std::function<double()>& body) {
+    PerfCounters counters;
+    double result = 0.0;
+    counters.start();
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; ++r) result = body();
+    auto end = std::chrono::steady_clock::now();
+    counters.stop();
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    std::cout << "  " << label << ": " << static_cast<double>(count) * repetitions / seconds / 1e6 << " Mvalues/s, result " << result << "\n";
+    counters.print(std::cout);
+}
+
+/**
+ * @brief compares materializing x^n and then summing against the fused PowerSums reductions
+ * The data has a large mean and a small spread, where plain summation of raw moments loses the most precision,
+ * so the variance from plain and compensated sums is printed next to the one computed directly from the data in long double
+ */
+static void runReductionCases(unsigned threads) {
+    constexpr std::size_t kCount = 1 << 22;
+    constexpr int kRepetitions = 20;
+    std::mt19937 rng(11);
+    std::normal_distribution<double> values(1000.0, 1.0);
+    std::vector<double> data(kCount);
+    for (double& x : data) x = values(rng);
+    std::vector<double> scratch(kCount);
+    Nth_Power<double> square{2};
+
+    std::cout << "Power sums over " << kCount << " doubles\n";
+    runReductionCase("materialize x^2 then sum", kCount, kRepetitions, [&] {
+        square.apply(data.data(), scratch.data(), kCount);
+        return std::accumulate(scratch.begin(), scratch.end(), 0.0);
+    });
+    runReductionCase("fused sum x^2", kCount, kRepetitions, [&] { return PowerSums::sum(data.data(), kCount, square); });
+    runReductionCase("fused sum x^2 compensated", kCount, kRepetitions,
+                     [&] { return PowerSums::sum(data.data(), kCount, square, Summation::Compensated); });
+    runReductionCase("four separate sums x..x^4", kCount, kRepetitions, [&] {
+        std::array<double, 4> sums{};
+        for (int n = 1; n <= 4; ++n) sums[n - 1] = PowerSums::sum(data.data(), kCount, Nth_Power<double>{n});
+        return sums[3];
+    });
+    runReductionCase("one pass sums x..x^4", kCount, kRepetitions, [&] { return PowerSums::sums<4>(data.data(), kCount)[3]; });
+    runReductionCase("one pass sums x..x^4 compensated", kCount, kRepetitions,
+                     [&] { return PowerSums::sums<4>(data.data(), kCount, Summation::Compensated)[3]; });
+    runReductionCase("parallel sums x..x^4, " + std::to_string(threads) + " thread(s)", kCount, kRepetitions,
+                     [&] { return PowerSums::parallelSums<4>(data.data(), kCount, threads)[3]; });
+
+    long double mean = 0.0L;
+    for (double x : data) mean += x;
+    mean /= kCount;
+    long double variance = 0.0L;
+    for (double x : data) variance += (x - mean) * (x - mean);
+    variance /= kCount;
+    Moments plain = PowerSums::moments(PowerSums::sums<4>(data.data(), kCount), kCount);
+    Moments compensated = PowerSums::moments(PowerSums::sums<4>(data.data(), kCount, Summation::Compensated), kCount);
+    auto precision = std::cout.precision(12);
+    std::cout << "  variance: exact " << static_cast<double>(variance) << ", plain " << plain.variance << ", compensated "
+              << compensated.variance << "\n";
+    std::cout.precision(precision);
+}
+
+/**
+ * @brief checks that sum() and sums() agree on buffers whose powers do not fit in the element type, which both must compute in the wider sum type
+ * @return the number of sums that disagree
+ */
+template <typename T>
+static int checkNarrowSums(const std::string& label, const std::vector<T>& values) {
+    auto together = PowerSums::sums<4>(values.data(), values.size());
+    int mismatches = 0;
+    for (int n = 1; n <= 4; ++n) {
+        auto alone = PowerSums::sum(values.data(), values.size(), Nth_Power<T>{n});
+        if (alone != together[n - 1]) {
+            std::cout << "  " << label << ": sum of x^" << n << " is " << alone << " alone but " << together[n - 1] << " from sums()\n";
+            ++mismatches;
+        }
+    }
+    if (mismatches == 0) std::cout << "  " << label << ": sum() and sums() agree\n";
+    return mismatches;
+}
+
+/**
+ * @brief compares the unchecked batch kernel against applyChecked() on int64_t values of which roughly one in a hundred overflows,
+ * and checks every reported overflow against multiplication with overflow detection
+ */
+static void runCheckedCase(int power) {
+    constexpr std::size_t kCount = 1 << 16;
+    constexpr int kRepetitions = 200;
+    Nth_Power<int64_t> kernel{power};
+    std::mt19937_64 rng(power);
+    // most values are inside the safe range and a few just beyond it, on both sides
+    int64_t limit = kernel.maxSafeInput();
+    std::uniform_int_distribution<int64_t> inside(-limit, limit);
+    std::uniform_int_distribution<int64_t> beyond(limit + 1, limit + 1 + limit / 8);
+    std::vector<int64_t> in(kCount), out(kCount);
+    for (int64_t& x : in) x = rng() % 100 == 0 ? (rng() % 2 ? beyond(rng) : -beyond(rng)) : inside(rng);
+    std::vector<uint64_t> mask((kCount + 63) / 64);
+
+    auto throughput = [&](const std::string& label, auto body) {
+        auto begin = std::chrono::steady_clock::now();
+        for (int r = 0; r < kRepetitions; ++r) body();
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - begin).count();
+        std::cout << "  power=" << power << " " << label << ": " << static_cast<double>(kCount) * kRepetitions / seconds / 1e6 << " Mvalues/s\n";
+    };
+    throughput("unchecked", [&] { kernel.apply(in.data(), out.data(), kCount); });
+    std::size_t firstOverflow = 0;
+    throughput("first overflow only", [&] { firstOverflow += kernel.applyChecked(in.data(), out.data(), kCount); });
+    throughput("overflow mask", [&] { kernel.applyChecked(in.data(), out.data(), kCount, mask.data()); });
+
+    std::size_t mismatches = 0;
+    std::size_t overflowed = 0;
+    for (std::size_t i = 0; i < kCount; ++i) {
+        int64_t result = 1;
+        bool expected = false;
+        for (int k = 0; k < power; ++k) expected |= __builtin_mul_overflow(result, in[i], &result);
+        bool reported = (mask[i / 64] >> (i % 64)) & 1u;
+        overflowed += reported;
+        mismatches += expected != reported;
+    }
+    std::cout << "  power=" << power << " " << overflowed << " overflows reported, first at " << firstOverflow / kRepetitions << ", "
+              << mismatches << " mismatches\n";
+}
+
+// the view keeps the capabilities of the range it wraps
+static_assert(std::ranges::random_access_range<PoweredView<std::ranges::ref_view<std::vector<int>>>>);
+static_assert(std::ranges::sized_range<PoweredView<std::ranges::ref_view<std::vector<int>>>>);
+static_assert(std::ranges::borrowed_range<PoweredView<std::ranges::ref_view<std::vector<int>>>>);
+static_assert(!std::ranges::borrowed_range<PoweredView<std::ranges::owning_view<std::vector<int>>>>);
+static_assert(std::ranges::forward_range<PoweredView<std::ranges::iota_view<int, int>>>);
+
+/**
+ * @brief compares ways of consuming v | powered(3): element by element through std::ranges::copy, through copyTo() which uses the batch kernel,
+ * and the same through a longer pipeline that is not contiguous, against std::transform with the functor
+ */
+static void runRangesCases() {
+    constexpr std::size_t kCount = 1 << 20;
+    constexpr int kRepetitions = 50;
+    std::vector<int> in(kCount), out(kCount), expected(kCount);
+    std::iota(in.begin(), in.end(), 1);
+    Nth_Power cube{3};
+    std::transform(in.begin(), in.end(), expected.begin(), cube);
+
+    auto throughput = [&](const std::string& label, auto body) {
+        std::fill(out.begin(), out.end(), 0);
+        auto begin = std::chrono::steady_clock::now();
+        for (int r = 0; r < kRepetitions; ++r) body();
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - begin).count();
+        std::cout << "  " << label << ": " << static_cast<double>(kCount) * kRepetitions / seconds / 1e6 << " Mvalues/s"
+                  << (out == expected ? "" : " (wrong result)") << "\n";
+    };
+
+    std::cout << "Ranges over " << kCount << " ints, cubed\n";
+    throughput("std::transform with the functor", [&] { std::transform(in.begin(), in.end(), out.begin(), cube); });
+    throughput("std::ranges::copy(v | powered(3))", [&] { std::ranges::copy(in | powered(3), out.begin()); });
+    throughput("(v | powered(3)).copyTo()", [&] { (in | powered(3)).copyTo(out.begin()); });
+
+    // reversing twice makes a pipeline that is no longer contiguous but visits the same values in the same order
+    auto pipeline = [&] { return in | std::views::reverse | std::views::reverse | powered(3); };
+    throughput("non-contiguous pipeline, std::ranges::copy", [&] { std::ranges::copy(pipeline(), out.begin()); });
+    throughput("non-contiguous pipeline, copyTo()", [&] { pipeline().copyTo(out.begin()); });
+
+    // a real exponent must reach the kernel as the double it was written as, not rounded to the element type first
+    std::vector<float> reals(kCount), viaView(kCount), viaKernel(kCount);
+    std::iota(reals.begin(), reals.end(), 1.0f);
+    (reals | powered(2.2)).copyTo(viaView.begin());
+    Nth_Power<float>{2.2}.apply(reals.data(), viaKernel.data(), kCount);
+    std::cout << "  float v | powered(2.2) " << (viaView == viaKernel ? "matches" : "differs from") << " Nth_Power<float>{2.2}\n";
+}
+
+/**
+ * @brief compares cached and streaming stores for squaring uint32_t buffers from well inside the last level cache to far beyond it,
+ * out of place and in place, reported as bandwidth with every value read once and written once
+ * Out of place, cached stores also read every destination line before writing it, so they move half as much data again through memory
+ */
+static void runStreamingCases() {
+    Nth_Power<uint32_t> square{2};
+    std::cout << "Streaming stores, threshold " << (StreamingStore::threshold() >> 20) << " MiB\n";
+    for (std::size_t megabytes : {std::size_t{4}, std::size_t{64}, std::size_t{512}}) {
+        std::size_t count = (megabytes << 20) / sizeof(uint32_t);
+        std::vector<uint32_t> in(count), out(count);
+        std::iota(in.begin(), in.end(), 0u);
+        int repetitions = static_cast<int>(std::max<std::size_t>(2, 2048 / megabytes));
+        for (bool inPlace : {false, true}) {
+            for (auto [mode, name] : {std::pair{StoreMode::Cached, "cached"}, std::pair{StoreMode::Streaming, "streaming"},
+                                      std::pair{StoreMode::Auto, "auto"}}) {
+                uint32_t* destination = inPlace ? in.data() : out.data();
+                square.apply(in.data(), destination, count, mode);
+                PerfCounters counters;
+                counters.start();
+                auto begin = std::chrono::steady_clock::now();
+                for (int r = 0; r < repetitions; ++r) square.apply(in.data(), destination, count, mode);
+                auto end = std::chrono::steady_clock::now();
+                counters.stop();
+                double seconds = std::chrono::duration<double>(end - begin).count();
+                double gigabytes = 2.0 * static_cast<double>(count * sizeof(uint32_t)) * repetitions / 1e9;
+                std::cout << "  " << megabytes << " MiB " << (inPlace ? "in place" : "out of place") << " " << name << ": "
+                          << gigabytes / seconds << " GB/s\n";
+                counters.print(std::cout);
+            }
+        }
+    }
+}
+
+int main() {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Nth_Power batch latency, " << threads << " thread(s)\n";
+    for (int power : {2, 3, 7, 64, 65}) {
+        for (std::size_t batchSize : {std::size_t{64}, std::size_t{4096}, std::size_t{262144}}) {
+            runCase(power, batchSize, batchSize > 4096 ? 50 : 2000, threads);
+        }
+    }
+
+    std::cout << "Matrix powers\n";
+    for (std::size_t size : {std::size_t{2}, std::size_t{8}, std::size_t{16}, std::size_t{32}, std::size_t{64}}) {
+        int repetitions = size <= 8 ? 20000 : static_cast<int>(2000000 / (size * size * size));
+        runMatrixCase<StandardSemiring<uint64_t>>("standard", size, 1000, repetitions);
+        runMatrixCase<MinPlusSemiring<double>>("min-plus", size, 1000, repetitions);
+    }
+
+    runReductionCases(threads);
+
+    std::cout << "Power sums whose terms overflow the element type\n";
+    int problems = checkNarrowSums("100000 ints of 100000", std::vector<int>(100000, 100000));
+    problems += checkNarrowSums("uint8_t {200, 100}", std::vector<uint8_t>{200, 100});
+    problems += checkNarrowSums("floats of 1e20", std::vector<float>(1000, 1e20f));
+
+    std::cout << "Overflow-checked batches over int64_t\n";
+    for (int power : {2, 3, 7, 21, 65}) runCheckedCase(power);
+
+    runRangesCases();
+
+    runStreamingCases();
+    return problems ? EXIT_FAILURE : EXIT_SUCCESS;
+}
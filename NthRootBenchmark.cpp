@@ -0,0 +1,125 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Nth_Root.h"
+#include "PerfCounters.h"
+
+/**
+ * @brief floor(x^(1/n)) by binary search over overflow-checked powers, slow but obviously correct
+ */
+static uint64_t referenceRoot(uint64_t x, int n) {
+    // r^n <= x, stopping as soon as the partial product passes x so it can never overflow
+    auto fits = [x, n](uint64_t r) {
+        if (r <= 1) return r <= x;
+        uint64_t result = 1;
+        for (int i = 0; i < n; ++i) {
+            if (result > x / r) return false;
+            result *= r;
+        }
+        return true;
+    };
+    if (n == 1) return x;
+    uint64_t low = 0;
+    uint64_t high = uint64_t{1} << 32;
+    while (low < high) {
+        uint64_t mid = low + (high - low + 1) / 2;
+        if (fits(mid)) low = mid;
+        else high = mid - 1;
+    }
+    return low;
+}
+
+/**
+ * @brief checks the scalar and batch roots against the reference around every r^n near both ends of the range, where the double estimate
+ * is most likely to round the wrong way, plus random values
+ * @return the number of mismatches, each of which is also printed
+ */
+static int verifyRoot(int n, std::mt19937_64& rng) {
+    constexpr uint64_t kBoundarySpan = 2000;
+    constexpr int kRandomValues = 20000;
+    Nth_Root<uint64_t> root{n};
+    Nth_Power<uint64_t> power{n};
+
+    std::vector<uint64_t> values{0, 1, 2, std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max() - 1};
+    auto addAround = [&](uint64_t r) {
+        uint64_t p = power(r);
+        values.push_back(p);
+        if (p > 0) values.push_back(p - 1);
+        if (p < std::numeric_limits<uint64_t>::max()) values.push_back(p + 1);
+    };
+    uint64_t largest = root.largestRoot();
+    for (uint64_t r = 0; r <= std::min(largest, kBoundarySpan); ++r) addAround(r);
+    for (uint64_t r = largest > kBoundarySpan ? largest - kBoundarySpan : 0;; ++r) {
+        addAround(r);
+        if (r == largest) break;
+    }
+    for (int i = 0; i < kRandomValues; ++i) values.push_back(rng() >> (rng() % 64));
+
+    std::vector<uint64_t> batch(values.size());
+    std::unique_ptr<bool[]> perfect(new bool[values.size()]);
+    root.apply(values.data(), batch.data(), values.size());
+    root.applyPerfect(values.data(), perfect.get(), values.size());
+
+    int failures = 0;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        uint64_t expected = referenceRoot(values[i], n);
+        bool expectedPerfect = power(expected) == values[i];
+        if (root(values[i]) != expected || batch[i] != expected || root.isPerfectPower(values[i]) != expectedPerfect ||
+            perfect[i] != expectedPerfect) {
+            if (++failures <= 5) {
+                std::cout << "  n=" << n << " x=" << values[i] << ": expected " << expected << ", scalar " << root(values[i]) << ", batch "
+                          << batch[i] << "\n";
+            }
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief times the batch root, the scalar root and the perfect-power test over random 64-bit values
+ */
+static void runCase(int n, const std::vector<uint64_t>& values, int repetitions) {
+    Nth_Root<uint64_t> root{n};
+    std::vector<uint64_t> out(values.size());
+    std::unique_ptr<bool[]> perfect(new bool[values.size()]);
+    auto throughput = [&](const std::string& label, auto body) {
+        PerfCounters counters;
+        counters.start();
+        auto begin = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; ++r) body();
+        auto end = std::chrono::steady_clock::now();
+        counters.stop();
+        double seconds = std::chrono::duration<double>(end - begin).count();
+        std::cout << "  n=" << n << " " << label << ": " << static_cast<double>(values.size()) * repetitions / seconds / 1e6 << " Mvalues/s\n";
+        counters.print(std::cout);
+    };
+
+    throughput("batch root", [&] { root.apply(values.data(), out.data(), values.size()); });
+    throughput("scalar root", [&] {
+        for (std::size_t i = 0; i < values.size(); ++i) out[i] = root(values[i]);
+    });
+    throughput("batch perfect-power test", [&] { root.applyPerfect(values.data(), perfect.get(), values.size()); });
+    throughput("std::pow estimate only (not exact)", [&] {
+        for (std::size_t i = 0; i < values.size(); ++i) out[i] = static_cast<uint64_t>(std::pow(static_cast<double>(values[i]), 1.0 / n));
+    });
+}
+
+int main() {
+    std::mt19937_64 rng(5);
+    std::cout << "Nth_Root exactness against a binary search reference\n";
+    int failures = 0;
+    for (int n = 1; n <= 64; ++n) failures += verifyRoot(n, rng);
+    std::cout << (failures == 0 ? "  all roots exact\n" : "  " + std::to_string(failures) + " mismatches\n");
+
+    std::vector<uint64_t> values(1 << 20);
+    for (uint64_t& x : values) x = rng() >> (rng() % 64);
+    std::cout << "Nth_Root throughput over " << values.size() << " random values\n";
+    for (int n : {2, 3, 5, 7, 64}) runCase(n, values, 10);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,415 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "FastPow.h"
+#include "Monoid.h"
+#include "StreamingStore.h"
+
+// powers from 0 up to this value get their own fully unrolled kernel, larger powers use the generic squaring loop
+#ifndef NTH_POWER_MAX_SPECIALIZED_POWER
+#define NTH_POWER_MAX_SPECIALIZED_POWER 64
+#endif
+
+/**
+ * @brief how Nth_Power::apply writes its results
+ * Cached uses ordinary stores, Streaming uses non-temporal stores (see StreamingStore), and Auto streams out-of-place results of at least
+ * StreamingStore::threshold() bytes, which do not fit in the cache anyway, and caches everything else
+ * apply() caches unless asked otherwise, since on one core streaming has measured slower than cached stores even far beyond the cache
+ */
+enum class StoreMode { Auto, Cached, Streaming };
+
+/**
+ * @class Nth_Power
+ * @brief a functor class to compute the nth power of a value of any multiplicative monoid, int by default.
+ *
+ * The class is initialized with an integer n, specifying the power to which values will be raised.
+ * The functor overloads the operator() method to compute and return the nth power of the input value.
+ * Powers are computed by repeated squaring, so x^n takes about 2*log2(n) multiplications instead of n
+ * Integers wrap around on overflow instead of going through floating point, so every result that fits in the type is exact
+ *
+ * For arithmetic types the constructor picks, once, a kernel compiled for its exact power (for powers up to kMaxSpecializedPower),
+ * so the multiplications are fully unrolled just as if n had been a template parameter, and the batch loop can be vectorized
+ * Other powers, and types like matrices where unrolling gains nothing, use the generic squaring loop
+ *
+ * Floating point types can also be raised to a real power, such as 2.2 for gamma correction, through FastPow at a chosen accuracy
+ */
+template <MultiplicativeMonoid T = int>
+class Nth_Power {
+public:
+    static constexpr int kMaxSpecializedPower = NTH_POWER_MAX_SPECIALIZED_POWER;
+
+private:
+    using ScalarKernel = T (*)(const T&, const Nth_Power&);
+    using BatchKernel = void (*)(const T*, T*, std::size_t, const Nth_Power&);
+    // a batch kernel that also sets flags[i] to 1 where in[i]^n overflows and to 0 elsewhere, see applyChecked()
+    using CheckedKernel = void (*)(const T*, T*, unsigned char*, std::size_t, const Nth_Power&);
+
+    // integers are multiplied in an unsigned type at least as wide as unsigned int, which wraps on overflow where signed
+    // arithmetic (including narrow unsigned types, which promote to int) would be undefined
+    template <typename V, bool = std::is_integral_v<V> && !std::is_same_v<V, bool>>
+    struct WorkType { using type = V; };
+    template <typename V>
+    struct WorkType<V, true> { using type = std::make_unsigned_t<std::common_type_t<V, unsigned int>>; };
+    using Work = typename WorkType<T>::type;
+
+    // only arithmetic types have a meaningful answer for negative powers
+    static constexpr bool kAllowsNegativePower = std::is_arithmetic_v<T>;
+
+    // integers between these bounds can be raised to the power without overflowing, see applyChecked()
+    using Bound = std::conditional_t<std::is_integral_v<T>, T, unsigned char>;
+
+    int n;
+    double realPower = 0.0;
+    // set only for a functor constructed with a real power
+    std::optional<PowAccuracy> realAccuracy;
+    ScalarKernel scalarKernel;
+    BatchKernel batchKernel;
+    CheckedKernel checkedKernel = nullptr;
+    Bound lowest{};
+    Bound highest{};
+
+    // the largest b with b^n <= limit, from a floating point estimate corrected with overflow-checked multiplications
+    static uint64_t largestBase(uint64_t limit, int n) {
+        if (n <= 1) return limit;
+        auto fits = [limit, n](uint64_t b) {
+            if (b <= 1) return b <= limit;
+            uint64_t result = 1;
+            for (int i = 0; i < n; ++i) {
+                if (result > limit / b) return false;
+                result *= b;
+            }
+            return true;
+        };
+        auto b = static_cast<uint64_t>(std::pow(static_cast<double>(limit), 1.0 / n));
+        while (b > 0 && !fits(b)) --b;
+        while (fits(b + 1)) ++b;
+        return b;
+    }
+
+    // runs the batch kernel a page at a time into a buffer that stays in L1 and streams each page out with non-temporal stores
+    // in place works too, since every page is read before it is overwritten
+    // the input is read sequentially, which the hardware prefetcher already covers; explicit prefetches only slowed this loop down
+    void applyStreaming(const T* in, T* out, std::size_t count) const {
+        std::size_t misalignment = StreamingStore::misalignment(out);
+        if (misalignment % sizeof(T) != 0) {
+            batchKernel(in, out, count, *this);
+            return;
+        }
+        std::size_t head = std::min(count, misalignment / sizeof(T));
+        batchKernel(in, out, head, *this);
+
+        constexpr std::size_t kPage = 4096 / sizeof(T);
+        alignas(64) T page[kPage];
+        for (std::size_t start = head; start < count; start += kPage) {
+            std::size_t m = std::min(kPage, count - start);
+            batchKernel(in + start, page, m, *this);
+            StreamingStore::copy(page, out + start, m * sizeof(T));
+        }
+        StreamingStore::fence();
+    }
+
+    // packs 64 bytes that are each 0 or 1 into a word, byte i becoming bit i
+    static uint64_t packFlags(const unsigned char* flags) {
+        uint64_t mask = 0;
+        for (int group = 0; group < 8; ++group) {
+            uint64_t bytes = 0;
+            for (int i = 0; i < 8; ++i) bytes |= static_cast<uint64_t>(flags[group * 8 + i]) << (8 * i);
+            // the multiplication moves bit 8i of every byte into bit 56 + i without carries
+            mask |= ((bytes * 0x0102040810204080ULL) >> 56) << (8 * group);
+        }
+        return mask;
+    }
+
+    void computeSafeRange() {
+        if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+            lowest = std::numeric_limits<T>::min();
+            highest = std::numeric_limits<T>::max();
+            if (n < 2) return;
+            highest = static_cast<T>(largestBase(static_cast<uint64_t>(std::numeric_limits<T>::max()), n));
+            if constexpr (std::is_signed_v<T>) {
+                // odd powers of negative values reach down to min, which is one further from zero than max
+                uint64_t magnitude = (n & 1) ? largestBase(static_cast<uint64_t>(std::numeric_limits<T>::max()) + 1, n) : highest;
+                lowest = static_cast<T>(-static_cast<int64_t>(magnitude));
+            } else {
+                lowest = 0;
+            }
+        }
+    }
+
+    static T squaringPower(T x, unsigned int exponent) {
+        if (exponent == 0) return MonoidTraits<T>::identity(x);
+        // start from the lowest set bit so the identity is never multiplied in, which matters when T is a large matrix
+        while (!(exponent & 1u)) {
+            x = x * x;
+            exponent >>= 1;
+        }
+        T result = x;
+        while (exponent >>= 1) {
+            x = x * x;
+            if (exponent & 1u) result = result * x;
+        }
+        return result;
+    }
+
+    static T genericScalar(const T& x, const Nth_Power& self) {
+        const int n = self.n;
+        if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+            if (n < 0) {
+                // integer division semantics: only 1 and -1 have a non-zero reciprocal, and 0 has none
+                if (x == 1) return 1;
+                if constexpr (std::is_signed_v<T>) {
+                    if (x == -1) return (n & 1) ? T(-1) : T(1);
+                }
+                return 0;
+            }
+            return static_cast<T>(Nth_Power<Work>::squaringPower(static_cast<Work>(x), static_cast<unsigned int>(n)));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            if (n < 0) return T(1) / squaringPower(x, 0u - static_cast<unsigned int>(n));
+            return squaringPower(x, static_cast<unsigned int>(n));
+        } else {
+            return squaringPower(x, static_cast<unsigned int>(n));
+        }
+    }
+
+    static void genericBatch(const T* in, T* out, std::size_t count, const Nth_Power& self) {
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = genericScalar(in[i], self);
+        }
+    }
+
+    template <PowAccuracy A>
+    static T realScalar(const T& x, const Nth_Power& self) {
+        return static_cast<T>(FastPow::pow<A>(static_cast<double>(x), self.realPower));
+    }
+
+    template <PowAccuracy A>
+    static void realBatch(const T* in, T* out, std::size_t count, const Nth_Power& self) {
+        FastPow::apply<A>(in, out, count, self.realPower);
+    }
+
+    // x^N with the squarings unrolled at compile time
+    template <unsigned N>
+    static Work unrolledPower(Work x) {
+        if constexpr (N == 0) {
+            return Work{1};
+        } else if constexpr (N == 1) {
+            return x;
+        } else {
+            Work half = unrolledPower<N / 2>(x);
+            if constexpr (N % 2) return half * half * x;
+            else return half * half;
+        }
+    }
+
+    template <unsigned N>
+    static T fixedScalar(const T& x, const Nth_Power&) {
+        return static_cast<T>(unrolledPower<N>(static_cast<Work>(x)));
+    }
+
+    template <unsigned N>
+    static void fixedBatch(const T* in, T* out, std::size_t count, const Nth_Power&) {
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<T>(unrolledPower<N>(static_cast<Work>(in[i])));
+        }
+    }
+
+    // 1 where x lies outside [lowest, highest], as a single unsigned comparison that wraps values below lowest around to large ones
+    static unsigned char outOfRange(T x, const Nth_Power& self) requires std::is_integral_v<T> {
+        using Unsigned = std::make_unsigned_t<T>;
+        const auto offset = static_cast<Unsigned>(self.lowest);
+        const auto span = static_cast<Unsigned>(static_cast<Unsigned>(self.highest) - offset);
+        return static_cast<Unsigned>(static_cast<Unsigned>(x) - offset) > span;
+    }
+
+    static void genericChecked(const T* in, T* out, unsigned char* flags, std::size_t count, const Nth_Power& self) {
+        if constexpr (std::is_integral_v<T>) {
+            for (std::size_t i = 0; i < count; ++i) flags[i] = outOfRange(in[i], self);
+            self.batchKernel(in, out, count, self);
+        } else {
+            // the input must be inspected before the kernel runs, since out may overwrite it
+            for (std::size_t i = 0; i < count; ++i) flags[i] = std::isfinite(in[i]);
+            self.batchKernel(in, out, count, self);
+            for (std::size_t i = 0; i < count; ++i) flags[i] &= std::isinf(out[i]);
+        }
+    }
+
+    template <unsigned N>
+    static void fixedChecked(const T* in, T* out, unsigned char* flags, std::size_t count, const Nth_Power& self) {
+        for (std::size_t i = 0; i < count; ++i) {
+            T x = in[i];
+            flags[i] = outOfRange(x, self);
+            out[i] = static_cast<T>(unrolledPower<N>(static_cast<Work>(x)));
+        }
+    }
+
+    template <std::size_t... N>
+    static constexpr std::array<ScalarKernel, sizeof...(N)> scalarTable(std::index_sequence<N...>) {
+        return {&fixedScalar<N>...};
+    }
+
+    template <std::size_t... N>
+    static constexpr std::array<BatchKernel, sizeof...(N)> batchTable(std::index_sequence<N...>) {
+        return {&fixedBatch<N>...};
+    }
+
+    template <std::size_t... N>
+    static constexpr std::array<CheckedKernel, sizeof...(N)> checkedTable(std::index_sequence<N...>) {
+        return {&fixedChecked<N>...};
+    }
+
+public:
+    /**
+     * @brief Constructs the Nth_power functor.
+     * @param power The int n specifying the power to raise values to.
+     * @throws std::invalid_argument if power is negative and T is not an arithmetic type
+     */
+    Nth_Power(int power) : n(power), scalarKernel(&genericScalar), batchKernel(&genericBatch) {
+        if (!kAllowsNegativePower && power < 0) {
+            throw std::invalid_argument("Nth_Power: negative powers need an arithmetic type");
+        }
+        if constexpr (std::is_arithmetic_v<T>) {
+            checkedKernel = &genericChecked;
+            if (power >= 0 && power <= kMaxSpecializedPower) {
+                static constexpr auto scalars = scalarTable(std::make_index_sequence<kMaxSpecializedPower + 1>{});
+                static constexpr auto batches = batchTable(std::make_index_sequence<kMaxSpecializedPower + 1>{});
+                scalarKernel = scalars[power];
+                batchKernel = batches[power];
+                if constexpr (std::is_integral_v<T>) {
+                    static constexpr auto checked = checkedTable(std::make_index_sequence<kMaxSpecializedPower + 1>{});
+                    checkedKernel = checked[power];
+                }
+            }
+        }
+        computeSafeRange();
+    }
+
+    /**
+     * @brief Constructs a functor that raises floating point values to a real power.
+     * Called with a floating point argument, e.g. Nth_Power<double>{2.2} or Nth_Power<float>{2.2}; an integer argument still selects the exact integer power above
+     * The exponent is a double whatever T is, so a double literal never has to choose between converting to T and converting to int
+     * @param power The real exponent.
+     * @param accuracy How closely results must follow the exact value, see PowAccuracy.
+     */
+    Nth_Power(double power, PowAccuracy accuracy = PowAccuracy::Precise) requires std::floating_point<T>
+        : n(0), realPower(power), realAccuracy(accuracy), checkedKernel(&genericChecked) {
+        switch (accuracy) {
+            case PowAccuracy::Precise:
+                scalarKernel = &realScalar<PowAccuracy::Precise>;
+                batchKernel = &realBatch<PowAccuracy::Precise>;
+                break;
+            case PowAccuracy::Balanced:
+                scalarKernel = &realScalar<PowAccuracy::Balanced>;
+                batchKernel = &realBatch<PowAccuracy::Balanced>;
+                break;
+            case PowAccuracy::Fast:
+                scalarKernel = &realScalar<PowAccuracy::Fast>;
+                batchKernel = &realBatch<PowAccuracy::Fast>;
+                break;
+        }
+    }
+
+    /**
+     * @brief Computes the nth power of the input value.
+     * @param x The value to be raised to the nth power.
+     * @return T x^n
+     */
+    T operator()(const T& x) const {
+        return scalarKernel(x, *this);
+    }
+
+    /**
+     * @brief Computes the nth power of every value in a buffer.
+     * @param in The values to be raised to the nth power.
+     * @param out Receives in[i]^n, may be the same buffer as in.
+     * @param count The number of values in both buffers.
+     * @param stores Whether results are written through the cache, see StoreMode; only arithmetic types can stream.
+     */
+    void apply(const T* in, T* out, std::size_t count, StoreMode stores = StoreMode::Cached) const {
+        if constexpr (std::is_arithmetic_v<T>) {
+            // in place, the destination is already in the cache from being read, so streaming saves no read and Auto does not use it
+            bool large = in != out && count * sizeof(T) >= StreamingStore::threshold();
+            if (stores == StoreMode::Streaming || (stores == StoreMode::Auto && large)) {
+                applyStreaming(in, out, count);
+                return;
+            }
+        }
+        batchKernel(in, out, count, *this);
+    }
+
+    /**
+     * @brief Computes the nth power of every value in a buffer, and reports which values overflowed.
+     * Integers are checked against the range of inputs whose power fits in T, computed once by the constructor, inside the same loop
+     * that computes the powers, so the check is one comparison per value; floating point values overflow where a finite input gives an infinite result
+     * Overflowed integers still receive the wrapped result that apply() would give
+     * @param in The values to be raised to the nth power.
+     * @param out Receives in[i]^n, may be the same buffer as in.
+     * @param count The number of values in both buffers.
+     * @param overflow If not null, receives one bit per value, set where the value overflowed: bit i % 64 of word i / 64,
+     *        so it must hold (count + 63) / 64 words.
+     * @return The index of the first value that overflowed, or count if none did.
+     */
+    std::size_t applyChecked(const T* in, T* out, std::size_t count, uint64_t* overflow = nullptr) const
+        requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+    {
+        // values are checked and computed a block at a time, and every 64 values of the block make one word of the mask
+        constexpr std::size_t kBlock = 1024;
+        std::size_t first = count;
+        for (std::size_t start = 0; start < count; start += kBlock) {
+            std::size_t m = std::min(kBlock, count - start);
+            // one byte per value keeps the checks vectorizable; they are packed into bits afterwards
+            unsigned char flags[kBlock];
+            checkedKernel(in + start, out + start, flags, m, *this);
+            std::fill(flags + m, flags + (m + 63) / 64 * 64, 0);
+            for (std::size_t word = 0; word * 64 < m; ++word) {
+                uint64_t mask = packFlags(flags + word * 64);
+                if (overflow) overflow[(start + word * 64) / 64] = mask;
+                if (mask && first == count) first = start + word * 64 + static_cast<std::size_t>(std::countr_zero(mask));
+            }
+        }
+        return first;
+    }
+
+    /**
+     * @brief The smallest integer input whose nth power fits in T.
+     */
+    T minSafeInput() const requires std::is_integral_v<T> { return lowest; }
+
+    /**
+     * @brief The largest integer input whose nth power fits in T.
+     */
+    T maxSafeInput() const requires std::is_integral_v<T> { return highest; }
+
+    /**
+     * @brief The integer power, or 0 for a functor constructed with a real power.
+     */
+    int power() const { return n; }
+
+    /**
+     * @brief The same power over another type, e.g. a wider one whose results cannot overflow where T's would.
+     */
+    template <MultiplicativeMonoid U>
+    Nth_Power<U> rebind() const {
+        if constexpr (std::floating_point<U>) {
+            if (realAccuracy) return Nth_Power<U>{realPower, *realAccuracy};
+        }
+        return Nth_Power<U>{n};
+    }
+
+    /**
+     * @brief true if this functor runs a kernel compiled for its exact power rather than the generic squaring loop
+     */
+    bool isSpecialized() const { return scalarKernel != &genericScalar; }
+
+    template <MultiplicativeMonoid> friend class Nth_Power;
+};
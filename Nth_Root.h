@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include "FastPow.h"
+#include "Nth_Power.h"
+
+/**
+ * @class Nth_Root
+ * @brief the inverse of Nth_Power for unsigned integers: floor(x^(1/n)) exactly, and whether x is a perfect nth power
+ *
+ * The root is first estimated in floating point and then corrected with exact integer powers from Nth_Power, so the result is exact
+ * for every input, including values close to the largest one the type can hold where the double estimate rounds the wrong way
+ * The estimate is accurate to well under one unit, so a single step down and a single step up are always enough to correct it
+ * (NthRootBenchmark checks this against a reference around every power near both ends of the 64-bit range)
+ *
+ * Batches are processed in small chunks with each step as a separate branch-free pass (estimate, x^n, step down, (x+1)^n, step up),
+ * so every pass is a simple loop the compiler can vectorize and the powers use the unrolled Nth_Power kernels
+ */
+template <std::unsigned_integral T = uint64_t>
+class Nth_Root {
+    int n;
+    T largest;
+    Nth_Power<T> power;
+
+    static constexpr std::size_t kChunk = 256;
+
+    T estimate(T x) const {
+        double root = n == 2 ? std::sqrt(static_cast<double>(x)) : FastPow::pow<PowAccuracy::Balanced>(static_cast<double>(x), 1.0 / n);
+        return std::min(static_cast<T>(root), largest);
+    }
+
+    // estimates a chunk of roots to well within one unit: square roots directly, other roots from the Fast pow tier
+    // refined by one Newton step, which squares its relative error of about 1e-4
+    void estimateChunk(const T* x, T* r, std::size_t m) const {
+        double values[kChunk];
+        double roots[kChunk];
+        for (std::size_t i = 0; i < m; ++i) values[i] = static_cast<double>(x[i]);
+        if (n == 2) {
+            for (std::size_t i = 0; i < m; ++i) roots[i] = std::sqrt(values[i]);
+        } else {
+            FastPow::apply<PowAccuracy::Fast>(values, roots, m, 1.0 / n);
+            // roots^(n-1) by squaring, one pass over the chunk per bit of the exponent
+            double powers[kChunk];
+            double squares[kChunk];
+            std::fill(powers, powers + m, 1.0);
+            std::copy(roots, roots + m, squares);
+            for (unsigned e = static_cast<unsigned>(n - 1); e != 0; e >>= 1) {
+                if (e & 1u) {
+                    for (std::size_t i = 0; i < m; ++i) powers[i] *= squares[i];
+                }
+                if (e > 1) {
+                    for (std::size_t i = 0; i < m; ++i) squares[i] *= squares[i];
+                }
+            }
+            // the floor on the power only matters for x = 0, where it turns 0 / 0 into 0
+            double scale = 1.0 / n;
+            for (std::size_t i = 0; i < m; ++i) {
+                roots[i] = ((n - 1) * roots[i] + values[i] / std::max(powers[i], 0x1p-1022)) * scale;
+            }
+        }
+        for (std::size_t i = 0; i < m; ++i) r[i] = std::min(static_cast<T>(roots[i]), largest);
+    }
+
+public:
+    /**
+     * @brief Constructs the Nth_Root functor.
+     * @param root The int n specifying which root to take.
+     * @throws std::invalid_argument if root is less than 1
+     */
+    Nth_Root(int root) : n(root), largest(0), power(root < 1 ? 1 : root) {
+        if (root < 1) throw std::invalid_argument("Nth_Root: the root must be at least 1");
+        // bounds every root and keeps the correction steps from overflowing
+        largest = power.maxSafeInput();
+    }
+
+    /**
+     * @brief Computes floor(x^(1/n)).
+     */
+    T operator()(T x) const {
+        if (n == 1) return x;
+        T r = estimate(x);
+        while (power(r) > x) --r;
+        while (r < largest && power(r + 1) <= x) ++r;
+        return r;
+    }
+
+    /**
+     * @brief the nth root of x if x is a perfect nth power, nullopt otherwise
+     */
+    std::optional<T> exact(T x) const {
+        T r = (*this)(x);
+        if (power(r) != x) return std::nullopt;
+        return r;
+    }
+
+    bool isPerfectPower(T x) const { return exact(x).has_value(); }
+
+    /**
+     * @brief Computes floor(in[i]^(1/n)) for every value in a buffer.
+     * @param in The values to take the root of.
+     * @param out Receives the roots, may be the same buffer as in.
+     * @param count The number of values in both buffers.
+     */
+    void apply(const T* in, T* out, std::size_t count) const {
+        if (n == 1) {
+            std::copy(in, in + count, out);
+            return;
+        }
+        T x[kChunk];
+        T r[kChunk];
+        T p[kChunk];
+        for (std::size_t start = 0; start < count; start += kChunk) {
+            std::size_t m = std::min(kChunk, count - start);
+            std::copy(in + start, in + start + m, x);
+            estimateChunk(x, r, m);
+
+            power.apply(r, p, m);
+            for (std::size_t i = 0; i < m; ++i) r[i] -= static_cast<T>(p[i] > x[i]);
+
+            for (std::size_t i = 0; i < m; ++i) p[i] = std::min(static_cast<T>(r[i] + 1), largest);
+            power.apply(p, p, m);
+            for (std::size_t i = 0; i < m; ++i) r[i] += static_cast<T>((r[i] < largest) & (p[i] <= x[i]));
+
+            std::copy(r, r + m, out + start);
+        }
+    }
+
+    /**
+     * @brief Tests every value in a buffer for being a perfect nth power.
+     * @param in The values to test.
+     * @param out Receives true where in[i] is r^n for some integer r.
+     * @param count The number of values in both buffers.
+     */
+    void applyPerfect(const T* in, bool* out, std::size_t count) const {
+        T r[kChunk];
+        for (std::size_t start = 0; start < count; start += kChunk) {
+            std::size_t m = std::min(kChunk, count - start);
+            apply(in + start, r, m);
+            power.apply(r, r, m);
+            for (std::size_t i = 0; i < m; ++i) out[start + i] = r[i] == in[start + i];
+        }
+    }
+
+    int root() const { return n; }
+
+    /**
+     * @brief the largest value whose nth power fits in T, which is also the largest root this functor can return
+     */
+    T largestRoot() const { return largest; }
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @class PerfCounters
+ * @brief reads hardware performance counters (cycles, instructions, cache misses, branch misses) around a block of code
+ *
+ * Each counter is opened on its own through Linux perf_event_open, counting user space only for this process and any threads it starts afterwards
+ * Counters that cannot be opened (no PMU in a virtual machine, a restrictive perf_event_paranoid, a non-Linux build) are simply reported as n/a,
+ * so a benchmark always runs and prints its timings whether or not counters are available
+ */
+class PerfCounters {
+public:
+    enum Counter { Cycles, Instructions, CacheMisses, BranchMisses, CounterCount };
+
+private:
+    int fds[CounterCount];
+
+#ifdef __linux__
+    static int open(uint64_t config) {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+public:
+    PerfCounters() {
+#ifdef __linux__
+        const uint64_t configs[CounterCount] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < CounterCount; ++i) fds[i] = open(configs[i]);
+#else
+        for (int i = 0; i < CounterCount; ++i) fds[i] = -1;
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /**
+     * @brief zeroes every available counter and starts counting
+     */
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /**
+     * @brief stops counting, the values stay readable until the next start()
+     */
+    void stop() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+#endif
+    }
+
+    /**
+     * @brief returns the value of a counter, or nothing if the counter is unavailable
+     */
+    std::optional<uint64_t> read(Counter counter) const {
+#ifdef __linux__
+        uint64_t value = 0;
+        if (fds[counter] >= 0 && ::read(fds[counter], &value, sizeof(value)) == sizeof(value)) return value;
+#endif
+        (void)counter;
+        return std::nullopt;
+    }
+
+    bool available() const {
+        for (int fd : fds) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief prints every counter, plus instructions per cycle, on one line
+     */
+    void print(std::ostream& out) const {
+        static const char* names[CounterCount] = {"cycles", "instructions", "cache-misses", "branch-misses"};
+        for (int i = 0; i < CounterCount; ++i) {
+            out << "  " << names[i] << '=';
+            if (auto value = read(static_cast<Counter>(i))) out << *value;
+            else out << "n/a";
+        }
+        auto cycles = read(Cycles);
+        auto instructions = read(Instructions);
+        out << "  ipc=";
+        if (cycles && instructions && *cycles) {
+            auto flags = out.flags();
+            auto precision = out.precision();
+            out << std::fixed << std::setprecision(2) << static_cast<double>(*instructions) / static_cast<double>(*cycles);
+            out.flags(flags);
+            out.precision(precision);
+        } else {
+            out << "n/a";
+        }
+        out << '\n';
+    }
+};
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "PerfCounters.h"
+#include "SaturatingPower.h"
+
+// a 3840x2160 RGB frame, with one value per channel
+static constexpr std::size_t kWidth = 3840;
+static constexpr std::size_t kHeight = 2160;
+static constexpr std::size_t kChannels = 3;
+
+/**
+ * @brief checks that the vector path of apply() agrees with single lookups at every offset and length around the vector width,
+ * and that the table stays within one step of a direct std::pow computation
+ * @return the number of values where apply() and single lookups disagree
+ */
+template <typename T>
+static std::size_t verify(const std::string& label, const SaturatingPower<T>& power, double exponent, bool normalized) {
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<unsigned> values(0, std::numeric_limits<T>::max());
+    std::vector<T> in(4096 + 64), out(in.size());
+    // every 8-bit value, or the first few thousand 16-bit ones, followed by random values
+    for (std::size_t i = 0; i < in.size(); ++i) in[i] = i <= std::numeric_limits<T>::max() ? static_cast<T>(i) : static_cast<T>(values(rng));
+
+    std::size_t mismatches = 0;
+    for (std::size_t offset = 0; offset < 33; ++offset) {
+        for (std::size_t length : {std::size_t{0}, std::size_t{15}, std::size_t{31}, std::size_t{64}, std::size_t{4000}}) {
+            std::fill(out.begin(), out.end(), T{0});
+            power.apply(in.data() + offset, out.data() + offset, length);
+            for (std::size_t i = offset; i < offset + length; ++i) mismatches += out[i] != power(in[i]);
+        }
+    }
+
+    double largestError = 0.0;
+    const double max = std::numeric_limits<T>::max();
+    for (std::size_t x = 0; x <= std::numeric_limits<T>::max(); ++x) {
+        double exact = normalized ? max * std::pow(x / max, exponent) : std::pow(static_cast<double>(x), exponent);
+        exact = std::clamp(exact, 0.0, max);
+        largestError = std::max(largestError, std::fabs(power(static_cast<T>(x)) - exact));
+    }
+    std::cout << "  " << label << ": " << mismatches << " vector mismatches, largest error against std::pow " << largestError << "\n";
+    return mismatches;
+}
+
+/**
+ * @brief prints the throughput of one way of transforming a frame, in megapixels (of kChannels values each) per second
+ */
+template <typename Body>
+static void runCase(const std::string& label, int repetitions, Body body) {
+    PerfCounters counters;
+    counters.start();
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; ++r) body();
+    auto end = std::chrono::steady_clock::now();
+    counters.stop();
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    std::cout << "  " << label << ": " << static_cast<double>(kWidth * kHeight) * repetitions / seconds / 1e6 << " megapixels/s\n";
+    counters.print(std::cout);
+}
+
+template <typename T>
+static void runFrame(const std::string& depth, const SaturatingPower<T>& gamma, double exponent) {
+    std::mt19937 rng(9);
+    std::uniform_int_distribution<unsigned> values(0, std::numeric_limits<T>::max());
+    std::vector<T> frame(kWidth * kHeight * kChannels), out(frame.size());
+    for (T& v : frame) v = static_cast<T>(values(rng));
+    const double max = std::numeric_limits<T>::max();
+
+    std::cout << depth << " RGB " << kWidth << "x" << kHeight << ", gamma " << exponent << ", apply() on " << SaturatingPower<T>::path() << "\n";
+    runCase("computed per value with std::pow", 2, [&] {
+        for (std::size_t i = 0; i < frame.size(); ++i) out[i] = static_cast<T>(std::nearbyint(max * std::pow(frame[i] / max, exponent)));
+    });
+    runCase("table lookup per value", 20, [&] {
+        for (std::size_t i = 0; i < frame.size(); ++i) out[i] = gamma(frame[i]);
+    });
+    runCase("SaturatingPower::apply", 20, [&] { gamma.apply(frame.data(), out.data(), frame.size()); });
+    runCase("SaturatingPower::apply in place", 20, [&] { gamma.apply(out.data(), out.data(), out.size()); });
+}
+
+int main() {
+    std::cout << "SaturatingPower correctness, apply() on " << SaturatingPower<uint8_t>::path() << " for 8 bits and "
+              << SaturatingPower<uint16_t>::path() << " for 16 bits\n";
+    std::size_t mismatches = 0;
+    mismatches += verify("8-bit gamma 2.2", SaturatingPower<uint8_t>{2.2}, 2.2, true);
+    mismatches += verify("8-bit gamma 1/2.2", SaturatingPower<uint8_t>{1 / 2.2}, 1 / 2.2, true);
+    mismatches += verify("8-bit ^3 saturating", SaturatingPower<uint8_t>{3}, 3.0, false);
+    mismatches += verify("8-bit ^1.5 integer scale", SaturatingPower<uint8_t>{1.5, SaturatingPower<uint8_t>::Scale::Integer}, 1.5, false);
+    mismatches += verify("16-bit gamma 2.2", SaturatingPower<uint16_t>{2.2}, 2.2, true);
+    mismatches += verify("16-bit ^2 saturating", SaturatingPower<uint16_t>{2}, 2.0, false);
+    mismatches += verify("16-bit ^-1 saturating", SaturatingPower<uint16_t>{-1}, -1.0, false);
+
+    runFrame("8-bit", SaturatingPower<uint8_t>{2.2}, 2.2);
+    runFrame("16-bit", SaturatingPower<uint16_t>{2.2}, 2.2);
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,123 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "FastPow.h"
+#include "Nth_Power.h"
+
+/**
+ * @brief the distance between result and reference in units of the last place of a double at the reference value
+ */
+static double ulpError(double result, long double reference) {
+    if (std::isnan(result) && std::isnan(reference)) return 0.0;
+    double rounded = static_cast<double>(reference);
+    if (result == rounded) return 0.0;
+    if (std::isinf(rounded) || std::isinf(result)) return INFINITY;
+    double ulp = std::nextafter(std::fabs(rounded), INFINITY) - std::fabs(rounded);
+    return static_cast<double>(std::fabs(static_cast<long double>(result) - reference) / ulp);
+}
+
+/**
+ * @brief measures the worst ULP and relative error of one accuracy tier over random inputs from a domain
+ * The reference is powl, whose 64-bit mantissa is 11 bits more precise than the double being checked
+ */
+template <PowAccuracy A>
+static void measureAccuracy(const std::string& tier, const std::string& domain, double xMin, double xMax, double yMin, double yMax) {
+    constexpr int kSamples = 2000000;
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> logX(std::log2(xMin), std::log2(xMax));
+    std::uniform_real_distribution<double> exponents(yMin, yMax);
+    double maxUlp = 0.0;
+    double maxRelative = 0.0;
+    for (int i = 0; i < kSamples; ++i) {
+        double x = std::exp2(logX(rng));
+        double y = exponents(rng);
+        long double reference = std::pow(static_cast<long double>(x), static_cast<long double>(y));
+        double result = FastPow::pow<A>(x, y);
+        maxUlp = std::max(maxUlp, ulpError(result, reference));
+        if (reference != 0) {
+            maxRelative = std::max(maxRelative, static_cast<double>(std::fabs((result - reference) / reference)));
+        }
+    }
+    std::cout << tier << " " << domain << ": max error " << maxUlp << " ULP, " << maxRelative << " relative\n";
+}
+
+/**
+ * @brief times a whole-buffer power transform with a fixed exponent, as Nth_Power batches use it
+ * @return the throughput in millions of values per second
+ */
+template <typename Body>
+static double measureThroughput(const std::string& label, std::size_t count, Body body) {
+    constexpr int kRepetitions = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < kRepetitions; ++r) body();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double throughput = static_cast<double>(count) * kRepetitions / seconds / 1e6;
+    std::cout << label << ": " << throughput << " Mvalues/s\n";
+    return throughput;
+}
+
+/**
+ * @brief times a tier that replaces std::pow, unless it is std::pow in this build
+ * @return 1 if the tier runs its own core and is slower than the std::pow it replaces, 0 otherwise
+ */
+template <PowAccuracy A, typename Body>
+static int checkThroughput(const std::string& label, std::size_t count, double stdPow, Body body) {
+    if (!FastPow::runsOwnCore<A>) {
+        std::cout << label << ": std::pow in this build (no FMA)\n";
+        return 0;
+    }
+    double throughput = measureThroughput(label, count, body);
+    if (throughput >= stdPow) return 0;
+    std::cout << "  slower than std::pow\n";
+    return 1;
+}
+
+int main() {
+    std::cout << "Accuracy against powl\n";
+    measureAccuracy<PowAccuracy::Precise>("precise", "x in [2^-10, 2^10], y in [-20, 20]", 0x1p-10, 0x1p10, -20, 20);
+    measureAccuracy<PowAccuracy::Balanced>("balanced", "x in [2^-10, 2^10], y in [-20, 20]", 0x1p-10, 0x1p10, -20, 20);
+    measureAccuracy<PowAccuracy::Fast>("fast", "x in [2^-10, 2^10], y in [-20, 20]", 0x1p-10, 0x1p10, -20, 20);
+    measureAccuracy<PowAccuracy::Precise>("precise", "x in [0.5, 2], y in [-600, 600]", 0.5, 2.0, -600, 600);
+    measureAccuracy<PowAccuracy::Balanced>("balanced", "x in [0.5, 2], y in [-600, 600]", 0.5, 2.0, -600, 600);
+    measureAccuracy<PowAccuracy::Fast>("fast", "gamma, x in [2^-8, 1], y in [0.4, 2.5]", 0x1p-8, 1.0, 0.4, 2.5);
+
+    constexpr std::size_t kCount = 1 << 20;
+    std::vector<double> in(kCount), out(kCount);
+    std::mt19937_64 rng(5);
+    std::uniform_real_distribution<double> values(0.0, 1000.0);
+    for (double& v : in) v = values(rng);
+    const double y = 2.2;
+
+    std::cout << "Throughput, y = " << y << "\n";
+    double stdPow = measureThroughput("std::pow", kCount, [&] {
+        for (std::size_t i = 0; i < kCount; ++i) out[i] = std::pow(in[i], y);
+    });
+    int slower = checkThroughput<PowAccuracy::Precise>("precise", kCount, stdPow,
+                                                       [&] { FastPow::apply<PowAccuracy::Precise>(in.data(), out.data(), kCount, y); });
+    slower += checkThroughput<PowAccuracy::Balanced>("balanced", kCount, stdPow,
+                                                     [&] { FastPow::apply<PowAccuracy::Balanced>(in.data(), out.data(), kCount, y); });
+    slower += checkThroughput<PowAccuracy::Fast>("fast", kCount, stdPow, [&] { FastPow::apply<PowAccuracy::Fast>(in.data(), out.data(), kCount, y); });
+
+    // the real-power functor on floats, built from a double literal as it would be for doubles, against the std::pow it replaces
+    std::vector<float> floatsIn(in.begin(), in.end()), floatsOut(kCount);
+    Nth_Power<float> gamma{2.2};
+    Nth_Power<float> fastGamma{2.2, PowAccuracy::Fast};
+    double stdPowFloats = measureThroughput("std::pow on floats", kCount, [&] {
+        for (std::size_t i = 0; i < kCount; ++i) floatsOut[i] = static_cast<float>(std::pow(static_cast<double>(floatsIn[i]), y));
+    });
+    slower += checkThroughput<PowAccuracy::Precise>("Nth_Power<float> precise", kCount, stdPowFloats,
+                                                    [&] { gamma.apply(floatsIn.data(), floatsOut.data(), kCount); });
+    slower += checkThroughput<PowAccuracy::Fast>("Nth_Power<float> fast", kCount, stdPowFloats,
+                                                 [&] { fastGamma.apply(floatsIn.data(), floatsOut.data(), kCount); });
+    double maxRelative = 0.0;
+    for (std::size_t i = 0; i < kCount; ++i) {
+        double reference = std::pow(static_cast<double>(floatsIn[i]), 2.2);
+        maxRelative = std::max(maxRelative, std::fabs((static_cast<double>(gamma(floatsIn[i])) - reference) / reference));
+    }
+    std::cout << "Nth_Power<float> precise: max error " << maxRelative << " relative\n";
+    return maxRelative < 1e-6 && slower == 0 ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "Nth_Power.h"
+
+/**
+ * @brief how PowerSums adds up its terms
+ * Plain is a straight sum; Compensated carries the rounding error of every addition (Kahan summation) at about twice the cost
+ */
+enum class Summation { Plain, Compensated };
+
+/**
+ * @struct Moments
+ * @brief the summary statistics that follow from the first four power sums of a sample
+ */
+struct Moments {
+    std::size_t count = 0;
+    double mean = 0.0;
+    double variance = 0.0;
+    double skewness = 0.0;
+    double kurtosis = 0.0;
+};
+
+/**
+ * @class PowerSums
+ * @brief sums of powers of a buffer (sum of x^n, or x, x^2, ..., x^K together) computed in one pass without an intermediate array
+ *
+ * Single-power sums run the Nth_Power batch kernel over a small chunk that stays in L1 cache and fold it into the running sum,
+ * so they get the same specialized kernels as Nth_Power::apply without ever writing out n transformed values
+ * Multi-power sums build each power from the previous one with a single multiplication per term
+ * Every sum keeps kLanes independent accumulators so consecutive additions do not wait on each other and the compiler can vectorize them,
+ * and the parallel versions split the buffer across threads and add the per-thread results at the end
+ *
+ * Floating point values are raised and summed in double, integers in a 64-bit integer that wraps on overflow, whatever the type of the buffer
+ */
+class PowerSums {
+public:
+    static constexpr std::size_t kLanes = 4;
+    static constexpr std::size_t kChunk = 256;
+
+    template <typename T>
+    using Sum = std::conditional_t<std::is_floating_point_v<T>, double, int64_t>;
+
+private:
+    // one accumulator per lane, with the Kahan compensation term used only for floating point compensated sums
+    template <typename A>
+    struct Accumulator {
+        A sum[kLanes] = {};
+        A compensation[kLanes] = {};
+
+        template <Summation S>
+        void add(std::size_t lane, A value) {
+            if constexpr (S == Summation::Compensated && std::is_floating_point_v<A>) {
+                A corrected = value - compensation[lane];
+                A total = sum[lane] + corrected;
+                compensation[lane] = (total - sum[lane]) - corrected;
+                sum[lane] = total;
+            } else if constexpr (std::is_integral_v<A>) {
+                sum[lane] = static_cast<A>(static_cast<uint64_t>(sum[lane]) + static_cast<uint64_t>(value));
+            } else {
+                sum[lane] += value;
+            }
+        }
+
+        A total() const {
+            A result = 0;
+            for (std::size_t lane = 0; lane < kLanes; ++lane) {
+                if constexpr (std::is_integral_v<A>) {
+                    result = static_cast<A>(static_cast<uint64_t>(result) + static_cast<uint64_t>(sum[lane]));
+                } else {
+                    result += sum[lane] - compensation[lane];
+                }
+            }
+            return result;
+        }
+    };
+
+    // every term is computed in Sum<T>, as sums() computes them, so a power that does not fit in T is not wrapped before it is added
+    template <Summation S, typename T>
+    static Sum<T> sumImpl(const T* in, std::size_t count, const Nth_Power<T>& power) {
+        using A = Sum<T>;
+        const Nth_Power<A> wide = power.template rebind<A>();
+        Accumulator<A> acc;
+        A chunk[kChunk];
+        for (std::size_t start = 0; start < count; start += kChunk) {
+            std::size_t n = std::min(kChunk, count - start);
+            if constexpr (std::is_same_v<T, A>) {
+                wide.apply(in + start, chunk, n);
+            } else {
+                for (std::size_t i = 0; i < n; ++i) chunk[i] = static_cast<A>(in[start + i]);
+                wide.apply(chunk, chunk, n);
+            }
+            for (std::size_t i = 0; i < n; ++i) acc.template add<S>(i % kLanes, chunk[i]);
+        }
+        return acc.total();
+    }
+
+    template <std::size_t K, Summation S, typename T>
+    static std::array<Sum<T>, K> sumsImpl(const T* in, std::size_t count) {
+        using A = Sum<T>;
+        std::array<Accumulator<A>, K> acc{};
+        auto addTerms = [&acc](std::size_t lane, A x) {
+            A term = x;
+            for (std::size_t k = 0; k < K; ++k) {
+                acc[k].template add<S>(lane, term);
+                if constexpr (std::is_integral_v<A>) {
+                    term = static_cast<A>(static_cast<uint64_t>(term) * static_cast<uint64_t>(x));
+                } else {
+                    term *= x;
+                }
+            }
+        };
+        const T* end = in + count;
+        for (; end - in >= static_cast<std::ptrdiff_t>(kLanes); in += kLanes) {
+            for (std::size_t lane = 0; lane < kLanes; ++lane) addTerms(lane, static_cast<A>(in[lane]));
+        }
+        for (std::size_t lane = 0; in != end; ++in, ++lane) addTerms(lane, static_cast<A>(*in));
+
+        std::array<A, K> result{};
+        for (std::size_t k = 0; k < K; ++k) result[k] = acc[k].total();
+        return result;
+    }
+
+    // runs body(begin, end) on consecutive slices of [0, count) on up to threads threads, and returns the per-slice results
+    template <typename R, typename Body>
+    static std::vector<R> parallelSlices(std::size_t count, unsigned threads, Body body) {
+        threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>((count + kChunk - 1) / kChunk)));
+        std::vector<R> results(threads);
+        std::vector<std::thread> workers;
+        std::size_t slice = (count + threads - 1) / threads;
+        for (unsigned t = 0; t < threads; ++t) {
+            std::size_t begin = std::min(count, t * slice);
+            std::size_t end = std::min(count, begin + slice);
+            workers.emplace_back([&results, &body, t, begin, end] { results[t] = body(begin, end); });
+        }
+        for (auto& worker : workers) worker.join();
+        return results;
+    }
+
+public:
+    /**
+     * @brief the sum of x^n over a buffer, where n is the power of the given functor
+     */
+    template <typename T>
+    static Sum<T> sum(const T* in, std::size_t count, const Nth_Power<T>& power, Summation summation = Summation::Plain) {
+        if (summation == Summation::Compensated) return sumImpl<Summation::Compensated>(in, count, power);
+        return sumImpl<Summation::Plain>(in, count, power);
+    }
+
+    /**
+     * @brief the sums of x^1 through x^K over a buffer, all computed in the same pass
+     * @return element k holds the sum of x^(k+1)
+     */
+    template <std::size_t K, typename T>
+    static std::array<Sum<T>, K> sums(const T* in, std::size_t count, Summation summation = Summation::Plain) {
+        if (summation == Summation::Compensated) return sumsImpl<K, Summation::Compensated>(in, count);
+        return sumsImpl<K, Summation::Plain>(in, count);
+    }
+
+    /**
+     * @brief sum() split across threads
+     */
+    template <typename T>
+    static Sum<T> parallelSum(const T* in, std::size_t count, const Nth_Power<T>& power, unsigned threads,
+                              Summation summation = Summation::Plain) {
+        auto parts = parallelSlices<Sum<T>>(count, threads, [&](std::size_t begin, std::size_t end) {
+            return sum(in + begin, end - begin, power, summation);
+        });
+        Accumulator<Sum<T>> total;
+        for (std::size_t t = 0; t < parts.size(); ++t) total.template add<Summation::Compensated>(0, parts[t]);
+        return total.total();
+    }
+
+    /**
+     * @brief sums() split across threads
+     */
+    template <std::size_t K, typename T>
+    static std::array<Sum<T>, K> parallelSums(const T* in, std::size_t count, unsigned threads, Summation summation = Summation::Plain) {
+        auto parts = parallelSlices<std::array<Sum<T>, K>>(count, threads, [&](std::size_t begin, std::size_t end) {
+            return sums<K>(in + begin, end - begin, summation);
+        });
+        std::array<Accumulator<Sum<T>>, K> total{};
+        for (const auto& part : parts) {
+            for (std::size_t k = 0; k < K; ++k) total[k].template add<Summation::Compensated>(0, part[k]);
+        }
+        std::array<Sum<T>, K> result{};
+        for (std::size_t k = 0; k < K; ++k) result[k] = total[k].total();
+        return result;
+    }
+
+    /**
+     * @brief mean, variance, skewness and kurtosis from the sums of x, x^2, x^3 and x^4
+     * The central moments are recovered from the raw sums, which loses precision when the mean is large compared to the spread,
+     * so compensated sums are recommended for that kind of data
+     */
+    static Moments moments(const std::array<double, 4>& sums, std::size_t count) {
+        Moments m;
+        m.count = count;
+        if (count == 0) return m;
+        double n = static_cast<double>(count);
+        double mean = sums[0] / n;
+        double e2 = sums[1] / n;
+        double e3 = sums[2] / n;
+        double e4 = sums[3] / n;
+        double m2 = e2 - mean * mean;
+        double m3 = e3 - 3.0 * mean * e2 + 2.0 * mean * mean * mean;
+        double m4 = e4 - 4.0 * mean * e3 + 6.0 * mean * mean * e2 - 3.0 * mean * mean * mean * mean;
+        m.mean = mean;
+        m.variance = m2;
+        if (m2 > 0.0) {
+            m.skewness = m3 / std::pow(m2, 1.5);
+            m.kurtosis = m4 / (m2 * m2);
+        }
+        return m;
+    }
+};
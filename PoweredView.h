@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include "Nth_Power.h"
+
+/**
+ * @class PoweredView
+ * @brief a lazy view of the nth powers of another range, usually written v | powered(3)
+ *
+ * Each element is raised to the power when it is read, so the view composes with other views without any intermediate storage
+ * The view is as capable as the range it wraps: sized, random access and common whenever the source is,
+ * and borrowed when the source is, since every iterator carries its own copy of the Nth_Power functor instead of pointing back at the view
+ *
+ * Reading one element at a time goes through the scalar kernel; copyTo() and forEachChunk() instead hand whole chunks to the batch kernel,
+ * straight from the source's memory when it is contiguous, so pipelines that end in them get the vectorized kernels
+ */
+template <std::ranges::input_range V>
+    requires std::ranges::view<V> && MultiplicativeMonoid<std::ranges::range_value_t<V>>
+class PoweredView : public std::ranges::view_interface<PoweredView<V>> {
+public:
+    using value_type = std::ranges::range_value_t<V>;
+    using Kernel = Nth_Power<value_type>;
+
+    // values handed to the batch kernel at a time when the source is not contiguous or the destination is not either
+    static constexpr std::size_t kChunk = 256;
+
+private:
+    template <bool Const>
+    using Base = std::conditional_t<Const, const V, V>;
+
+    template <bool Const>
+    static constexpr auto iteratorConcept() {
+        if constexpr (std::ranges::random_access_range<Base<Const>>) return std::random_access_iterator_tag{};
+        else if constexpr (std::ranges::bidirectional_range<Base<Const>>) return std::bidirectional_iterator_tag{};
+        else if constexpr (std::ranges::forward_range<Base<Const>>) return std::forward_iterator_tag{};
+        else return std::input_iterator_tag{};
+    }
+
+    // true when the batch kernel can write straight through out, which must be contiguous memory of exactly value_type
+    template <typename Out>
+    static constexpr bool writesDirectly() {
+        if constexpr (std::contiguous_iterator<Out>) return std::same_as<std::iter_value_t<Out>, value_type> && std::is_arithmetic_v<value_type>;
+        else return false;
+    }
+
+    V source;
+    Kernel kernel;
+
+public:
+    template <bool Const>
+    class Iterator {
+        using BaseIterator = std::ranges::iterator_t<Base<Const>>;
+        BaseIterator current = BaseIterator();
+        Kernel kernel{1};
+
+    public:
+        using iterator_concept = decltype(iteratorConcept<Const>());
+        // elements are computed on the fly, so to pre-ranges algorithms this is only an input iterator
+        using iterator_category = std::input_iterator_tag;
+        using value_type = PoweredView::value_type;
+        using difference_type = std::ranges::range_difference_t<Base<Const>>;
+
+        Iterator() requires std::default_initializable<BaseIterator> = default;
+        Iterator(BaseIterator current, const Kernel& kernel) : current(std::move(current)), kernel(kernel) {}
+        Iterator(Iterator<!Const> other) requires Const && std::convertible_to<std::ranges::iterator_t<V>, BaseIterator>
+            : current(std::move(other).base()), kernel(other.power()) {}
+
+        const BaseIterator& base() const& { return current; }
+        BaseIterator base() && { return std::move(current); }
+        const Kernel& power() const { return kernel; }
+
+        value_type operator*() const { return kernel(*current); }
+
+        Iterator& operator++() {
+            ++current;
+            return *this;
+        }
+        void operator++(int) { ++current; }
+        Iterator operator++(int) requires std::ranges::forward_range<Base<Const>> {
+            Iterator previous = *this;
+            ++current;
+            return previous;
+        }
+
+        Iterator& operator--() requires std::ranges::bidirectional_range<Base<Const>> {
+            --current;
+            return *this;
+        }
+        Iterator operator--(int) requires std::ranges::bidirectional_range<Base<Const>> {
+            Iterator previous = *this;
+            --current;
+            return previous;
+        }
+
+        Iterator& operator+=(difference_type n) requires std::ranges::random_access_range<Base<Const>> {
+            current += n;
+            return *this;
+        }
+        Iterator& operator-=(difference_type n) requires std::ranges::random_access_range<Base<Const>> {
+            current -= n;
+            return *this;
+        }
+        value_type operator[](difference_type n) const requires std::ranges::random_access_range<Base<Const>> {
+            return kernel(current[n]);
+        }
+
+        friend bool operator==(const Iterator& a, const Iterator& b) requires std::equality_comparable<BaseIterator> {
+            return a.current == b.current;
+        }
+        friend auto operator<=>(const Iterator& a, const Iterator& b)
+            requires std::ranges::random_access_range<Base<Const>> && std::three_way_comparable<BaseIterator>
+        {
+            return a.current <=> b.current;
+        }
+        friend Iterator operator+(Iterator it, difference_type n) requires std::ranges::random_access_range<Base<Const>> {
+            return it += n;
+        }
+        friend Iterator operator+(difference_type n, Iterator it) requires std::ranges::random_access_range<Base<Const>> {
+            return it += n;
+        }
+        friend Iterator operator-(Iterator it, difference_type n) requires std::ranges::random_access_range<Base<Const>> {
+            return it -= n;
+        }
+        friend difference_type operator-(const Iterator& a, const Iterator& b) requires std::sized_sentinel_for<BaseIterator, BaseIterator> {
+            return a.current - b.current;
+        }
+    };
+
+    template <bool Const>
+    class Sentinel {
+        using BaseSentinel = std::ranges::sentinel_t<Base<Const>>;
+        BaseSentinel last = BaseSentinel();
+
+    public:
+        Sentinel() = default;
+        explicit Sentinel(BaseSentinel last) : last(std::move(last)) {}
+        Sentinel(Sentinel<!Const> other) requires Const && std::convertible_to<std::ranges::sentinel_t<V>, BaseSentinel>
+            : last(std::move(other).base()) {}
+
+        BaseSentinel base() const { return last; }
+
+        friend bool operator==(const Iterator<Const>& it, const Sentinel& end) { return it.base() == end.last; }
+        friend std::ranges::range_difference_t<Base<Const>> operator-(const Iterator<Const>& it, const Sentinel& end)
+            requires std::sized_sentinel_for<BaseSentinel, std::ranges::iterator_t<Base<Const>>>
+        {
+            return it.base() - end.last;
+        }
+        friend std::ranges::range_difference_t<Base<Const>> operator-(const Sentinel& end, const Iterator<Const>& it)
+            requires std::sized_sentinel_for<BaseSentinel, std::ranges::iterator_t<Base<Const>>>
+        {
+            return end.last - it.base();
+        }
+    };
+
+    PoweredView(V source, Kernel kernel) : source(std::move(source)), kernel(std::move(kernel)) {}
+
+    V base() const& requires std::copy_constructible<V> { return source; }
+    V base() && { return std::move(source); }
+    const Kernel& power() const { return kernel; }
+
+    Iterator<false> begin() { return {std::ranges::begin(source), kernel}; }
+    Iterator<true> begin() const requires std::ranges::range<const V> { return {std::ranges::begin(source), kernel}; }
+
+    auto end() {
+        if constexpr (std::ranges::common_range<V>) return Iterator<false>{std::ranges::end(source), kernel};
+        else return Sentinel<false>{std::ranges::end(source)};
+    }
+    auto end() const requires std::ranges::range<const V> {
+        if constexpr (std::ranges::common_range<const V>) return Iterator<true>{std::ranges::end(source), kernel};
+        else return Sentinel<true>{std::ranges::end(source)};
+    }
+
+    auto size() requires std::ranges::sized_range<V> { return std::ranges::size(source); }
+    auto size() const requires std::ranges::sized_range<const V> { return std::ranges::size(source); }
+
+    /**
+     * @brief computes the view through the batch kernel, calling visit(const value_type* values, std::size_t count) for each chunk
+     * The chunks are only valid during the call, and types that are not arithmetic are passed one value at a time
+     */
+    template <typename Visitor>
+    void forEachChunk(Visitor visit) const requires std::ranges::input_range<const V> {
+        if constexpr (!std::is_arithmetic_v<value_type>) {
+            for (const auto& x : source) {
+                value_type result = kernel(x);
+                visit(static_cast<const value_type*>(std::addressof(result)), std::size_t{1});
+            }
+        } else if constexpr (std::ranges::contiguous_range<const V> && std::ranges::sized_range<const V>) {
+            const value_type* data = std::ranges::data(source);
+            auto count = static_cast<std::size_t>(std::ranges::size(source));
+            value_type results[kChunk];
+            for (std::size_t start = 0; start < count; start += kChunk) {
+                std::size_t m = std::min(kChunk, count - start);
+                kernel.apply(data + start, results, m);
+                visit(static_cast<const value_type*>(results), m);
+            }
+        } else {
+            value_type values[kChunk];
+            auto it = std::ranges::begin(source);
+            auto last = std::ranges::end(source);
+            while (it != last) {
+                std::size_t m = 0;
+                for (; m < kChunk && it != last; ++it) values[m++] = *it;
+                kernel.apply(values, values, m);
+                visit(static_cast<const value_type*>(values), m);
+            }
+        }
+    }
+
+    /**
+     * @brief writes every element of the view to out through the batch kernel, and returns the iterator past the last one written
+     * A contiguous source copied to a contiguous destination goes through the batch kernel directly, with no staging buffer
+     */
+    template <std::weakly_incrementable Out>
+        requires std::indirectly_writable<Out, value_type> && std::ranges::input_range<const V>
+    Out copyTo(Out out) const {
+        if constexpr (std::ranges::contiguous_range<const V> && std::ranges::sized_range<const V> && writesDirectly<Out>()) {
+            auto count = std::ranges::size(source);
+            kernel.apply(std::ranges::data(source), std::to_address(out), static_cast<std::size_t>(count));
+            return out + static_cast<std::iter_difference_t<Out>>(count);
+        } else {
+            forEachChunk([&out](const value_type* values, std::size_t count) { out = std::ranges::copy(values, values + count, out).out; });
+            return out;
+        }
+    }
+};
+
+template <typename R>
+PoweredView(R&&, Nth_Power<std::ranges::range_value_t<R>>) -> PoweredView<std::views::all_t<R>>;
+
+template <typename V>
+inline constexpr bool std::ranges::enable_borrowed_range<PoweredView<V>> = std::ranges::enable_borrowed_range<V>;
+
+/**
+ * @class PoweredAdaptor
+ * @brief what powered() returns: remembers the exponent until a range is piped into it, since the element type is only known then
+ */
+template <typename Exponent>
+class PoweredAdaptor {
+    Exponent exponent;
+    PowAccuracy accuracy;
+
+public:
+    explicit PoweredAdaptor(Exponent exponent, PowAccuracy accuracy = PowAccuracy::Precise) : exponent(exponent), accuracy(accuracy) {}
+
+    template <std::ranges::viewable_range R>
+        requires std::ranges::input_range<R> && (std::integral<Exponent> || std::floating_point<std::ranges::range_value_t<R>>)
+    auto operator()(R&& range) const {
+        using T = std::ranges::range_value_t<R>;
+        if constexpr (std::integral<Exponent>) {
+            return PoweredView(std::views::all(std::forward<R>(range)), Nth_Power<T>{static_cast<int>(exponent)});
+        } else {
+            return PoweredView(std::views::all(std::forward<R>(range)), Nth_Power<T>{static_cast<double>(exponent), accuracy});
+        }
+    }
+
+    template <std::ranges::viewable_range R>
+        requires std::invocable<const PoweredAdaptor&, R>
+    friend auto operator|(R&& range, const PoweredAdaptor& adaptor) {
+        return adaptor(std::forward<R>(range));
+    }
+};
+
+/**
+ * @brief v | powered(3) is a lazy view of the cubes of v
+ */
+inline PoweredAdaptor<int> powered(int power) { return PoweredAdaptor<int>{power}; }
+
+/**
+ * @brief v | powered(2.2) is a lazy view of the elements of v, which must be floating point, raised to a real power
+ */
+inline PoweredAdaptor<double> powered(double exponent, PowAccuracy accuracy = PowAccuracy::Precise) {
+    return PoweredAdaptor<double>{exponent, accuracy};
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class QuestionPool
+ * @brief every question the game knows, along with what the animals at each leaf are known to answer
+ *
+ * Questions are first-class entities: each distinct text is stored once and given a small integer id, and tree nodes refer to questions by that id
+ * Each leaf of the tree keeps a row of the questions its animals have a known answer for, sorted by question id, with the answers packed one bit each
+ * A leaf's row is exactly the questions on its path through the tree, so it only grows with the depth of the tree and not with its size
+ * Rows belong to leaves, not to animal names, so two leaves that happen to hold animals of the same name never overwrite each other's answers
+ */
+class QuestionPool {
+public:
+    /**
+     * @struct Suggestion
+     * @brief a question that could be asked at some point in the tree, and how well it would split the animals there
+     */
+    struct Suggestion {
+        uint32_t question;
+        double score;
+    };
+
+    /**
+     * @struct Group
+     * @brief the animals at one leaf, which all share the leaf's row of answers
+     */
+    struct Group {
+        uint32_t row;
+        uint32_t animals;
+    };
+
+private:
+    struct AttributeRow {
+        std::vector<uint32_t> questions;
+        std::vector<bool> answers;
+    };
+
+    std::vector<std::string> questionText;
+    std::unordered_map<std::string, uint32_t> questionIds;
+    std::vector<AttributeRow> rows;
+
+    static double entropy(double p) {
+        if (p <= 0.0 || p >= 1.0) return 0.0;
+        return -p * std::log2(p) - (1.0 - p) * std::log2(1.0 - p);
+    }
+
+public:
+    void clear() {
+        questionText.clear();
+        questionIds.clear();
+        clearAnswers();
+    }
+
+    /**
+     * @brief forgets every row of answers but keeps the questions, so ids held by tree nodes stay valid
+     */
+    void clearAnswers() { rows.clear(); }
+
+    /**
+     * @brief returns the id of a question, adding it to the pool the first time it is seen
+     */
+    uint32_t questionId(const std::string& text) {
+        auto [it, inserted] = questionIds.try_emplace(text, static_cast<uint32_t>(questionText.size()));
+        if (inserted) questionText.push_back(text);
+        return it->second;
+    }
+
+    std::optional<uint32_t> findQuestion(const std::string& text) const {
+        auto it = questionIds.find(text);
+        if (it == questionIds.end()) return std::nullopt;
+        return it->second;
+    }
+
+    const std::string& question(uint32_t id) const { return questionText[id]; }
+    std::size_t questionCount() const { return questionText.size(); }
+
+    /**
+     * @brief adds an empty row of answers for a new leaf and returns its id
+     */
+    uint32_t addRow() {
+        rows.emplace_back();
+        return static_cast<uint32_t>(rows.size() - 1);
+    }
+
+    /**
+     * @brief adds a row holding every answer known in another, used when a new leaf is split off an old one on the same path
+     */
+    uint32_t copyRow(uint32_t from) {
+        rows.push_back(rows[from]);
+        return static_cast<uint32_t>(rows.size() - 1);
+    }
+
+    /**
+     * @brief records the answer a leaf's animals give to a question, replacing any earlier answer
+     */
+    void setAnswer(uint32_t id, uint32_t question, bool yes) {
+        AttributeRow& row = rows[id];
+        auto it = std::lower_bound(row.questions.begin(), row.questions.end(), question);
+        auto offset = it - row.questions.begin();
+        if (it != row.questions.end() && *it == question) {
+            row.answers[offset] = yes;
+        } else {
+            row.questions.insert(it, question);
+            row.answers.insert(row.answers.begin() + offset, yes);
+        }
+    }
+
+    /**
+     * @brief ranks questions by how evenly they split a group of animals
+     * A question scores the entropy of the yes/no split among the animals with a known answer, weighted by the share of the group that has one,
+     * so a question that cuts the group in half scores 1 and a question that says nothing about the group scores 0
+     * Safe to call from several threads at once, as long as nothing changes the pool meanwhile
+     * @param groups the leaves the group's animals are at, with how many animals each holds
+     * @param exclude questions that must not be suggested, such as those already asked on the way to the group
+     * @param limit the largest number of suggestions to return
+     * @return the best questions, highest score first, all with a score above 0
+     */
+    std::vector<Suggestion> suggest(const std::vector<Group>& groups, const std::vector<uint32_t>& exclude, std::size_t limit) const {
+        // counters indexed by question id, kept per thread so concurrent calls never share them, and always left zeroed between calls
+        thread_local std::vector<uint32_t> yesCounts;
+        thread_local std::vector<uint32_t> noCounts;
+        if (yesCounts.size() < questionText.size()) {
+            yesCounts.resize(questionText.size(), 0);
+            noCounts.resize(questionText.size(), 0);
+        }
+        std::vector<uint32_t> touched;
+        uint64_t animals = 0;
+        for (const Group& group : groups) {
+            animals += group.animals;
+            const AttributeRow& row = rows[group.row];
+            for (std::size_t i = 0; i < row.questions.size(); ++i) {
+                uint32_t q = row.questions[i];
+                if (yesCounts[q] == 0 && noCounts[q] == 0) touched.push_back(q);
+                (row.answers[i] ? yesCounts[q] : noCounts[q]) += group.animals;
+            }
+        }
+
+        std::vector<Suggestion> suggestions;
+        for (uint32_t q : touched) {
+            if (std::find(exclude.begin(), exclude.end(), q) != exclude.end()) continue;
+            double known = yesCounts[q] + noCounts[q];
+            double score = entropy(yesCounts[q] / known) * known / static_cast<double>(animals);
+            if (score > 0.0) suggestions.push_back({q, score});
+        }
+        for (uint32_t q : touched) yesCounts[q] = noCounts[q] = 0;
+
+        std::sort(suggestions.begin(), suggestions.end(),
+                  [](const Suggestion& a, const Suggestion& b) { return a.score > b.score || (a.score == b.score && a.question < b.question); });
+        if (suggestions.size() > limit) suggestions.resize(limit);
+        return suggestions;
+    }
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+#include "Nth_Power.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @class SaturatingPower
+ * @brief raises 8 and 16 bit pixel values to a power through a lookup table, clamping results to the range of the type
+ *
+ * Nth_Power<uint8_t> wraps on overflow like the rest of integer arithmetic, which is right for exact integer math but wrong for images,
+ * so this functor offers the same interface with the semantics a media pipeline wants:
+ * integer powers saturate at the largest value, and real exponents can treat values as fixed-point fractions of full scale (gamma)
+ *
+ * Every possible input has its result precomputed when the functor is built (256 or 65536 entries, with Nth_Power doing the math),
+ * so applying it is a table lookup per value. 8-bit batches use pshufb, which looks up 16 table entries per instruction:
+ * the table is split into 16 slices of 16 entries, and each slice is looked up for every byte with the index pushed out of range
+ * for bytes belonging to other slices. 16-bit batches use AVX2 gathers
+ * The vector paths are compiled for their own instruction sets and picked once, at run time, from what the processor supports,
+ * like the kernel tables of Nth_Power, so a build for baseline x86-64 still uses them; path() names the one in use
+ */
+template <typename T>
+    requires std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>
+class SaturatingPower {
+public:
+    /**
+     * @brief how values are interpreted when raised to a real exponent
+     * Integer raises the value itself, so 10^1.5 gives 32; Normalized raises the fraction of full scale,
+     * so for 8 bits 128 ^ 2.2 means 255 * (128/255)^2.2 which gives 56
+     */
+    enum class Scale { Integer, Normalized };
+
+private:
+    static constexpr std::size_t kEntries = std::size_t{1} << (8 * sizeof(T));
+    static constexpr double kMax = std::numeric_limits<T>::max();
+
+    // one entry more than needed, so 32-bit gathers of the last 16-bit entry stay inside the table
+    std::vector<T> table;
+
+    static T clamp(double value) {
+        if (!(value < kMax)) return std::numeric_limits<T>::max();
+        return value > 0.0 ? static_cast<T>(std::nearbyint(value)) : T{0};
+    }
+
+    void applyScalar(const T* in, T* out, std::size_t count) const {
+        const T* lut = table.data();
+        for (std::size_t i = 0; i < count; ++i) out[i] = lut[in[i]];
+    }
+
+    // transforms whole vectors from the start of a buffer and returns how many values it did, leaving the rest to applyScalar()
+    using VectorKernel = std::size_t (*)(const T* in, T* out, std::size_t count, const T* table);
+
+    struct Path {
+        VectorKernel kernel;
+        const char* name;
+    };
+
+    static std::size_t noVector(const T*, T*, std::size_t, const T*) { return 0; }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("avx2"))) static std::size_t pshufbAvx2(const T* in, T* out, std::size_t count, const T* table) {
+        __m256i slices[16];
+        for (int k = 0; k < 16; ++k) {
+            slices[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16 * k)));
+        }
+        const __m256i sixteen = _mm256_set1_epi8(16);
+        const __m256i bias = _mm256_set1_epi8(0x70);
+        std::size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            __m256i result = _mm256_setzero_si256();
+            for (int k = 0; k < 16; ++k) {
+                // bytes of slice k become 0x70..0x7f, which pshufb looks up by their low 4 bits; all others saturate to 0x80
+                // or above, for which pshufb returns 0
+                result = _mm256_or_si256(result, _mm256_shuffle_epi8(slices[k], _mm256_adds_epu8(index, bias)));
+                index = _mm256_sub_epi8(index, sixteen);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), result);
+        }
+        return i;
+    }
+
+    __attribute__((target("ssse3"))) static std::size_t pshufbSsse3(const T* in, T* out, std::size_t count, const T* table) {
+        __m128i slices[16];
+        for (int k = 0; k < 16; ++k) slices[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16 * k));
+        const __m128i sixteen = _mm_set1_epi8(16);
+        const __m128i bias = _mm_set1_epi8(0x70);
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            __m128i result = _mm_setzero_si128();
+            for (int k = 0; k < 16; ++k) {
+                result = _mm_or_si128(result, _mm_shuffle_epi8(slices[k], _mm_adds_epu8(index, bias)));
+                index = _mm_sub_epi8(index, sixteen);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), result);
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2"))) static std::size_t gatherAvx2(const T* in, T* out, std::size_t count, const T* table) {
+        const int* base = reinterpret_cast<const int*>(table);
+        const __m256i low16 = _mm256_set1_epi32(0xffff);
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(values));
+            __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(values, 1));
+            // each gather reads 4 bytes starting at the 16-bit entry, and the upper half belongs to the next entry
+            lo = _mm256_and_si256(_mm256_i32gather_epi32(base, lo, 2), low16);
+            hi = _mm256_and_si256(_mm256_i32gather_epi32(base, hi, 2), low16);
+            // packus works within 128-bit lanes, so the 64-bit quarters come out as lo0 hi0 lo1 hi1 and are reordered
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xd8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+        }
+        return i;
+    }
+#endif
+
+    // the widest vector path the processor supports, looked up once per type
+    static const Path& vectorPath() {
+        static const Path path = [] {
+#if defined(__x86_64__) || defined(__i386__)
+            if constexpr (std::is_same_v<T, uint8_t>) {
+                if (__builtin_cpu_supports("avx2")) return Path{&pshufbAvx2, "AVX2 pshufb"};
+                if (__builtin_cpu_supports("ssse3")) return Path{&pshufbSsse3, "SSSE3 pshufb"};
+            } else {
+                if (__builtin_cpu_supports("avx2")) return Path{&gatherAvx2, "AVX2 gather"};
+            }
+#endif
+            return Path{&noVector, "scalar"};
+        }();
+        return path;
+    }
+
+public:
+    /**
+     * @brief Constructs a functor that raises values to an integer power, saturating at the largest value of T.
+     * Negative powers follow real arithmetic, so they give 0 or 1, and 0 saturates.
+     * @param power The int n specifying the power to raise values to.
+     */
+    SaturatingPower(int power) : table(kEntries + 1) {
+        if (power >= 0) {
+            // exact in 64 bits for every input that stays below the saturation point
+            Nth_Power<uint64_t> exact{power};
+            std::vector<uint64_t> values(kEntries);
+            std::iota(values.begin(), values.end(), uint64_t{0});
+            exact.apply(values.data(), values.data(), kEntries);
+            for (std::size_t x = 0; x < kEntries; ++x) {
+                bool saturated = x > exact.maxSafeInput() || values[x] > std::numeric_limits<T>::max();
+                table[x] = saturated ? std::numeric_limits<T>::max() : static_cast<T>(values[x]);
+            }
+        } else {
+            for (std::size_t x = 0; x < kEntries; ++x) table[x] = clamp(std::pow(static_cast<double>(x), power));
+        }
+    }
+
+    /**
+     * @brief Constructs a functor that raises values to a real exponent, e.g. SaturatingPower<uint8_t>{2.2} for gamma.
+     * @param exponent The real exponent.
+     * @param scale Whether values are raised directly or as fractions of full scale, see Scale.
+     */
+    SaturatingPower(double exponent, Scale scale = Scale::Normalized) : table(kEntries + 1) {
+        std::vector<double> values(kEntries);
+        double unit = scale == Scale::Normalized ? kMax : 1.0;
+        for (std::size_t x = 0; x < kEntries; ++x) values[x] = static_cast<double>(x) / unit;
+        Nth_Power<double>{exponent}.apply(values.data(), values.data(), kEntries);
+        for (std::size_t x = 0; x < kEntries; ++x) table[x] = clamp(values[x] * unit);
+    }
+
+    /**
+     * @brief Computes the saturated power of the input value.
+     */
+    T operator()(T x) const { return table[x]; }
+
+    /**
+     * @brief Computes the saturated power of every value in a buffer.
+     * @param in The values to be raised to the power.
+     * @param out Receives the results, may be the same buffer as in.
+     * @param count The number of values in both buffers.
+     */
+    void apply(const T* in, T* out, std::size_t count) const {
+        std::size_t done = vectorPath().kernel(in, out, count, table.data());
+        applyScalar(in + done, out + done, count - done);
+    }
+
+    /**
+     * @brief The name of the vector path apply() runs on this processor, or "scalar" if there is none.
+     */
+    static const char* path() { return vectorPath().name; }
+};
@@ -0,0 +1,244 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include "AnimalTree.h"
+#include "LatencyHistogram.h"
+#include "PerfCounters.h"
+#include "TimingWheel.h"
+
+// a million players, each allowed 30 seconds (of millisecond ticks) between answers before their session is reclaimed
+static constexpr uint32_t kSessions = 1000000;
+static constexpr uint64_t kIdleTimeout = 30000;
+static constexpr uint64_t kTicks = 120000;
+static constexpr int kAnswersPerTick = 100;
+
+/**
+ * @class HeapTimeouts
+ * @brief the usual alternative to a timing wheel: a binary heap of deadlines, where resetting a timer pushes a new entry
+ * and the stale entry left behind is skipped when it reaches the top. Every reset costs O(log n)
+ */
+class HeapTimeouts {
+    struct Entry {
+        uint64_t deadline;
+        uint32_t id;
+        uint32_t generation;
+        bool operator>(const Entry& other) const { return deadline > other.deadline || (deadline == other.deadline && id > other.id); }
+    };
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> heap;
+    std::vector<uint32_t> generations;
+    std::vector<uint64_t> deadlines;
+    uint64_t current = 0;
+
+public:
+    explicit HeapTimeouts(std::size_t count) : generations(count, 0), deadlines(count, 0) {}
+
+    void scheduleIn(uint32_t id, uint64_t ticks) {
+        deadlines[id] = current + ticks;
+        heap.push({deadlines[id], id, ++generations[id]});
+    }
+
+    bool scheduled(uint32_t id) const { return deadlines[id] != 0; }
+    uint64_t now() const { return current; }
+
+    template <typename Expire>
+    std::size_t advance(uint64_t now, Expire&& expire) {
+        std::size_t expired = 0;
+        current = now;
+        while (!heap.empty() && heap.top().deadline <= now) {
+            Entry top = heap.top();
+            heap.pop();
+            if (top.generation != generations[top.id]) continue;
+            deadlines[top.id] = 0;
+            ++expired;
+            expire(top.id);
+        }
+        return expired;
+    }
+
+    std::size_t entries() const { return heap.size(); }
+};
+
+/**
+ * @struct Session
+ * @brief what one player's game holds while it waits for the next answer: where it is in the tree and the questions answered this round
+ */
+struct Session {
+    const Node* at = nullptr;
+    std::vector<std::pair<uint32_t, bool>> answered;
+};
+
+/**
+ * @brief the outcome of one simulation, compared between the two timer structures
+ */
+struct SimulationResult {
+    uint64_t answers = 0;
+    uint64_t expired = 0;
+    uint64_t started = 0;
+    uint64_t checksum = 0;
+};
+
+/**
+ * @brief plays kTicks milliseconds of a server with kSessions players, where each tick kAnswersPerTick random players answer a question
+ * A player whose session has been reclaimed starts a new one; sessions that go kIdleTimeout ticks without an answer are reclaimed in bulk
+ * by the timer structure, which records how long each tick's expiry pass takes
+ */
+template <typename Timers>
+static SimulationResult simulate(const std::string& label, const AnimalTree& tree, Timers& timers, LatencyHistogram& expiryPass) {
+    std::vector<Session> sessions(kSessions);
+    SimulationResult result;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<uint32_t> player(0, kSessions - 1);
+
+    auto start = [&](uint32_t id) {
+        sessions[id].at = tree.getRoot();
+        timers.scheduleIn(id, kIdleTimeout);
+        ++result.started;
+    };
+    auto reclaim = [&](uint32_t id) {
+        sessions[id] = Session{};
+        ++result.expired;
+        // the order of sessions expiring on the same tick differs between the structures, so the checksum must not depend on it
+        result.checksum += (uint64_t{id} + 1) * timers.now();
+    };
+
+    PerfCounters counters;
+    auto begin = std::chrono::steady_clock::now();
+    counters.start();
+    for (uint32_t id = 0; id < kSessions; ++id) start(id);
+    for (uint64_t tick = 1; tick <= kTicks; ++tick) {
+        {
+            ScopedLatency timer(expiryPass);
+            timers.advance(tick, reclaim);
+        }
+        for (int a = 0; a < kAnswersPerTick; ++a) {
+            uint32_t id = player(rng);
+            Session& session = sessions[id];
+            if (!session.at) {
+                start(id);
+                continue;
+            }
+            bool yes = rng() & 1;
+            session.answered.emplace_back(session.at->question, yes);
+            session.at = yes ? session.at->yes.get() : session.at->no.get();
+            if (session.at->isLeaf()) {
+                session.at = tree.getRoot();
+                session.answered.clear();
+            }
+            timers.scheduleIn(id, kIdleTimeout);
+            ++result.answers;
+        }
+    }
+    counters.stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << label << ": " << seconds << " s, " << seconds * 1e9 / static_cast<double>(result.answers + result.started) << " ns per timer reset, "
+              << result.expired << " sessions reclaimed\n";
+    counters.print(std::cout);
+    expiryPass.printPercentiles(std::cout, "  expiry pass per tick");
+    return result;
+}
+
+/**
+ * @brief resets a million timers to random deadlines with no game around them, expiring the ones that run out, the cost of the timer structure alone
+ */
+template <typename Timers>
+static void resetOnly(const std::string& label, Timers& timers) {
+    constexpr int kResets = 10000000;
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<uint32_t> id(0, kSessions - 1);
+    std::size_t expired = 0;
+    for (uint32_t i = 0; i < kSessions; ++i) timers.scheduleIn(i, kIdleTimeout);
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < kResets; ++i) {
+        // time moves one tick every hundred resets, so the earliest timers start expiring about a third of the way through
+        if (i % 100 == 0) expired += timers.advance(static_cast<uint64_t>(i / 100 + 1), [](uint32_t) {});
+        timers.scheduleIn(id(rng), kIdleTimeout / 2 + rng() % kIdleTimeout);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << label << ": " << elapsed / kResets << " ns per reset (" << expired << " expired)\n";
+}
+
+/**
+ * @brief checks the wheel against a sorted list of deadlines for timers spread across every level, including ones past the top level
+ * @return the number of timers that expired on the wrong tick or not at all
+ */
+static std::size_t verifyWheel() {
+    TimingWheel wheel;
+    std::mt19937_64 rng(17);
+    constexpr uint32_t kTimers = 200000;
+    std::vector<uint64_t> expected(kTimers);
+    for (uint32_t id = 0; id < kTimers; ++id) {
+        // spans from one tick to past 2^32, so every level and the overflow list get timers
+        unsigned bits = static_cast<unsigned>(rng() % 34);
+        expected[id] = 1 + (rng() & ((uint64_t{1} << bits) - 1));
+        wheel.schedule(id, expected[id]);
+    }
+    // cancel and reschedule some, as answers do
+    for (uint32_t id = 0; id < kTimers; id += 7) {
+        wheel.cancel(id);
+        expected[id] = 0;
+    }
+    for (uint32_t id = 3; id < kTimers; id += 11) {
+        if (!expected[id]) continue;
+        expected[id] = expected[id] / 2 + 1;
+        wheel.schedule(id, expected[id]);
+    }
+
+    std::size_t wrong = 0;
+    uint64_t previous = 0;
+    auto check = [&](uint32_t id) {
+        wrong += expected[id] != wheel.now() || wheel.now() < previous;
+        previous = wheel.now();
+        expected[id] = 0;
+    };
+    // advance in uneven jumps so both single ticks and long skips are exercised
+    while (wheel.size() > 0) wheel.advance(wheel.now() + 1 + (rng() % 3 == 0 ? rng() % 100000000 : rng() % 300), check);
+    for (uint64_t deadline : expected) wrong += deadline != 0;
+    std::cout << "timing wheel: " << kTimers << " timers, " << wrong << " expired on the wrong tick\n";
+    return wrong;
+}
+
+int main() {
+    std::size_t wrong = verifyWheel();
+
+    AnimalTree tree;
+    std::mt19937 rng(42);
+    for (int i = 0; i < 10000; ++i) {
+        Node* leaf = tree.getRoot();
+        while (!leaf->isLeaf()) leaf = (rng() & 1) ? leaf->yes.get() : leaf->no.get();
+        tree.learn(leaf, "Animal " + std::to_string(i), "Question " + std::to_string(i % 1024) + "?", rng() & 1);
+    }
+
+    std::cout << kSessions << " sessions, " << kIdleTimeout << " tick idle timeout, " << kTicks << " ticks of " << kAnswersPerTick << " answers\n";
+    SimulationResult wheelResult, heapResult;
+    {
+        TimingWheel wheel;
+        wheel.reserve(kSessions);
+        LatencyHistogram expiryPass;
+        wheelResult = simulate("timing wheel", tree, wheel, expiryPass);
+    }
+    {
+        HeapTimeouts heap(kSessions);
+        LatencyHistogram expiryPass;
+        heapResult = simulate("binary heap", tree, heap, expiryPass);
+        std::cout << "  heap entries left, most of them stale: " << heap.entries() << "\n";
+    }
+    bool same = wheelResult.answers == heapResult.answers && wheelResult.expired == heapResult.expired && wheelResult.checksum == heapResult.checksum;
+    std::cout << "same sessions reclaimed on the same ticks: " << (same ? "yes" : "NO") << "\n";
+
+    {
+        TimingWheel wheel;
+        wheel.reserve(kSessions);
+        resetOnly("timing wheel resets", wheel);
+    }
+    {
+        HeapTimeouts heap(kSessions);
+        resetOnly("binary heap resets", heap);
+    }
+    return wrong == 0 && same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
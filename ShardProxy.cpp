@@ -0,0 +1,66 @@
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "ShardProxy.h"
+
+/**
+ * Serves the animal game on a Unix socket from several engine processes:
+ * ShardProxy SOCKET [--shards N] [--depth D] [--bucket B] [--metadata FILE] [TREE_FILE]
+ * Sessions are spread over the shards by the subtree D answers below the root, and the shards learn from their players
+ */
+int main(int argc, char* argv[]) {
+    std::string socketPath, treePath, metadataPath;
+    unsigned shards = 4, depth = 4;
+    std::size_t bucketCapacity = 1;
+    bool usage = argc < 2;
+    for (int i = 1; i < argc && !usage; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--shards" && hasValue) shards = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--depth" && hasValue) depth = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--bucket" && hasValue) bucketCapacity = std::stoul(argv[++i]);
+        else if (arg == "--metadata" && hasValue) metadataPath = argv[++i];
+        else if (!arg.empty() && arg[0] == '-') usage = true;
+        else if (socketPath.empty()) socketPath = arg;
+        else if (treePath.empty()) treePath = arg;
+        else usage = true;
+    }
+    if (usage || socketPath.empty() || shards == 0) {
+        std::cerr << "usage: ShardProxy SOCKET [--shards N] [--depth D] [--bucket B] [--metadata FILE] [TREE_FILE]\n"
+                     "Starts N engine processes (4 by default) playing TREE_FILE (saved by the game) or the initial tree,\n"
+                     "and routes the players connecting to SOCKET to them by the subtree D answers (4 by default) below the first question.\n"
+                     "Each guess may hold B animals (1 by default), and FILE (written by MetadataFile::write()) describes the animals guessed.\n";
+        return EXIT_FAILURE;
+    }
+    std::signal(SIGINT, ShardProxy::requestStop);
+    std::signal(SIGTERM, ShardProxy::requestStop);
+    try {
+        std::stringstream initial;
+        std::ifstream file;
+        std::istream* tree = &initial;
+        if (!treePath.empty()) {
+            file.open(treePath);
+            if (!file) {
+                std::cerr << "cannot open " << treePath << "\n";
+                return EXIT_FAILURE;
+            }
+            tree = &file;
+        } else {
+            AnimalEngine{}.save(initial);
+        }
+        ShardProxy proxy(socketPath, *tree, shards, depth, bucketCapacity, metadataPath);
+        std::cerr << "serving on " << socketPath << " from " << shards << " shards\n";
+        proxy.run();
+        const auto& stats = proxy.statistics();
+        std::cerr << stats.sessions << " sessions, " << stats.lines << " lines, " << stats.migrations << " moves between shards, "
+                  << stats.topLearns << " learns above the cut copied to every shard, " << stats.strayRoutes << " sessions that could not be resumed\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
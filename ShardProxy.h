@@ -0,0 +1,684 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "AnimalEngine.h"
+#include "AnimalMetadata.h"
+#include "FdPassing.h"
+#include "ShardRing.h"
+#include "TimingWheel.h"
+
+/**
+ * @class AnimalShard
+ * @brief one engine process behind a ShardProxy: plays and learns the sessions the proxy routes to it, over a single socket to the proxy
+ *
+ * Every shard starts with the same tree. A shard only learns in the subtrees the ring gives it, and the top owner also learns above the cut
+ * and reports those learns so the proxy can copy them to every other shard, which keeps the top of the tree the same everywhere.
+ * Whenever a session's answers take it into a subtree another shard owns, the shard lets go of it and tells the proxy where it is,
+ * as the string of answers from the root, and the proxy resumes it on the owner
+ * Games are played through the AnimalEngine's cursors, so leaves holding several animals and metadata shown with a guess work as in the game
+ *
+ * Messages are lines. From the proxy: "S id route" starts or resumes a session ("-" for the root), "L id text" is a line from its player,
+ * "E id" ends it, and "A route y|n animal<TAB>question[<TAB>candidate...]" or "A route + animal" learns or remembers at a leaf above the cut.
+ * To the proxy: "P id text" is a line for the player, "D id" means the shard is waiting for the player's next line, "M id route" hands
+ * the session on, "Q id" means the player quit, "X id route" means the route did not fit this shard's tree and the session starts over,
+ * and "T ..." carries a learn above the cut for the other shards, in the form of "A ...". The candidates listed after a learn's question
+ * are the leaf's animals that answer it yes, by name, since each shard may guess a leaf's animals in its own order
+ */
+class AnimalShard {
+    enum class Stage { Asking, Guessing, Naming, Questioning, Answering, Sorting };
+
+    struct Session {
+        std::string route;
+        AnimalEngine::Cursor cursor;
+        // the tree's version the cursor was last checked against
+        uint64_t version = 0;
+        Stage stage = Stage::Asking;
+        std::string guessing;
+        std::string animal;
+        std::string question;
+        bool animalIsYes = false;
+        std::vector<std::string> candidates;
+        std::vector<bool> candidateIsYes;
+    };
+
+    AnimalEngine& engine;
+    const ShardRing& ring;
+    unsigned index;
+    int fd;
+    std::unordered_map<uint64_t, Session> sessions;
+    std::string out;
+    // bumped whenever the tree changes, since that may invalidate the cursors of sessions waiting on their players
+    uint64_t version = 0;
+
+    void send(char verb, uint64_t id, const std::string& text = std::string()) {
+        out += verb;
+        out += ' ';
+        out += std::to_string(id);
+        if (!text.empty()) {
+            out += ' ';
+            out += text;
+        }
+        out += '\n';
+    }
+
+    void prompt(uint64_t id, const Session& session) {
+        if (!session.cursor.atGuess()) {
+            send('P', id, session.cursor.question() + " (yes/no)");
+            return;
+        }
+        AnimalMetadata details;
+        if (engine.metadata(session.guessing, details) && !details.description.empty()) {
+            std::replace(details.description.begin(), details.description.end(), '\n', ' ');
+            send('P', id, details.description);
+        }
+        send('P', id, "Is it a " + session.guessing + "? (yes/no)");
+    }
+
+    /**
+     * @brief keeps a session that has just moved if this shard owns where it is, prompting its player, or hands it to the proxy
+     */
+    void settle(uint64_t id, Session& session) {
+        session.route = session.cursor.route();
+        session.version = version;
+        if (ring.owner(session.route) != index) {
+            send('M', id, session.route.empty() ? "-" : session.route);
+            sessions.erase(id);
+            return;
+        }
+        session.stage = session.cursor.atGuess() ? Stage::Guessing : Stage::Asking;
+        if (session.stage == Stage::Guessing) session.guessing = session.cursor.guess();
+        prompt(id, session);
+        send('D', id);
+    }
+
+    void restart(uint64_t id, Session& session) {
+        session.cursor = engine.start();
+        settle(id, session);
+    }
+
+    /**
+     * @brief brings a session's cursor up to date after the tree has changed under it, finding the animal it was guessing again
+     * @return false if another player on this shard split the leaf the session was guessing at
+     */
+    bool refresh(Session& session) {
+        if (session.version == version) return true;
+        session.version = version;
+        engine.resume(session.route, session.cursor);
+        if (session.stage == Stage::Asking) return true;
+        if (!session.cursor.atGuess()) return false;
+        while (session.cursor.guess() != session.guessing) {
+            if (!engine.nextGuess(session.cursor)) return false;
+        }
+        return true;
+    }
+
+    // reports a change to a leaf above the cut, which only the top owner ever makes, so the proxy can copy it to every other shard
+    void reportAboveCut(const Session& session, const std::string& change) {
+        if (session.route.size() < ring.depth()) out += "T " + (session.route.empty() ? std::string("-") : session.route) + ' ' + change + '\n';
+    }
+
+    void teach(uint64_t id, Session& session) {
+        // the leaf's animals are sorted by the new question as the player answered for each, matched by name in case a guess
+        // reordered them meanwhile; answers that leave none of them opposite the new animal, or none with it, keep them all together
+        std::vector<bool> candidateIsYes;
+        std::string yesNames;
+        std::vector<std::string> candidates = engine.candidates(session.cursor);
+        for (std::size_t i = 0; i < candidates.size() && !session.candidateIsYes.empty(); ++i) {
+            auto asked = std::find(session.candidates.begin(), session.candidates.end(), candidates[i]);
+            if (asked == session.candidates.end()) break;
+            candidateIsYes.push_back(session.candidateIsYes[static_cast<std::size_t>(asked - session.candidates.begin())]);
+            if (candidateIsYes.back()) yesNames += '\t' + candidates[i];
+        }
+        if (candidateIsYes.size() != candidates.size() ||
+            std::find(candidateIsYes.begin(), candidateIsYes.end(), !session.animalIsYes) == candidateIsYes.end() ||
+            std::find(candidateIsYes.begin(), candidateIsYes.end(), session.animalIsYes) == candidateIsYes.end()) {
+            candidateIsYes.clear();
+            yesNames.clear();
+        }
+        engine.learn(session.cursor, session.animal, session.question, session.animalIsYes, candidateIsYes);
+        ++version;
+        reportAboveCut(session, std::string(session.animalIsYes ? "y " : "n ") + session.animal + '\t' + session.question + yesNames);
+        send('P', id, "Got it! I'll remember that for next time.");
+        restart(id, session);
+    }
+
+    void askCandidate(uint64_t id, const Session& session) {
+        send('P', id, "And for a " + session.candidates[session.candidateIsYes.size()] + "? (yes/no)");
+    }
+
+    void play(uint64_t id, const std::string& line) {
+        auto found = sessions.find(id);
+        if (found == sessions.end()) return;
+        Session& session = found->second;
+        if (line == "quit") {
+            send('Q', id);
+            sessions.erase(found);
+            return;
+        }
+        // a leaf this player was guessing at may have been split by another player on this shard while they were typing
+        if (!refresh(session)) {
+            send('P', id, "Someone else just taught me about that spot.");
+            settle(id, session);
+            return;
+        }
+        bool yesNo = line == "yes" || line == "no";
+        bool yes = line == "yes";
+        if (session.stage != Stage::Naming && session.stage != Stage::Questioning && !yesNo) {
+            send('P', id, "Please answer 'yes' or 'no'.");
+            if (session.stage == Stage::Answering) send('P', id, "For a " + session.animal + ", what is the answer to that question? (yes/no)");
+            else if (session.stage == Stage::Sorting) askCandidate(id, session);
+            else prompt(id, session);
+            send('D', id);
+            return;
+        }
+        switch (session.stage) {
+            case Stage::Asking:
+                engine.answer(session.cursor, yes);
+                settle(id, session);
+                return;
+            case Stage::Guessing:
+                if (yes) {
+                    engine.confirm(session.cursor);
+                    ++version;
+                    send('P', id, "Yay! I guessed it right!");
+                    restart(id, session);
+                    return;
+                }
+                if (engine.nextGuess(session.cursor)) {
+                    session.guessing = session.cursor.guess();
+                    prompt(id, session);
+                    break;
+                }
+                send('P', id, "I give up! What is your animal?");
+                session.stage = Stage::Naming;
+                break;
+            case Stage::Naming:
+                session.animal = line;
+                std::replace(session.animal.begin(), session.animal.end(), '\t', ' ');
+                if (engine.remember(session.cursor, session.animal)) {
+                    ++version;
+                    reportAboveCut(session, "+ " + session.animal);
+                    send('P', id, "Got it! I'll guess a " + session.animal + " here next time.");
+                    restart(id, session);
+                    return;
+                }
+                send('P', id, "What question distinguishes a " + session.animal + " from a " + session.guessing + "?");
+                session.stage = Stage::Questioning;
+                break;
+            case Stage::Questioning:
+                session.question = line;
+                send('P', id, "For a " + session.animal + ", what is the answer to that question? (yes/no)");
+                session.stage = Stage::Answering;
+                break;
+            case Stage::Answering:
+                session.animalIsYes = yes;
+                session.candidates = engine.candidates(session.cursor);
+                session.candidateIsYes.clear();
+                if (session.candidates.size() < 2) {
+                    teach(id, session);
+                    return;
+                }
+                askCandidate(id, session);
+                session.stage = Stage::Sorting;
+                break;
+            case Stage::Sorting:
+                session.candidateIsYes.push_back(yes);
+                if (session.candidateIsYes.size() == session.candidates.size()) {
+                    teach(id, session);
+                    return;
+                }
+                askCandidate(id, session);
+                break;
+        }
+        send('D', id);
+    }
+
+    // learns what the top owner learned above the cut; the leaf is always still there, since no other shard learns above the cut
+    void apply(const std::string& message) {
+        auto space = message.find(' ');
+        if (space == std::string::npos || space + 3 > message.size()) return;
+        std::string route = message.substr(0, space);
+        if (route == "-") route.clear();
+        AnimalEngine::Cursor cursor;
+        if (!engine.resume(route, cursor) || !cursor.atGuess() || cursor.route() != route) return;
+        char kind = message[space + 1];
+        std::string rest = message.substr(space + 3);
+        if (kind == '+') {
+            engine.remember(cursor, rest);
+            ++version;
+            return;
+        }
+        std::vector<std::string> fields;
+        for (std::size_t start = 0, tab;; start = tab + 1) {
+            tab = rest.find('\t', start);
+            fields.push_back(rest.substr(start, tab - start));
+            if (tab == std::string::npos) break;
+        }
+        if (fields.size() < 2) return;
+        std::vector<bool> candidateIsYes;
+        if (fields.size() > 2) {
+            for (const auto& candidate : engine.candidates(cursor)) candidateIsYes.push_back(std::find(fields.begin() + 2, fields.end(), candidate) != fields.end());
+        }
+        engine.learn(cursor, fields[0], fields[1], kind == 'y', candidateIsYes);
+        ++version;
+    }
+
+    void handle(const std::string& line) {
+        if (line.size() < 3 || line[1] != ' ') return;
+        if (line[0] == 'A') {
+            apply(line.substr(2));
+            return;
+        }
+        auto space = line.find(' ', 2);
+        uint64_t id = std::stoull(line.substr(2, space - 2));
+        std::string text = space == std::string::npos ? std::string() : line.substr(space + 1);
+        if (line[0] == 'S') {
+            Session& session = sessions[id];
+            if (!engine.resume(text == "-" ? std::string() : text, session.cursor)) send('X', id, text);
+            settle(id, session);
+        } else if (line[0] == 'L') {
+            play(id, text);
+        } else if (line[0] == 'E') {
+            sessions.erase(id);
+        }
+    }
+
+public:
+    AnimalShard(AnimalEngine& engine, const ShardRing& ring, unsigned index, int fd) : engine(engine), ring(ring), index(index), fd(fd) {}
+
+    /**
+     * @brief serves the proxy until it closes the socket
+     */
+    void run() {
+        std::string input;
+        char buffer[65536];
+        while (true) {
+            ssize_t got = ::read(fd, buffer, sizeof(buffer));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return;
+            input.append(buffer, static_cast<std::size_t>(got));
+            std::size_t start = 0, end;
+            while ((end = input.find('\n', start)) != std::string::npos) {
+                handle(input.substr(start, end - start));
+                start = end + 1;
+            }
+            input.erase(0, start);
+            // everything this batch of messages produced goes back in one write
+            const char* data = out.data();
+            std::size_t left = out.size();
+            while (left > 0) {
+                ssize_t written = ::write(fd, data, left);
+                if (written < 0 && errno == EINTR) continue;
+                if (written <= 0) return;
+                data += written;
+                left -= static_cast<std::size_t>(written);
+            }
+            out.clear();
+        }
+    }
+};
+
+/**
+ * @class ShardProxy
+ * @brief accepts game connections on a Unix socket and spreads the sessions over several AnimalShard processes by their top-level subtree
+ *
+ * The proxy forks the shards itself, each with a copy of the tree, and talks to each over one socket pair. It keeps no tree of its own:
+ * it passes each player's lines to the shard holding the session, one line at a time, and the shard's replies back, and moves a session
+ * to another shard when its shard hands it on. Learns above the cut, reported by the top owner, are copied to every other shard.
+ * Players see the same line protocol as AnimalServer, with learning: after a wrong guess they are asked for their animal, a question and its answer
+ * (and, when a leaf holds several animals, how each of them answers it)
+ * A player who sends no line for the idle timeout is disconnected, with a timer per player in a TimingWheel as in AnimalServer
+ */
+class ShardProxy {
+public:
+    struct Stats {
+        std::size_t sessions = 0;
+        std::size_t lines = 0;
+        std::size_t migrations = 0;
+        std::size_t topLearns = 0;
+        // sessions a shard could not resume where another shard left them, which means the tops of their trees have drifted apart
+        std::size_t strayRoutes = 0;
+        std::vector<std::size_t> linesPerShard;
+    };
+
+private:
+    struct Shard {
+        pid_t pid = -1;
+        int fd = -1;
+        std::string input;
+        OutputBuffer output;
+    };
+
+    struct Player {
+        int fd = -1;
+        unsigned shard = 0;
+        std::string input;
+        OutputBuffer output;
+        // a line or a resume is with the shard, and the player's next line waits here until the shard says it is done
+        bool waiting = true;
+    };
+
+    static constexpr std::size_t kMaxInput = 4096;
+    // a player this far behind on reading its replies is dropped rather than buffered for without end
+    static constexpr std::size_t kMaxOutput = std::size_t{1} << 20;
+    static constexpr uint64_t kDefaultIdleTimeout = 10 * 60 * 1000;
+
+    ShardRing ring;
+    std::string socketPath;
+    int listener = -1;
+    std::vector<Shard> shards;
+    std::unordered_map<uint64_t, Player> players;
+    std::unordered_map<int, uint64_t> playerByFd;
+    // players given output this turn, flushed together once the shards' replies have all been read
+    std::vector<uint64_t> unflushed;
+    uint64_t nextId = 1;
+    Stats stats;
+    // idle timers by player descriptor, in milliseconds since epoch
+    TimingWheel idle;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    uint64_t idleTimeout = kDefaultIdleTimeout;
+
+    static inline StopSignal stop;
+
+    uint64_t tick() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    // tick() rounds down, so the line may have come up to a tick's worth later than it says; one more tick makes sure the whole timeout has passed
+    void touch(int fd) { idle.schedule(static_cast<TimingWheel::Id>(fd), tick() + idleTimeout + 1); }
+
+    // how long poll() may sleep: until the next idle timer comes due, or for good if there are no players
+    int pollTimeout() const {
+        uint64_t next = idle.nextExpiry();
+        if (next == UINT64_MAX) return -1;
+        uint64_t now = tick();
+        return next <= now ? 0 : static_cast<int>(std::min<uint64_t>(next - now, INT_MAX));
+    }
+
+    void toShard(unsigned shard, char verb, const std::string& rest) {
+        std::string message(1, verb);
+        message += ' ';
+        message += rest;
+        message += '\n';
+        shards[shard].output.append(message);
+    }
+
+    void forward(uint64_t id, Player& player) {
+        std::size_t end;
+        while (!player.waiting && (end = player.input.find('\n')) != std::string::npos) {
+            std::string line = player.input.substr(0, end);
+            player.input.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            std::replace(line.begin(), line.end(), '\t', ' ');
+            toShard(player.shard, 'L', std::to_string(id) + ' ' + line);
+            player.waiting = true;
+            ++stats.lines;
+            ++stats.linesPerShard[player.shard];
+        }
+    }
+
+    void closePlayer(uint64_t id, bool tellShard) {
+        auto found = players.find(id);
+        if (found == players.end()) return;
+        if (tellShard) toShard(found->second.shard, 'E', std::to_string(id));
+        idle.cancel(static_cast<TimingWheel::Id>(found->second.fd));
+        playerByFd.erase(found->second.fd);
+        ::close(found->second.fd);
+        players.erase(found);
+    }
+
+    void accept() {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (fd < 0) return;
+        uint64_t id = nextId++;
+        Player& player = players[id];
+        player.fd = fd;
+        player.shard = ring.topOwner();
+        playerByFd[fd] = id;
+        touch(fd);
+        toShard(player.shard, 'S', std::to_string(id) + " -");
+        ++stats.sessions;
+    }
+
+    void readPlayer(int fd) {
+        char buffer[4096];
+        ssize_t got = ::read(fd, buffer, sizeof(buffer));
+        if (got < 0 && (errno == EINTR || errno == EAGAIN)) return;
+        uint64_t id = playerByFd[fd];
+        if (got <= 0) {
+            closePlayer(id, true);
+            return;
+        }
+        Player& player = players[id];
+        if (std::find(buffer, buffer + got, '\n') != buffer + got) touch(fd);
+        player.input.append(buffer, static_cast<std::size_t>(got));
+        if (player.input.size() > kMaxInput) {
+            closePlayer(id, true);
+            return;
+        }
+        forward(id, player);
+    }
+
+    void handleShard(unsigned from, const std::string& line) {
+        if (line.size() < 3 || line[1] != ' ') return;
+        if (line[0] == 'T') {
+            for (unsigned s = 0; s < shards.size(); ++s) {
+                if (s != from) toShard(s, 'A', line.substr(2));
+            }
+            ++stats.topLearns;
+            return;
+        }
+        auto space = line.find(' ', 2);
+        uint64_t id = std::stoull(line.substr(2, space - 2));
+        auto found = players.find(id);
+        // the player may have left while the shard was still answering
+        if (found == players.end()) return;
+        Player& player = found->second;
+        switch (line[0]) {
+            case 'P':
+                if (player.output.empty()) unflushed.push_back(id);
+                player.output.append((space == std::string::npos ? std::string() : line.substr(space + 1)) + "\n");
+                break;
+            case 'D':
+                player.waiting = false;
+                forward(id, player);
+                break;
+            case 'M':
+                player.shard = ring.owner(line.substr(space + 1) == "-" ? std::string() : line.substr(space + 1));
+                toShard(player.shard, 'S', std::to_string(id) + ' ' + line.substr(space + 1));
+                ++stats.migrations;
+                break;
+            case 'Q':
+                closePlayer(id, false);
+                break;
+            case 'X':
+                ++stats.strayRoutes;
+                break;
+        }
+    }
+
+    void readShard(unsigned index) {
+        Shard& shard = shards[index];
+        char buffer[65536];
+        ssize_t got = ::read(shard.fd, buffer, sizeof(buffer));
+        if (got < 0 && (errno == EINTR || errno == EAGAIN)) return;
+        if (got <= 0) throw std::runtime_error("shard " + std::to_string(index) + " exited");
+        shard.input.append(buffer, static_cast<std::size_t>(got));
+        std::size_t start = 0, end;
+        while ((end = shard.input.find('\n', start)) != std::string::npos) {
+            handleShard(index, shard.input.substr(start, end - start));
+            start = end + 1;
+        }
+        shard.input.erase(0, start);
+    }
+
+    // sends what the socket takes of a player's replies; a player that went away or stopped reading is closed
+    void flushPlayer(uint64_t id) {
+        auto found = players.find(id);
+        if (found == players.end()) return;
+        OutputBuffer& output = found->second.output;
+        if (!output.flush(found->second.fd) || output.size() > kMaxOutput) closePlayer(id, true);
+    }
+
+    // closes every player whose idle timer has run out since the last turn, all together
+    void dropIdle(std::vector<TimingWheel::Id>& expired) {
+        expired.clear();
+        idle.advance(tick(), [&expired](TimingWheel::Id fd) { expired.push_back(fd); });
+        for (TimingWheel::Id fd : expired) {
+            auto found = playerByFd.find(static_cast<int>(fd));
+            if (found == playerByFd.end()) continue;
+            Player& player = players.at(found->second);
+            player.output.append("You have been idle too long. Goodbye.\n");
+            player.output.flush(player.fd);
+            closePlayer(found->second, true);
+        }
+    }
+
+    void flushShards() {
+        for (auto& shard : shards) {
+            if (!shard.output.flush(shard.fd)) throw std::runtime_error(std::string("cannot write to shard: ") + std::strerror(errno));
+        }
+    }
+
+public:
+    /**
+     * @brief forks the shards, each with the tree read from treeSource, and starts listening for players on socketPath
+     * @param shards the number of engine processes
+     * @param depth how many answers from the root name a top-level subtree; deeper cuts spread sessions more evenly,
+     * but leave more of every game with the top owner
+     * @param bucketCapacity how many animals one guess may hold, see AnimalEngine
+     * @param metadataPath a file written by MetadataFile::write() whose descriptions are shown with guesses, or empty for none
+     * @throws std::runtime_error if the tree or metadata cannot be read or a shard or the socket cannot be created
+     */
+    ShardProxy(const std::string& socketPath, std::istream& treeSource, unsigned shards, unsigned depth, std::size_t bucketCapacity = 1,
+               const std::string& metadataPath = "")
+        : ring(shards, depth), socketPath(socketPath) {
+        AnimalEngine engine(bucketCapacity);
+        if (!engine.load(treeSource)) throw std::runtime_error("not a question tree");
+        if (!metadataPath.empty()) engine.openMetadata(metadataPath);
+        stats.linesPerShard.assign(ring.shards(), 0);
+        for (unsigned index = 0; index < ring.shards(); ++index) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+                throw std::runtime_error(std::string("cannot create shard socket: ") + std::strerror(errno));
+            }
+            pid_t pid = fork();
+            if (pid < 0) throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+            if (pid == 0) {
+                // the shard keeps only its own end; the engine is its copy-on-write copy of the one loaded above
+                for (const auto& other : this->shards) ::close(other.fd);
+                ::close(pair[0]);
+                std::signal(SIGINT, SIG_IGN);
+                std::signal(SIGTERM, SIG_DFL);
+                // an exception must not unwind out of the constructor, into the parent's code, in the shard's process
+                try {
+                    AnimalShard(engine, ring, index, pair[1]).run();
+                } catch (const std::exception& e) {
+                    std::cerr << "shard " << index << ": " << e.what() << "\n";
+                    _exit(EXIT_FAILURE);
+                }
+                _exit(0);
+            }
+            ::close(pair[1]);
+            setNonBlocking(pair[0]);
+            this->shards.push_back({pid, pair[0], {}, {}});
+        }
+        listener = listenUnix(socketPath);
+    }
+
+    ShardProxy(const ShardProxy&) = delete;
+    ShardProxy& operator=(const ShardProxy&) = delete;
+
+    /**
+     * @brief closes every connection; each shard exits when its socket closes, and is waited for
+     */
+    ~ShardProxy() {
+        for (const auto& [id, player] : players) ::close(player.fd);
+        if (listener >= 0) {
+            ::close(listener);
+            ::unlink(socketPath.c_str());
+        }
+        for (auto& shard : shards) ::close(shard.fd);
+        for (auto& shard : shards) {
+            int status = 0;
+            while (waitpid(shard.pid, &status, 0) < 0 && errno == EINTR) {}
+        }
+    }
+
+    const Stats& statistics() const { return stats; }
+    const ShardRing& shardRing() const { return ring; }
+
+    /**
+     * @brief how long a player may go without sending a line before being disconnected; 10 minutes unless set
+     * Timers already running keep the timeout they were started with until the player's next line
+     */
+    void setIdleTimeout(std::chrono::milliseconds timeout) { idleTimeout = static_cast<uint64_t>(std::max<std::chrono::milliseconds::rep>(timeout.count(), 1)); }
+
+    /**
+     * @brief makes run() return at its next turn; safe to call from a signal handler
+     */
+    static void requestStop(int = 0) { stop.request(); }
+
+    /**
+     * @brief routes players and shards until requestStop() is called
+     * @throws std::runtime_error if a shard dies
+     */
+    void run() {
+        stop.arm();
+        std::vector<pollfd> polled;
+        std::vector<pollfd> ready;
+        std::vector<TimingWheel::Id> expired;
+        while (!stop.requested()) {
+            dropIdle(expired);
+            polled.clear();
+            polled.push_back({listener, POLLIN, 0});
+            polled.push_back({stop.descriptor(), POLLIN, 0});
+            for (const auto& shard : shards) polled.push_back({shard.fd, static_cast<short>(POLLIN | (shard.output.empty() ? 0 : POLLOUT)), 0});
+            for (const auto& [fd, id] : playerByFd) {
+                polled.push_back({fd, static_cast<short>(POLLIN | (players.at(id).output.empty() ? 0 : POLLOUT)), 0});
+            }
+            // sleeps until a descriptor is ready, requestStop() writes to its pipe or the next idle timer comes due
+            int events = poll(polled.data(), polled.size(), pollTimeout());
+            if (events < 0 && errno != EINTR) throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+            if (events <= 0) continue;
+
+            if (polled[0].revents & POLLIN) accept();
+            if (polled[1].revents) stop.drain();
+            for (unsigned s = 0; s < shards.size(); ++s) {
+                if (polled[2 + s].revents & (POLLIN | POLLHUP | POLLERR)) readShard(s);
+            }
+            ready.clear();
+            for (std::size_t i = 2 + shards.size(); i < polled.size(); ++i) {
+                if (polled[i].revents) ready.push_back(polled[i]);
+            }
+            for (const pollfd& entry : ready) {
+                auto found = playerByFd.find(entry.fd);
+                if (found == playerByFd.end()) continue;
+                if (entry.revents & POLLOUT) flushPlayer(found->second);
+                if ((entry.revents & ~POLLOUT) && playerByFd.count(entry.fd)) readPlayer(entry.fd);
+            }
+            for (uint64_t id : unflushed) flushPlayer(id);
+            unflushed.clear();
+            flushShards();
+        }
+    }
+};
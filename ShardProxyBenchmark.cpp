@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "AnimalEngine.h"
+#include "AnimalMetadata.h"
+#include "PerfCounters.h"
+#include "ShardProxy.h"
+
+static constexpr int kSeedAnimals = 20000;
+static constexpr int kWorld = 60000;
+static constexpr int kPlayers = 64;
+static constexpr int kGames = 40000;
+static constexpr unsigned kDepth = 4;
+static constexpr unsigned kTraits = 1024;
+static std::size_t linesSent = 0;
+// set while the proxy shows metadata: the description every guess should come with, and the guesses that came without it
+static bool described = false;
+static std::size_t undescribed = 0;
+static const std::string kRootQuestion = "Is your animal warm or cold blooded?";
+
+static uint64_t mix(const std::string& text) {
+    uint64_t h = 1469598103934665603ull;
+    for (char c : text) h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ull;
+    return h ^ (h >> 32);
+}
+
+/**
+ * @brief how an animal really answers a question: the initial Dog and Snake answer the first question as the game expects,
+ * and every other answer is a fixed coin flip, so every player thinking of the same animal answers the same way
+ */
+static bool truth(const std::string& animal, const std::string& question) {
+    if (question == kRootQuestion && (animal == "Dog" || animal == "Snake")) return animal == "Dog";
+    return mix(animal + '\n' + question) & 1;
+}
+
+// the first trait, from a point that depends on both animals, that tells them apart
+static std::string distinguish(const std::string& animal, const std::string& other) {
+    unsigned first = static_cast<unsigned>(mix(animal + '|' + other) % kTraits);
+    for (unsigned k = 0; k < kTraits; ++k) {
+        std::string question = "Trait " + std::to_string((first + k) % kTraits) + "?";
+        if (truth(animal, question) != truth(other, question)) return question;
+    }
+    throw std::runtime_error("no trait tells " + animal + " from " + other);
+}
+
+static std::string animalName(int i) { return "Animal " + std::to_string(i); }
+static std::string description(const std::string& animal) { return "About " + animal + "."; }
+
+/**
+ * @class Player
+ * @brief one connection playing honestly: it answers every question as its animal would, and teaches the game whenever the guess is wrong
+ */
+class Player {
+    int fd = -1;
+    std::string received;
+    std::string question;
+    std::string previous;
+
+public:
+    std::string animal;
+    bool finished = false;
+
+    explicit Player(const std::string& socketPath) : fd(connectUnix(socketPath)) {}
+    Player(Player&& other) noexcept
+        : fd(std::exchange(other.fd, -1)), received(std::move(other.received)), question(std::move(other.question)),
+          previous(std::move(other.previous)), animal(std::move(other.animal)), finished(other.finished) {}
+    ~Player() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    int descriptor() const { return fd; }
+
+    void say(const std::string& line) {
+        std::string text = line + "\n";
+        ++linesSent;
+        if (::send(fd, text.data(), text.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(text.size())) throw std::runtime_error("lost the proxy");
+    }
+
+    /**
+     * @brief waits until the proxy hangs up, as it does on a player who stays quiet too long
+     * @return true if the proxy said why before hanging up
+     */
+    bool droppedForIdling() {
+        char buffer[4096];
+        ssize_t got;
+        while ((got = ::read(fd, buffer, sizeof(buffer))) != 0) {
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) return false;
+            received.append(buffer, static_cast<std::size_t>(got));
+        }
+        return received.find("idle too long") != std::string::npos;
+    }
+
+    void quit() {
+        say("quit");
+        ::close(fd);
+        fd = -1;
+        finished = true;
+    }
+
+    /**
+     * @brief reads what the proxy sent and answers every whole line of it
+     * @param gameOver called with true for a game that ended in a learn and false for one that ended in a right guess;
+     * it may pick the next animal or call quit()
+     */
+    template <typename GameOver>
+    void receive(GameOver gameOver) {
+        char buffer[4096];
+        ssize_t got = ::read(fd, buffer, sizeof(buffer));
+        if (got < 0 && errno == EINTR) return;
+        if (got <= 0) throw std::runtime_error("lost the proxy");
+        received.append(buffer, static_cast<std::size_t>(got));
+        std::size_t start = 0, end;
+        while (!finished && (end = received.find('\n', start)) != std::string::npos) {
+            std::string line = received.substr(start, end - start);
+            start = end + 1;
+            const std::string ask = " (yes/no)";
+            if (line.size() > ask.size() && line.compare(line.size() - ask.size(), ask.size(), ask) == 0) {
+                std::string text = line.substr(0, line.size() - ask.size());
+                if (text.rfind("Is it a ", 0) == 0) {
+                    std::string guess = text.substr(8, text.size() - 9);
+                    undescribed += described && previous != description(guess);
+                    say(guess == animal ? "yes" : "no");
+                } else if (text.rfind("And for a ", 0) == 0) {
+                    // a leaf holding several animals is split by the new question too, and the player knows how each of them answers it
+                    say(truth(text.substr(10, text.size() - 11), question) ? "yes" : "no");
+                } else if (text.rfind("For a ", 0) == 0) {
+                    say(truth(animal, question) ? "yes" : "no");
+                } else {
+                    say(truth(animal, text) ? "yes" : "no");
+                }
+            } else if (line == "I give up! What is your animal?") {
+                say(animal);
+            } else if (line.rfind("What question distinguishes a ", 0) == 0) {
+                std::size_t from = line.find(" from a ");
+                question = distinguish(animal, line.substr(from + 8, line.size() - from - 9));
+                say(question);
+            } else if (line == "Yay! I guessed it right!") {
+                gameOver(*this, false);
+            } else if (line == "Got it! I'll remember that for next time." || line.rfind("Got it! I'll guess a ", 0) == 0) {
+                gameOver(*this, true);
+            } else if (line.rfind("Please answer", 0) == 0) {
+                throw std::runtime_error("the proxy did not understand " + animal + "'s player");
+            }
+            previous = line;
+        }
+        received.erase(0, start);
+    }
+};
+
+/**
+ * @brief serves every player until they are all finished, keeping each one's socket drained so no side ever blocks for long
+ */
+template <typename GameOver>
+static void playAll(std::vector<Player>& players, GameOver gameOver) {
+    std::vector<pollfd> polled;
+    std::vector<Player*> owners;
+    while (true) {
+        polled.clear();
+        owners.clear();
+        for (auto& player : players) {
+            if (player.finished) continue;
+            polled.push_back({player.descriptor(), POLLIN, 0});
+            owners.push_back(&player);
+        }
+        if (polled.empty()) return;
+        if (poll(polled.data(), polled.size(), 10000) <= 0) throw std::runtime_error("the proxy stopped answering");
+        for (std::size_t i = 0; i < polled.size(); ++i) {
+            if (polled[i].revents) owners[i]->receive(gameOver);
+        }
+    }
+}
+
+/**
+ * @struct Setup
+ * @brief how one case's proxy is started
+ */
+struct Setup {
+    unsigned shards = 1;
+    std::size_t bucketCapacity = 1;
+    std::string metadataPath{};
+    // a case starting from the initial tree does most of its early learning above the cut, so learns must have been copied
+    bool fromInitialTree = false;
+    // zero for the proxy's default
+    std::chrono::milliseconds idleTimeout{};
+};
+
+/**
+ * @brief starts a proxy in a child process, which prints its routing totals when stopped and fails if a shard's copy of the top of the tree
+ * drifted from the others (a session could not be resumed where it was handed over), or if nothing was copied when it should have been
+ */
+static pid_t startProxy(const std::string& socketPath, const std::string& treeText, const Setup& setup) {
+    // anything still buffered would otherwise be printed again by the child
+    std::cout << std::flush;
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+    int status = EXIT_SUCCESS;
+    try {
+        std::signal(SIGTERM, ShardProxy::requestStop);
+        std::istringstream in(treeText);
+        ShardProxy proxy(socketPath, in, setup.shards, kDepth, setup.bucketCapacity, setup.metadataPath);
+        if (setup.idleTimeout.count() > 0) proxy.setIdleTimeout(setup.idleTimeout);
+        proxy.run();
+        const auto& stats = proxy.statistics();
+        std::cout << "  proxy: " << stats.sessions << " sessions, " << stats.lines << " lines, " << stats.migrations << " moves between shards, "
+                  << stats.topLearns << " learns above the cut copied, " << stats.strayRoutes << " sessions not resumable\n  lines per shard:";
+        for (std::size_t lines : stats.linesPerShard) std::cout << " " << lines;
+        std::cout << "\n" << std::flush;
+        if (stats.strayRoutes != 0 || (setup.fromInitialTree && setup.shards > 1 && stats.topLearns == 0)) status = EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        std::cerr << "proxy: " << e.what() << "\n";
+        status = EXIT_FAILURE;
+    }
+    _exit(status);
+}
+
+/**
+ * @brief plays kGames learn-heavy games through a proxy, then checks every animal played is now guessed without being taught again
+ * @return the number of problems found
+ */
+static int runCase(const std::string& label, const Setup& setup, const std::string& treeText, const std::vector<std::string>& seeded) {
+    const std::string socketPath = "/tmp/animal-shards-" + std::to_string(getpid()) + ".sock";
+    pid_t proxy = startProxy(socketPath, treeText, setup);
+    described = !setup.metadataPath.empty();
+    undescribed = 0;
+    while (::access(socketPath.c_str(), F_OK) != 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    int problems = 0;
+    std::mt19937 rng(98);
+    std::unordered_set<std::string> taught(seeded.begin(), seeded.end());
+    int games = 0, started = 0, learns = 0;
+    linesSent = 0;
+    auto next = [&](Player& player) {
+        if (started == kGames) {
+            player.quit();
+            return;
+        }
+        ++started;
+        player.animal = animalName(static_cast<int>(rng() % kWorld));
+    };
+
+    PerfCounters counters;
+    auto start = std::chrono::steady_clock::now();
+    counters.start();
+    try {
+        std::vector<Player> players;
+        for (int i = 0; i < kPlayers; ++i) {
+            players.emplace_back(socketPath);
+            next(players.back());
+        }
+        playAll(
+            players,
+            [&](Player& player, bool learned) {
+                ++games;
+                learns += learned;
+                taught.insert(player.animal);
+                next(player);
+            });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        ++problems;
+    }
+    counters.stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << label << ": " << games << " games in " << seconds << " s, " << games / seconds << " games/s, " << learns / seconds
+              << " learns/s, " << static_cast<double>(linesSent) / seconds << " lines/s (" << 100.0 * learns / std::max(games, 1) << "% of games teach)\n  ";
+    counters.print(std::cout);
+
+    // every animal played or seeded is guessed without the player teaching it again, whichever shards its subtree and the top of the tree
+    // went through; a leaf holding several animals may guess others first
+    std::vector<std::string> probes(taught.begin(), taught.end());
+    std::sort(probes.begin(), probes.end());
+    std::size_t probed = 0, missed = 0;
+    try {
+        std::vector<Player> players;
+        auto nextProbe = [&](Player& player) {
+            if (probed == probes.size()) player.quit();
+            else player.animal = probes[probed++];
+        };
+        for (int i = 0; i < kPlayers; ++i) {
+            players.emplace_back(socketPath);
+            nextProbe(players.back());
+        }
+        playAll(players, [&](Player& player, bool learned) {
+            missed += learned;
+            nextProbe(player);
+        });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        ++problems;
+    }
+    std::cout << "  " << probes.size() << " animals probed, " << missed << " not guessed";
+    if (described) std::cout << ", " << undescribed << " guesses shown without their description";
+    std::cout << "\n" << std::flush;
+    problems += static_cast<int>(missed + undescribed);
+
+    kill(proxy, SIGTERM);
+    int status = 0;
+    waitpid(proxy, &status, 0);
+    problems += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    return problems;
+}
+
+/**
+ * @brief checks that a player who stops answering is dropped once the idle timeout has passed, while one who keeps answering stays
+ * @return the number of problems found
+ */
+static int checkIdleTimeout(const std::string& treeText) {
+    const std::string socketPath = "/tmp/animal-shards-idle-" + std::to_string(getpid()) + ".sock";
+    Setup setup{.shards = 2, .idleTimeout = std::chrono::milliseconds(300)};
+    pid_t proxy = startProxy(socketPath, treeText, setup);
+    while (::access(socketPath.c_str(), F_OK) != 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    int problems = 0;
+    try {
+        Player quiet(socketPath), busy(socketPath);
+        busy.animal = animalName(1);
+        auto connected = std::chrono::steady_clock::now();
+        std::size_t answered = 0;
+        std::thread answering([&] {
+            try {
+                for (int i = 0; i < 12; ++i) {
+                    std::this_thread::sleep_for(setup.idleTimeout / 3);
+                    busy.receive([](Player& player, bool) { player.animal = animalName(2); });
+                    ++answered;
+                }
+            } catch (const std::exception&) {
+            }
+        });
+        bool dropped = quiet.droppedForIdling();
+        double droppedAfter = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - connected).count();
+        answering.join();
+        double timeout = static_cast<double>(setup.idleTimeout.count());
+        std::cout << "with a " << timeout << " ms idle timeout, a quiet player was " << (dropped ? "" : "NOT ") << "dropped after " << droppedAfter
+                  << " ms, and a player answering every " << timeout / 3 << " ms was " << (answered == 12 ? "kept" : "NOT kept") << "\n" << std::flush;
+        problems += !dropped || droppedAfter < timeout || droppedAfter >= 3 * timeout || answered != 12;
+        busy.quit();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        ++problems;
+    }
+    kill(proxy, SIGTERM);
+    int status = 0;
+    waitpid(proxy, &status, 0);
+    problems += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    return problems;
+}
+
+int main() {
+    rlimit files{};
+    getrlimit(RLIMIT_NOFILE, &files);
+    if (files.rlim_cur < 4 * kPlayers) {
+        files.rlim_cur = std::min<rlim_t>(files.rlim_max, 4 * kPlayers);
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    // a tree that already knows a third of the world, taught the same honest way the players teach
+    AnimalEngine engine;
+    std::ostringstream initial;
+    engine.save(initial);
+    const std::vector<std::string> known{"Dog", "Snake"};
+    std::vector<std::string> seeded = known;
+    for (int i = 0; i < kSeedAnimals; ++i) {
+        std::string animal = animalName(i);
+        AnimalEngine::Cursor cursor = engine.start();
+        while (!cursor.atGuess()) engine.answer(cursor, truth(animal, cursor.question()));
+        std::string question = distinguish(animal, cursor.guess());
+        engine.learn(cursor, animal, question, truth(animal, question));
+        seeded.push_back(animal);
+    }
+    std::ostringstream saved;
+    engine.save(saved);
+    std::cout << kPlayers << " players, " << kGames << " games over a world of " << kWorld << " animals, " << kSeedAnimals
+              << " of them known at the start; subtrees cut " << kDepth << " answers down\n";
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> shardCounts{1, 2, 4};
+    if (cores > 4) shardCounts.push_back(cores);
+    int problems = 0;
+    for (unsigned shards : shardCounts) problems += runCase(std::to_string(shards) + " shard(s)", Setup{.shards = shards}, saved.str(), seeded);
+
+    // from the initial tree, the top of the tree is learned through the proxy, so every shard only knows it from the learns copied to it
+    // and a session handed to any of them must resume at the same question
+    problems += runCase("4 shard(s) from the initial tree", Setup{.shards = 4, .fromInitialTree = true}, initial.str(), known);
+
+    // leaves holding several animals, with descriptions shown from a metadata file before each guess
+    std::vector<std::pair<std::string, AnimalMetadata>> records;
+    for (const auto& animal : known) records.push_back({animal, AnimalMetadata{description(animal), {}, {}}});
+    for (int i = 0; i < kWorld; ++i) records.push_back({animalName(i), AnimalMetadata{description(animalName(i)), {}, {}}});
+    const std::string metadataPath = "ShardProxyBenchmark.meta";
+    MetadataFile::write(metadataPath, records);
+    problems += runCase("4 shard(s), 3 animals per guess, with metadata", Setup{.shards = 4, .bucketCapacity = 3, .metadataPath = metadataPath}, saved.str(), seeded);
+    std::remove(metadataPath.c_str());
+
+    problems += checkIdleTimeout(saved.str());
+
+    std::cout << (problems ? std::to_string(problems) + " problem(s) found" : std::string("every animal taught through the proxy is guessed")) << "\n";
+    return problems ? EXIT_FAILURE : EXIT_SUCCESS;
+}
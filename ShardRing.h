@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @class ShardRing
+ * @brief consistent hashing of the question tree's top-level subtrees onto shards
+ *
+ * A subtree is named by the answers that lead to it from the root, cut to the ring's depth, so every session in the same subtree
+ * hashes to the same shard. Each shard sits at kVirtualNodes points on a 64-bit ring and a subtree belongs to the first point at or after
+ * its hash, which spreads subtrees evenly and means adding a shard only moves the subtrees that land on its new points
+ * Everything above the cut (the top of the tree, and any session that has not answered depth questions yet) belongs to the shard
+ * that owns the empty route
+ */
+class ShardRing {
+    std::vector<std::pair<uint64_t, unsigned>> points;
+    unsigned depthCut;
+    unsigned shardCount;
+
+    static uint64_t hash(const std::string& text) {
+        // 64-bit FNV-1a, then the MurmurHash3 finalizer: FNV alone barely stirs the high bits of short strings,
+        // so routes differing only in their last answer would land next to each other on the ring
+        uint64_t h = 14695981039346656037ull;
+        for (char c : text) h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+public:
+    static constexpr unsigned kVirtualNodes = 64;
+
+    ShardRing(unsigned shards, unsigned depth) : depthCut(depth), shardCount(std::max(shards, 1u)) {
+        for (unsigned shard = 0; shard < shardCount; ++shard) {
+            for (unsigned v = 0; v < kVirtualNodes; ++v) points.emplace_back(hash("shard " + std::to_string(shard) + " " + std::to_string(v)), shard);
+        }
+        std::sort(points.begin(), points.end());
+    }
+
+    unsigned shards() const { return shardCount; }
+    unsigned depth() const { return depthCut; }
+
+    /**
+     * @brief the shard that serves a session whose answers so far are route
+     */
+    unsigned owner(const std::string& route) const {
+        std::string subtree = route.size() < depthCut ? std::string() : route.substr(0, depthCut);
+        auto at = std::lower_bound(points.begin(), points.end(), std::make_pair(hash(subtree), 0u));
+        return (at == points.end() ? points.front() : *at).second;
+    }
+
+    /**
+     * @brief the shard that owns the top of the tree, above the cut
+     */
+    unsigned topOwner() const { return owner(std::string()); }
+};
@@ -0,0 +1,115 @@
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "ShardedTransform.h"
+
+/**
+ * @brief the settings of one run of the driver, filled in from the command line
+ */
+struct Options {
+    std::string input;
+    std::string output;
+    std::string type = "int64";
+    int power = 2;
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t generate = 0;
+    bool verify = false;
+};
+
+static void usage() {
+    std::cerr << "usage: ShardedPower [--power N] [--workers K] [--type int32|int64|uint32|uint64|float|double]\n"
+                 "                    [--generate COUNT] [--verify] INPUT [OUTPUT]\n"
+                 "Raises every value of the binary file INPUT to the power N in K worker processes, into OUTPUT or in place.\n"
+                 "--generate first writes the values 1..COUNT to INPUT; --verify checks every result afterwards.\n";
+}
+
+static bool parse(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--power" && hasValue) options.power = std::stoi(argv[++i]);
+        else if (arg == "--workers" && hasValue) options.workers = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--type" && hasValue) options.type = argv[++i];
+        else if (arg == "--generate" && hasValue) options.generate = std::stoull(argv[++i]);
+        else if (arg == "--verify") options.verify = true;
+        else if (!arg.empty() && arg[0] == '-') return false;
+        else if (options.input.empty()) options.input = arg;
+        else if (options.output.empty()) options.output = arg;
+        else return false;
+    }
+    return !options.input.empty();
+}
+
+/**
+ * @brief maps the files, runs the sharded transform and reports it, for one element type
+ * @return the process exit status
+ */
+template <typename T>
+static int run(const Options& options) {
+    if (options.generate > 0) {
+        MappedFile file = MappedFile::create(options.input, options.generate * sizeof(T));
+        T* values = file.as<T>();
+        for (std::size_t i = 0; i < options.generate; ++i) values[i] = static_cast<T>(i + 1);
+        file.flush();
+    }
+
+    bool inPlace = options.output.empty();
+    MappedFile input = MappedFile::open(options.input, inPlace);
+    std::size_t count = input.size() / sizeof(T);
+    if (input.size() % sizeof(T) != 0) std::cerr << "ignoring " << input.size() % sizeof(T) << " trailing bytes of " << options.input << "\n";
+    MappedFile output = inPlace ? MappedFile::open(options.input, true) : MappedFile::create(options.output, count * sizeof(T));
+    if (options.verify && inPlace && options.generate == 0) {
+        std::cerr << "--verify needs an OUTPUT file or --generate, since in place the original values are gone\n";
+        return EXIT_FAILURE;
+    }
+
+    Nth_Power<T> power{options.power};
+    auto report = ShardedTransform<T>::run(input.as<T>(), output.as<T>(), count, power, options.workers);
+    output.flush();
+
+    double megabytes = static_cast<double>(count * sizeof(T)) / 1e6;
+    std::cout << count << " values (" << megabytes << " MB) raised to the power " << options.power << " by " << report.workers.size()
+              << " worker(s) in " << report.seconds << " s, " << megabytes / report.seconds << " MB/s\n";
+    for (std::size_t w = 0; w < report.workers.size(); ++w) {
+        const auto& worker = report.workers[w];
+        std::cout << "  worker " << w << " (pid " << worker.pid << "): values " << worker.begin << ".." << worker.end << " in " << worker.seconds
+                  << " s\n";
+    }
+
+    if (options.verify) {
+        const T* in = input.as<T>();
+        const T* out = output.as<T>();
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            T original = inPlace ? static_cast<T>(i + 1) : in[i];
+            mismatches += out[i] != power(original);
+        }
+        std::cout << "verified " << count << " values, " << mismatches << " mismatches\n";
+        if (mismatches != 0) return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parse(argc, argv, options)) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (options.type == "int32") return run<int32_t>(options);
+        if (options.type == "int64") return run<int64_t>(options);
+        if (options.type == "uint32") return run<uint32_t>(options);
+        if (options.type == "uint64") return run<uint64_t>(options);
+        if (options.type == "float") return run<float>(options);
+        if (options.type == "double") return run<double>(options);
+        std::cerr << "unknown type " << options.type << "\n";
+        usage();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+    }
+    return EXIT_FAILURE;
+}
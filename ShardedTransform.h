@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "MappedFile.h"
+#include "Nth_Power.h"
+
+/**
+ * @class ShardedTransform
+ * @brief raises every value of a large shared buffer to a power by forking worker processes that each transform one shard of it
+ *
+ * The buffers are expected to be MAP_SHARED mappings (MappedFile, or anonymous shared memory), which the workers inherit across fork,
+ * so no data is copied between processes: each worker runs the Nth_Power batch kernel straight from the input pages into the output pages
+ * Shards are whole pages, so in a page-aligned mapping no two workers ever write the same page or cache line
+ * Workers publish their progress and timing in a small shared block, and the parent waits for all of them and fails if any of them failed
+ */
+template <typename T>
+class ShardedTransform {
+public:
+    struct WorkerReport {
+        pid_t pid;
+        std::size_t begin;
+        std::size_t end;
+        double seconds;
+    };
+
+    struct Report {
+        std::vector<WorkerReport> workers;
+        double seconds;
+    };
+
+private:
+    // written by the workers, read by the parent once they have exited
+    struct SharedProgress {
+        std::atomic<uint64_t> done;
+        std::atomic<uint64_t> nanoseconds;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "progress counters must work across processes");
+
+    // workers report progress after every step of this many values
+    static constexpr std::size_t kStep = std::size_t{1} << 20;
+
+    static void work(const T* in, T* out, std::size_t begin, std::size_t end, const Nth_Power<T>& power, SharedProgress& progress) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = begin; i < end; i += kStep) {
+            std::size_t m = std::min(kStep, end - i);
+            power.apply(in + i, out + i, m);
+            progress.done.fetch_add(m, std::memory_order_relaxed);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        progress.nanoseconds.store(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    }
+
+public:
+    /**
+     * @brief transforms in[0, count) into out (which may be in), split across up to workers processes
+     * @throws std::runtime_error if a worker cannot be started, or exits without finishing its shard
+     */
+    static Report run(const T* in, T* out, std::size_t count, const Nth_Power<T>& power, unsigned workers) {
+        const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) / sizeof(T);
+        std::size_t pages = (count + page - 1) / page;
+        workers = static_cast<unsigned>(std::clamp<std::size_t>(workers, 1, std::max<std::size_t>(pages, 1)));
+
+        std::size_t sharedBytes = sizeof(SharedProgress) * workers;
+        void* shared = mmap(nullptr, sharedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shared == MAP_FAILED) throw std::runtime_error(std::string("cannot map progress block: ") + std::strerror(errno));
+        auto* progress = static_cast<SharedProgress*>(shared);
+        for (unsigned w = 0; w < workers; ++w) new (&progress[w]) SharedProgress{{0}, {0}};
+
+        Report report;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned w = 0; w < workers; ++w) {
+            std::size_t begin = std::min(count, pages * w / workers * page);
+            std::size_t end = std::min(count, pages * (w + 1) / workers * page);
+            pid_t pid = fork();
+            if (pid < 0) {
+                int error = errno;
+                for (const auto& started : report.workers) waitpid(started.pid, nullptr, 0);
+                munmap(shared, sharedBytes);
+                throw std::runtime_error(std::string("fork failed: ") + std::strerror(error));
+            }
+            if (pid == 0) {
+                // the child must never return into the caller's code, whatever happens
+                int status = 0;
+                try {
+                    work(in, out, begin, end, power, progress[w]);
+                } catch (...) {
+                    status = 1;
+                }
+                _exit(status);
+            }
+            report.workers.push_back({pid, begin, end, 0.0});
+        }
+
+        std::string failures;
+        for (unsigned w = 0; w < workers; ++w) {
+            WorkerReport& worker = report.workers[w];
+            int status = 0;
+            while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {}
+            uint64_t done = progress[w].done.load(std::memory_order_relaxed);
+            worker.seconds = static_cast<double>(progress[w].nanoseconds.load(std::memory_order_relaxed)) / 1e9;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || done != worker.end - worker.begin) {
+                failures += " worker " + std::to_string(w) + " finished " + std::to_string(done) + " of " +
+                            std::to_string(worker.end - worker.begin) + " values;";
+            }
+        }
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        munmap(shared, sharedBytes);
+        if (!failures.empty()) throw std::runtime_error("sharded transform failed:" + failures);
+        return report;
+    }
+};
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class StartupGraph
+ * @brief startup work registered from static objects, the way HW3-2's Printers do it, but run later on a pool of threads in dependency order
+ *
+ * A static StartupTask only adds itself to the graph, so the order the compiler runs static constructors in, which is unspecified
+ * across translation units, no longer matters. main() calls run() where it wants the work done; run() checks the graph, then
+ * starts every task as soon as the tasks it comes after have finished, on as many threads as asked for
+ *
+ * Whatever a task writes to the stream it is given reaches run()'s stream in one fixed order, whatever the threads do:
+ * every task after the tasks it comes after, and straight after the last of them where it can, with ties broken by name.
+ * The order depends only on the names and dependencies, never on which translation unit registered first. A task's output is held back
+ * until every task before it in that order has been written, so three tasks printing "Hello, ", "World!" and "\n", each after the one
+ * before, print the greeting just as the Printers do
+ */
+class StartupGraph {
+public:
+    using Body = std::function<void(std::ostream&)>;
+
+    /**
+     * @struct TaskTiming
+     * @brief when one task ran, in milliseconds from the start of run(), and on which of the pool's threads
+     */
+    struct TaskTiming {
+        std::string name;
+        double startMs = 0.0;
+        double endMs = 0.0;
+        unsigned thread = 0;
+    };
+
+    /**
+     * @struct Report
+     * @brief how long startup took, against the longest chain of dependent tasks, which no number of threads can beat
+     */
+    struct Report {
+        unsigned threads = 0;
+        double wallMs = 0.0;
+        double workMs = 0.0;      // every task's time added up, what one thread would need
+        double criticalMs = 0.0;  // the longest chain of tasks each waiting on the one before
+        std::vector<std::string> criticalPath;
+        std::vector<TaskTiming> tasks;  // in output order
+
+        void print(std::ostream& out) const {
+            out << "startup: " << tasks.size() << " tasks on " << threads << " thread(s) in " << wallMs << " ms, " << workMs << " ms of work, critical path "
+                << criticalMs << " ms\ncritical path:";
+            for (std::size_t i = 0; i < criticalPath.size(); ++i) out << (i ? " -> " : " ") << criticalPath[i];
+            out << "\n";
+        }
+    };
+
+private:
+    struct Task {
+        std::string name;
+        std::vector<std::string> after;
+        Body body;
+    };
+
+    std::vector<Task> tasks;
+
+    /**
+     * @brief the order output is written in: a depth-first topological order, ties broken by name
+     * @throws std::invalid_argument if a name is used twice, a dependency is unknown, or the dependencies go round in a circle
+     */
+    std::vector<std::size_t> outputOrder(std::vector<std::vector<std::size_t>>& dependents, std::vector<std::size_t>& waiting) const {
+        std::unordered_map<std::string, std::size_t> byName;
+        for (std::size_t i = 0; i < tasks.size(); ++i) {
+            if (!byName.emplace(tasks[i].name, i).second) throw std::invalid_argument("startup task " + tasks[i].name + " is registered twice");
+        }
+        dependents.assign(tasks.size(), {});
+        waiting.assign(tasks.size(), 0);
+        for (std::size_t i = 0; i < tasks.size(); ++i) {
+            for (const auto& name : tasks[i].after) {
+                auto found = byName.find(name);
+                if (found == byName.end()) throw std::invalid_argument("startup task " + tasks[i].name + " comes after unknown task " + name);
+                dependents[found->second].push_back(i);
+                ++waiting[i];
+            }
+        }
+        // a stack, so the tasks a finished task lets go of come straight after it; each batch is pushed in reverse name order
+        std::vector<std::size_t> ready;
+        std::vector<std::size_t> left = waiting;
+        auto push = [&](std::vector<std::size_t> batch) {
+            std::sort(batch.begin(), batch.end(), [this](std::size_t a, std::size_t b) { return tasks[a].name > tasks[b].name; });
+            ready.insert(ready.end(), batch.begin(), batch.end());
+        };
+        std::vector<std::size_t> roots;
+        for (std::size_t i = 0; i < tasks.size(); ++i) {
+            if (left[i] == 0) roots.push_back(i);
+        }
+        push(roots);
+        std::vector<std::size_t> order;
+        while (!ready.empty()) {
+            std::size_t next = ready.back();
+            ready.pop_back();
+            order.push_back(next);
+            std::vector<std::size_t> released;
+            for (std::size_t dependent : dependents[next]) {
+                if (--left[dependent] == 0) released.push_back(dependent);
+            }
+            push(released);
+        }
+        if (order.size() != tasks.size()) {
+            std::string circle;
+            for (std::size_t i = 0; i < tasks.size(); ++i) {
+                if (left[i]) circle += " " + tasks[i].name;
+            }
+            throw std::invalid_argument("startup tasks wait on each other in a circle:" + circle);
+        }
+        return order;
+    }
+
+public:
+    /**
+     * @brief the graph StartupTask objects register with; built on first use, so it is ready however early a static constructor runs
+     */
+    static StartupGraph& instance() {
+        static StartupGraph graph;
+        return graph;
+    }
+
+    /**
+     * @brief adds a task; nothing is checked until run(), since the tasks it comes after may not have registered yet
+     */
+    void add(std::string name, std::vector<std::string> after, Body body) { tasks.push_back({std::move(name), std::move(after), std::move(body)}); }
+
+    std::size_t size() const { return tasks.size(); }
+
+    /**
+     * @brief runs every task once, each after the ones it names, on a pool of the given number of threads, the calling thread included
+     * If a task throws, no further tasks are started, the ones already running are finished, and the first exception is rethrown
+     * @param out receives the tasks' output in output order
+     * @throws std::invalid_argument if the graph is not a valid set of dependencies, before any task runs
+     */
+    Report run(std::ostream& out, unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+        threads = std::max(threads, 1u);
+        std::vector<std::vector<std::size_t>> dependents;
+        std::vector<std::size_t> waiting;
+        std::vector<std::size_t> order = outputOrder(dependents, waiting);
+        std::vector<std::size_t> rank(tasks.size());
+        for (std::size_t i = 0; i < order.size(); ++i) rank[order[i]] = i;
+
+        // ready tasks start in output order, so output is held back as little as possible
+        auto later = [&](std::size_t a, std::size_t b) { return rank[a] > rank[b]; };
+        std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> ready(later);
+        for (std::size_t i = 0; i < tasks.size(); ++i) {
+            if (waiting[i] == 0) ready.push(i);
+        }
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::vector<std::string> output(tasks.size());
+        std::vector<bool> finished(tasks.size(), false);
+        std::vector<TaskTiming> timings(tasks.size());
+        std::size_t done = 0, written = 0;
+        std::exception_ptr failure;
+        auto begin = std::chrono::steady_clock::now();
+        auto since = [&begin] { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(); };
+
+        auto work = [&](unsigned thread) {
+            std::unique_lock<std::mutex> guard(lock);
+            while (true) {
+                wake.wait(guard, [&] { return failure || done == tasks.size() || !ready.empty(); });
+                if (failure || done == tasks.size()) return;
+                std::size_t task = ready.top();
+                ready.pop();
+                guard.unlock();
+
+                std::ostringstream text;
+                TaskTiming timing{tasks[task].name, since(), 0.0, thread};
+                std::exception_ptr thrown;
+                try {
+                    tasks[task].body(text);
+                } catch (...) {
+                    thrown = std::current_exception();
+                }
+                timing.endMs = since();
+
+                guard.lock();
+                timings[task] = timing;
+                if (thrown) {
+                    if (!failure) failure = thrown;
+                    wake.notify_all();
+                    return;
+                }
+                output[task] = text.str();
+                finished[task] = true;
+                ++done;
+                while (written < order.size() && finished[order[written]]) out << output[order[written++]];
+                for (std::size_t dependent : dependents[task]) {
+                    if (--waiting[dependent] == 0) ready.push(dependent);
+                }
+                wake.notify_all();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work, t);
+        work(0);
+        for (auto& thread : pool) thread.join();
+        out.flush();
+        if (failure) std::rethrow_exception(failure);
+
+        Report report;
+        report.threads = threads;
+        report.wallMs = since();
+        // the longest chain ending at each task, walked in output order so every dependency is settled first
+        std::vector<double> chain(tasks.size(), 0.0);
+        std::vector<std::size_t> previous(tasks.size(), tasks.size());
+        std::size_t last = tasks.size();
+        for (std::size_t task : order) {
+            double took = timings[task].endMs - timings[task].startMs;
+            report.workMs += took;
+            chain[task] += took;
+            for (std::size_t dependent : dependents[task]) {
+                if (chain[task] > chain[dependent]) {
+                    chain[dependent] = chain[task];
+                    previous[dependent] = task;
+                }
+            }
+            if (last == tasks.size() || chain[task] > chain[last]) last = task;
+            report.tasks.push_back(timings[task]);
+        }
+        if (last != tasks.size()) report.criticalMs = chain[last];
+        for (std::size_t task = last; task != tasks.size(); task = previous[task]) report.criticalPath.push_back(tasks[task].name);
+        std::reverse(report.criticalPath.begin(), report.criticalPath.end());
+        return report;
+    }
+};
+
+/**
+ * @class StartupTask
+ * @brief a static object that registers a piece of startup work with StartupGraph::instance(), in place of doing the work in its constructor
+ */
+class StartupTask {
+public:
+    /**
+     * @param name how other tasks refer to this one
+     * @param after the names of the tasks that must finish before this one starts
+     * @param body the work, given a stream for anything it prints
+     */
+    StartupTask(std::string name, std::vector<std::string> after, StartupGraph::Body body) {
+        StartupGraph::instance().add(std::move(name), std::move(after), std::move(body));
+    }
+};
@@ -0,0 +1,206 @@
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AnimalTree.h"
+#include "StartupGraph.h"
+
+// which tasks have finished in the current run, so every task can check the ones it comes after really did finish first
+// (filled in while the static tasks register, on one thread, and only read and set through the atomics afterwards)
+static std::map<std::string, std::atomic<bool>>& finishedTasks() {
+    static std::map<std::string, std::atomic<bool>> finished;
+    return finished;
+}
+static std::atomic<int> outOfOrder{0};
+
+/**
+ * @brief registers a startup task that checks its dependencies have finished before doing its work, and marks itself finished after
+ */
+static void addTask(const std::string& name, const std::vector<std::string>& after, StartupGraph::Body body) {
+    finishedTasks()[name];
+    StartupGraph::instance().add(name, after, [name, after, body = std::move(body)](std::ostream& out) {
+        for (const auto& dependency : after) outOfOrder += !finishedTasks().at(dependency).load();
+        body(out);
+        finishedTasks().at(name) = true;
+    });
+}
+
+/**
+ * @struct Registered
+ * @brief registers a task from a static object, exactly as StartupTask does, with the dependency check added
+ */
+struct Registered {
+    Registered(const std::string& name, const std::vector<std::string>& after, StartupGraph::Body body) { addTask(name, after, std::move(body)); }
+};
+
+// HW3-2's greeting, as tasks: each part is printed after the one before, whichever threads run them
+static Registered hello("hello", {}, [](std::ostream& out) { out << "Hello, "; });
+static Registered world("world", {"hello"}, [](std::ostream& out) { out << "World!"; });
+static Registered newline("newline", {"world"}, [](std::ostream& out) { out << "\n"; });
+
+// the tables, trees and caches a real program builds before main; each fills a global the tasks after it read
+static std::vector<double> sineTable;
+static std::vector<uint8_t> composite;
+static std::vector<uint64_t> powerTable;
+static std::unique_ptr<AnimalTree> questionTree;
+static std::string treeSnapshot;
+static std::vector<std::size_t> subtreeLeaves(16);
+static std::vector<uint64_t> cacheSums(8);
+
+static Registered sines("sine table", {}, [](std::ostream& out) {
+    sineTable.assign(1 << 21, 0.0);
+    for (std::size_t i = 0; i < sineTable.size(); ++i) sineTable[i] = std::sin(static_cast<double>(i) * 1e-5);
+    out << "sine table: " << sineTable.size() << " entries\n";
+});
+
+static Registered sieve("prime sieve", {}, [](std::ostream& out) {
+    composite.assign(20000000, 0);
+    std::size_t primes = 0;
+    for (std::size_t i = 2; i < composite.size(); ++i) {
+        if (composite[i]) continue;
+        ++primes;
+        for (std::size_t j = i * i; j < composite.size(); j += i) composite[j] = 1;
+    }
+    out << "primes below " << composite.size() << ": " << primes << "\n";
+});
+
+static Registered powers("power table", {"prime sieve"}, [](std::ostream& out) {
+    // the first 64 powers of the primes below 4096, wrapping at 2^64
+    powerTable.clear();
+    for (uint64_t p = 2; p < 4096; ++p) {
+        if (composite[p]) continue;
+        uint64_t value = 1;
+        for (int n = 0; n < 64; ++n) powerTable.push_back(value *= p);
+    }
+    out << "power table: " << powerTable.size() << " entries\n";
+});
+
+static Registered tree("question tree", {}, [](std::ostream& out) {
+    auto built = std::make_unique<AnimalTree>();
+    std::mt19937 rng(100);
+    for (int i = 0; i < 60000; ++i) {
+        Node* leaf = built->getRoot();
+        while (!leaf->isLeaf()) leaf = (rng() & 1) ? leaf->yes.get() : leaf->no.get();
+        built->learn(leaf, "Animal " + std::to_string(i), "Question " + std::to_string(i % 1024) + "?", rng() & 1);
+    }
+    questionTree = std::move(built);
+    out << "question tree: " << questionTree->stats().animals << " animals\n";
+});
+
+static Registered snapshot("tree snapshot", {"question tree"}, [](std::ostream& out) {
+    std::ostringstream saved;
+    questionTree->save(saved);
+    treeSnapshot = saved.str();
+    out << "tree snapshot: " << treeSnapshot.size() << " bytes\n";
+});
+
+// one index per subtree four answers below the root, all built at once from the finished tree
+static const bool subtreeIndexes = [] {
+    for (int route = 0; route < 16; ++route) {
+        addTask("subtree index " + std::to_string(route), {"question tree"}, [route](std::ostream&) {
+            const Node* at = questionTree->getRoot();
+            for (int bit = 3; bit >= 0 && !at->isLeaf(); --bit) at = (route >> bit) & 1 ? at->yes.get() : at->no.get();
+            std::vector<std::string> names;
+            questionTree->collectAnimals(at, names);
+            subtreeLeaves[route] = names.size();
+        });
+    }
+    return true;
+}();
+
+static const bool caches = [] {
+    for (int c = 0; c < 8; ++c) {
+        addTask("cache " + std::to_string(c), {c % 2 ? "sine table" : "power table"}, [c](std::ostream&) {
+            uint64_t sum = 0;
+            if (c % 2) {
+                for (std::size_t i = static_cast<std::size_t>(c); i < sineTable.size(); i += 8) sum += static_cast<uint64_t>(std::fabs(sineTable[i]) * 1e6);
+            } else {
+                for (int round = 0; round < 200; ++round) {
+                    for (std::size_t i = static_cast<std::size_t>(c); i < powerTable.size(); i += 8) sum += powerTable[i] >> (round % 16);
+                }
+            }
+            cacheSums[c] = sum;
+        });
+    }
+    return true;
+}();
+
+static Registered summary("summary", {"tree snapshot", "subtree index 0", "subtree index 1", "subtree index 2", "subtree index 3", "subtree index 4",
+                                      "subtree index 5", "subtree index 6", "subtree index 7", "subtree index 8", "subtree index 9", "subtree index 10",
+                                      "subtree index 11", "subtree index 12", "subtree index 13", "subtree index 14", "subtree index 15", "cache 0",
+                                      "cache 1", "cache 2", "cache 3", "cache 4", "cache 5", "cache 6", "cache 7"},
+                              [](std::ostream& out) {
+                                  std::size_t leaves = 0;
+                                  for (std::size_t count : subtreeLeaves) leaves += count;
+                                  uint64_t sums = 0;
+                                  for (uint64_t sum : cacheSums) sums ^= sum;
+                                  out << "indexed " << leaves << " animals in 16 subtrees, cache checksum " << sums << "\n";
+                              });
+
+/**
+ * @brief runs a graph built by hand and reports whether run() refused it or passed on a task's exception, as expected
+ */
+static int expectFailure(const std::string& label, StartupGraph& graph, bool& dependentRan) {
+    std::ostringstream out;
+    try {
+        graph.run(out, 2);
+    } catch (const std::exception& error) {
+        std::cout << label << ": " << error.what() << "\n";
+        return dependentRan ? 1 : 0;
+    }
+    std::cout << label << ": NOT refused\n";
+    return 1;
+}
+
+int main() {
+    int problems = 0;
+    // the defined point where startup work happens; the greeting and the other tasks' lines reach std::cout in their fixed order
+    StartupGraph::Report first = StartupGraph::instance().run(std::cout);
+    first.print(std::cout);
+    problems += outOfOrder.load();
+
+    std::string expected;
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts{1, 2, 4};
+    if (cores > 4) threadCounts.push_back(cores);
+    for (unsigned threads : threadCounts) {
+        for (auto& [name, finished] : finishedTasks()) finished = false;
+        std::ostringstream out;
+        StartupGraph::Report report = StartupGraph::instance().run(out, threads);
+        report.print(std::cout);
+        if (expected.empty()) expected = out.str();
+        problems += out.str() != expected || out.str().rfind("Hello, World!\n", 0) != 0;
+    }
+    problems += outOfOrder.load();
+    std::cout << StartupGraph::instance().size() << " tasks, " << outOfOrder.load() << " started before a task they come after finished\n";
+
+    // a graph that cannot run is refused before any task starts, and a task that throws stops the tasks after it
+    bool ran = false;
+    StartupGraph circle;
+    circle.add("a", {"b"}, [&](std::ostream&) { ran = true; });
+    circle.add("b", {"a"}, [&](std::ostream&) { ran = true; });
+    problems += expectFailure("circle", circle, ran);
+    StartupGraph unknown;
+    unknown.add("a", {"missing"}, [&](std::ostream&) { ran = true; });
+    problems += expectFailure("unknown dependency", unknown, ran);
+    StartupGraph twice;
+    twice.add("a", {}, [&](std::ostream&) { ran = true; });
+    twice.add("a", {}, [&](std::ostream&) { ran = true; });
+    problems += expectFailure("name used twice", twice, ran);
+    StartupGraph throwing;
+    throwing.add("fails", {}, [](std::ostream&) { throw std::runtime_error("could not build the table"); });
+    throwing.add("after", {"fails"}, [&](std::ostream&) { ran = true; });
+    problems += expectFailure("failing task", throwing, ran);
+
+    std::cout << (problems ? std::to_string(problems) + " problem(s) found" : std::string("every run printed the same output in dependency order")) << "\n";
+    return problems ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+// StoreMode::Auto writes buffers at least this large with non-temporal stores; 0 means use the size of the last level cache
+#ifndef NTH_POWER_STREAMING_THRESHOLD
+#define NTH_POWER_STREAMING_THRESHOLD 0
+#endif
+
+/**
+ * @class StreamingStore
+ * @brief writes results to memory without pulling the destination into the cache, for buffers too large to stay cached anyway
+ *
+ * An ordinary store first reads the destination line into the cache (read-for-ownership) and then evicts something useful to make room for it;
+ * a non-temporal store writes whole lines straight to memory, which saves that read and leaves the cache to the rest of the program
+ * The catch is that the data is no longer cached afterwards, so this only pays off for buffers larger than the last level cache
+ *
+ * Streaming is opt-in: Nth_Power::apply() only streams when asked for StoreMode::Streaming or StoreMode::Auto. On the single core it has been
+ * measured on, streaming was slower than ordinary stores at every size, 512 MiB included, so it is not the default until a measurement
+ * with several cores competing for memory bandwidth shows it winning. There is no software prefetch either: the input is read
+ * sequentially, which the hardware prefetcher already covers, and explicit prefetches only slowed the streaming loop down
+ */
+class StreamingStore {
+public:
+    // non-temporal stores move 16 bytes at a time and need the destination aligned to that
+    static constexpr std::size_t kAlignment = 16;
+
+    /**
+     * @brief the buffer size in bytes from which StoreMode::Auto uses streaming stores
+     */
+    static std::size_t threshold() {
+        static const std::size_t bytes = [] {
+            if (NTH_POWER_STREAMING_THRESHOLD > 0) return static_cast<std::size_t>(NTH_POWER_STREAMING_THRESHOLD);
+            long llc = -1;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+            llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+            if (llc <= 0) llc = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+            return llc > 0 ? static_cast<std::size_t>(llc) : std::size_t{8} << 20;
+        }();
+        return bytes;
+    }
+
+    /**
+     * @brief copies bytes from src to dst with non-temporal stores; dst must be aligned to kAlignment
+     * Call fence() once the whole buffer has been written, before other threads read it
+     */
+    static void copy(const void* src, void* dst, std::size_t bytes) {
+        std::size_t done = 0;
+#if defined(__SSE2__)
+        const auto* from = static_cast<const unsigned char*>(src);
+        auto* to = static_cast<unsigned char*>(dst);
+        for (; done + kAlignment <= bytes; done += kAlignment) {
+            _mm_stream_si128(reinterpret_cast<__m128i*>(to + done), _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + done)));
+        }
+#endif
+        std::memcpy(static_cast<unsigned char*>(dst) + done, static_cast<const unsigned char*>(src) + done, bytes - done);
+    }
+
+    /**
+     * @brief orders earlier non-temporal stores before any later store, so the results are visible to everyone who synchronizes afterwards
+     */
+    static void fence() {
+#if defined(__SSE2__)
+        _mm_sfence();
+#endif
+    }
+
+    /**
+     * @brief the number of bytes to write normally before dst reaches kAlignment
+     */
+    static std::size_t misalignment(const void* dst) {
+        auto address = reinterpret_cast<std::uintptr_t>(dst);
+        return (kAlignment - address % kAlignment) % kAlignment;
+    }
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class TimingWheel
+ * @brief timeouts for a very large number of ids, such as idle game sessions, where starting, resetting and cancelling a timer are all O(1)
+ *
+ * Time is counted in ticks. Level 0 of the wheel has one slot for each of the next kSlots ticks, and every level above has kSlots slots
+ * that are each as wide as the whole level below, so kLevels levels cover 2^32 ticks (about 50 days of millisecond ticks)
+ * A timer is a node in the linked list of one slot, so resetting it on every answer just moves it between two lists instead of rebalancing a heap
+ * When time reaches the start of an upper level slot, its timers are spread out over the levels below (cascading),
+ * and when a level 0 slot comes due all of its timers expire together
+ *
+ * Timers live in one array indexed by id and link to each other by index, so each costs 24 bytes and the wheel never allocates per timer
+ */
+class TimingWheel {
+public:
+    using Id = uint32_t;
+    static constexpr unsigned kSlotBits = 8;
+    static constexpr std::size_t kSlots = std::size_t{1} << kSlotBits;
+    static constexpr unsigned kLevels = 4;
+
+private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr uint64_t kSlotMask = kSlots - 1;
+    // timers due further away than the top level reaches wait in this list, which is looked at again each time the top level wraps around
+    static constexpr uint32_t kOverflow = kLevels * kSlots;
+    static constexpr uint32_t kUnscheduled = kOverflow + 1;
+
+    struct Entry {
+        uint64_t deadline = 0;
+        uint32_t prev = kNil;
+        uint32_t next = kNil;
+        uint32_t slot = kUnscheduled;
+    };
+
+    std::vector<Entry> entries;
+    std::array<uint32_t, kOverflow + 1> heads;
+    // one bit per slot that holds any timer, so advance() can jump over runs of empty ticks
+    std::array<uint64_t, kOverflow / 64 + 1> occupied{};
+    uint64_t current = 0;
+    std::size_t active = 0;
+
+    uint32_t slotFor(uint64_t deadline) const {
+        // the level is set by the highest bit where the deadline and the current tick differ, so every timer on level l shares
+        // the bits above level l with the current tick and comes due within the span of its slot
+        uint64_t differs = deadline ^ current;
+        unsigned level = differs == 0 ? 0 : (static_cast<unsigned>(std::bit_width(differs)) - 1) / kSlotBits;
+        if (level >= kLevels) return kOverflow;
+        return static_cast<uint32_t>(level * kSlots + ((deadline >> (level * kSlotBits)) & kSlotMask));
+    }
+
+    void link(Id id, uint32_t slot) {
+        Entry& entry = entries[id];
+        entry.slot = slot;
+        entry.prev = kNil;
+        entry.next = heads[slot];
+        if (entry.next != kNil) entries[entry.next].prev = id;
+        heads[slot] = id;
+        occupied[slot / 64] |= uint64_t{1} << (slot % 64);
+    }
+
+    void unlink(Id id) {
+        Entry& entry = entries[id];
+        if (entry.prev != kNil) entries[entry.prev].next = entry.next;
+        else heads[entry.slot] = entry.next;
+        if (entry.next != kNil) entries[entry.next].prev = entry.prev;
+        if (heads[entry.slot] == kNil) occupied[entry.slot / 64] &= ~(uint64_t{1} << (entry.slot % 64));
+        entry.slot = kUnscheduled;
+    }
+
+    // moves every timer of an upper level slot (or the overflow list) to where it belongs now that the current tick has moved on
+    void cascade(uint32_t slot) {
+        uint32_t id = heads[slot];
+        heads[slot] = kNil;
+        occupied[slot / 64] &= ~(uint64_t{1} << (slot % 64));
+        while (id != kNil) {
+            uint32_t next = entries[id].next;
+            link(id, slotFor(entries[id].deadline));
+            id = next;
+        }
+    }
+
+    // the next tick after the current one where anything can happen: a level 0 slot with timers in it, or the start of a new turn of level 0
+    uint64_t nextEvent(uint64_t limit) const {
+        uint64_t next = current + 1;
+        uint64_t boundary = (next | kSlotMask) + 1;
+        std::size_t index = next & kSlotMask;
+        if (index == 0) return next;
+        for (std::size_t word = index / 64; word < kSlots / 64; ++word) {
+            uint64_t bits = occupied[word];
+            if (word == index / 64) bits &= ~uint64_t{0} << (index % 64);
+            if (bits) {
+                boundary = (next & ~kSlotMask) + word * 64 + static_cast<uint64_t>(std::countr_zero(bits));
+                break;
+            }
+        }
+        return std::min(boundary, limit);
+    }
+
+public:
+    TimingWheel() { heads.fill(kNil); }
+
+    /**
+     * @brief makes room for ids below count without reallocating later
+     */
+    void reserve(std::size_t count) {
+        if (entries.size() < count) entries.resize(count);
+    }
+
+    /**
+     * @brief starts the timer of an id, or moves it if it is already running, to expire at the given tick
+     * Deadlines that are not in the future expire on the next tick
+     */
+    void schedule(Id id, uint64_t deadline) {
+        reserve(std::size_t{id} + 1);
+        if (entries[id].slot != kUnscheduled) unlink(id);
+        else ++active;
+        entries[id].deadline = std::max(deadline, current + 1);
+        link(id, slotFor(entries[id].deadline));
+    }
+
+    /**
+     * @brief starts or resets the timer of an id to expire the given number of ticks from now
+     */
+    void scheduleIn(Id id, uint64_t ticks) { schedule(id, current + std::max<uint64_t>(ticks, 1)); }
+
+    /**
+     * @brief stops the timer of an id
+     * @return false if it was not running
+     */
+    bool cancel(Id id) {
+        if (!scheduled(id)) return false;
+        unlink(id);
+        --active;
+        return true;
+    }
+
+    /**
+     * @brief the first tick after now() where advance() may have a timer to expire or to bring down a level, so a poll loop can sleep until then
+     * It is never later than the earliest deadline, and at most kSlots ticks away while any timer is running
+     * @return UINT64_MAX if no timer is running
+     */
+    uint64_t nextExpiry() const { return active == 0 ? UINT64_MAX : nextEvent(UINT64_MAX); }
+
+    bool scheduled(Id id) const { return id < entries.size() && entries[id].slot != kUnscheduled; }
+    uint64_t deadline(Id id) const { return entries[id].deadline; }
+    uint64_t now() const { return current; }
+    std::size_t size() const { return active; }
+
+    /**
+     * @brief moves time forward to the given tick, calling expire(id) for every timer that comes due on the way, earliest deadline first
+     * A timer is already stopped when expire is called, so expire may schedule it again or cancel other timers
+     * @return the number of timers that expired
+     */
+    template <typename Expire>
+    std::size_t advance(uint64_t now, Expire&& expire) {
+        std::size_t expired = 0;
+        while (current < now) {
+            current = nextEvent(now);
+            if ((current & kSlotMask) == 0) {
+                // a new turn of level 0, and maybe of levels above it: refill from the highest level that turned over first
+                if ((current & ((uint64_t{1} << (kLevels * kSlotBits)) - 1)) == 0) cascade(kOverflow);
+                for (unsigned level = kLevels - 1; level >= 1; --level) {
+                    if ((current & ((uint64_t{1} << (level * kSlotBits)) - 1)) == 0) {
+                        cascade(static_cast<uint32_t>(level * kSlots + ((current >> (level * kSlotBits)) & kSlotMask)));
+                    }
+                }
+            }
+            uint32_t slot = static_cast<uint32_t>(current & kSlotMask);
+            for (uint32_t id = heads[slot]; id != kNil; id = heads[slot]) {
+                unlink(id);
+                --active;
+                ++expired;
+                expire(id);
+            }
+        }
+        return expired;
+    }
+};
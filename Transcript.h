@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief how a game ended: the guess was right, the player's animal was added to the leaf or learned with a new question, or input ran out
+ */
+enum class GameOutcome : uint8_t { Guessed = 0, Remembered = 1, Learned = 2, Abandoned = 3 };
+
+/**
+ * @struct GameTranscript
+ * @brief one game as the transcript store records it
+ * The leaf is the route of answers that led to the guess, as a leading 1 bit followed by one bit per answer (1 for yes),
+ * which names the same leaf for as long as the tree keeps it, since learning only ever adds questions below a leaf
+ */
+struct GameTranscript {
+    int64_t startMicros = 0;  // since the Unix epoch
+    uint32_t durationMicros = 0;
+    uint32_t questions = 0;   // questions the player answered
+    uint32_t guesses = 0;     // animals the game guessed before it was right or gave up
+    GameOutcome outcome = GameOutcome::Abandoned;
+    uint64_t leaf = 1;
+};
+
+/**
+ * @class TranscriptFormat
+ * @brief the on-disk layout of a transcript file, shared by the writer and the query side
+ *
+ * A file is a sequence of row groups, each a fixed header followed by one block per column, so a query only reads the columns it uses
+ * and appending a session only ever adds groups at the end. Columns are compressed to suit what they hold:
+ * start times as zigzag varints of the difference from the previous row, durations, question counts and leaves as varints,
+ * guesses as one byte and outcomes as two bits. The header keeps each group's earliest and latest start, so a query can tell
+ * whether a whole group falls into one week without decoding its start column
+ */
+class TranscriptFormat {
+public:
+    enum Column { Start, Duration, Questions, Guesses, Outcome, Leaf, ColumnCount };
+    static constexpr unsigned kAllColumns = (1u << ColumnCount) - 1;
+
+    static constexpr uint32_t kMagic = 0x31475254;  // "TRG1"
+    static constexpr std::size_t kGroupRows = 65536;
+    // a leaf code holds the first 63 answers of a route, which is deeper than any tree the game grows
+    static constexpr std::size_t kMaxRoute = 63;
+
+    struct GroupHeader {
+        uint32_t magic = kMagic;
+        uint32_t rows = 0;
+        int64_t firstStart = 0;  // the start column counts from here
+        int64_t minStart = 0;
+        int64_t maxStart = 0;
+        uint32_t bytes[ColumnCount] = {};
+        uint32_t reserved = 0;
+    };
+    static_assert(sizeof(GroupHeader) % 8 == 0, "groups are kept 8-byte aligned");
+
+    /**
+     * @brief the leaf code of a route of y and n answers
+     */
+    static uint64_t leafCode(const std::string& route) {
+        uint64_t code = 1;
+        for (std::size_t i = 0; i < std::min(route.size(), kMaxRoute); ++i) code = code << 1 | (route[i] == 'y');
+        return code;
+    }
+    /**
+     * @brief the route of y and n answers a leaf code stands for
+     */
+    static std::string route(uint64_t code) {
+        std::string answers;
+        for (int bit = 62 - __builtin_clzll(code); bit >= 0; --bit) answers.push_back((code >> bit) & 1 ? 'y' : 'n');
+        return answers;
+    }
+
+    /**
+     * @brief the bytes a whole group takes, header and padding included
+     */
+    static std::size_t groupBytes(const GroupHeader& header) {
+        std::size_t total = sizeof(GroupHeader);
+        for (uint32_t bytes : header.bytes) total += bytes;
+        return total + (8 - total % 8) % 8;
+    }
+
+    static void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+    /**
+     * @brief decodes one varint, never reading at or past end
+     * @return false if the column ends in the middle of a value
+     */
+    static bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; in < end && shift < 64; shift += 7) {
+            uint8_t byte = *in++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+    static uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+    static int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+};
+
+/**
+ * @class TranscriptWriter
+ * @brief appends games to a transcript file, one row group at a time
+ * Rows are buffered until a group is full, or until flush() or the destructor writes what there is as a smaller group
+ * A torn group left at the end by a writer that died in the middle of a flush is cut off before anything is appended,
+ * since a group written after it would start where readers expect the torn group's columns
+ */
+class TranscriptWriter {
+    std::ofstream out;
+    std::string path;
+    std::vector<GameTranscript> pending;
+    std::vector<uint8_t> columns[TranscriptFormat::ColumnCount];
+
+    /**
+     * @brief cuts an existing file back to its whole groups
+     * @throws std::runtime_error if the file does not start with a transcript group, so it is never cut
+     */
+    static void dropTornGroup(const std::string& path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) return;
+        const std::size_t size = static_cast<std::size_t>(in.tellg());
+        std::size_t offset = 0;
+        TranscriptFormat::GroupHeader header;
+        while (size - offset >= sizeof(header)) {
+            in.seekg(static_cast<std::streamoff>(offset));
+            if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) throw std::runtime_error("cannot read transcript file " + path);
+            if (header.magic != TranscriptFormat::kMagic) {
+                if (offset == 0) throw std::runtime_error(path + " is not a transcript file");
+                break;
+            }
+            std::size_t total = TranscriptFormat::groupBytes(header);
+            if (total > size - offset) break;
+            offset += total;
+        }
+        in.close();
+        if (offset < size) std::filesystem::resize_file(path, offset);
+    }
+
+public:
+    /**
+     * @throws std::runtime_error if the file cannot be opened for appending, or exists and is not a transcript file
+     */
+    explicit TranscriptWriter(const std::string& path) : path(path) {
+        dropTornGroup(path);
+        out.open(path, std::ios::binary | std::ios::app);
+        if (!out) throw std::runtime_error("cannot open transcript file " + path);
+    }
+    ~TranscriptWriter() {
+        try {
+            flush();
+        } catch (const std::exception&) {
+            // a destructor cannot report the failure; callers that care call flush() themselves
+        }
+    }
+    TranscriptWriter(TranscriptWriter&&) = default;
+
+    void record(const GameTranscript& game) {
+        pending.push_back(game);
+        if (pending.size() == TranscriptFormat::kGroupRows) flush();
+    }
+
+    /**
+     * @brief writes the buffered games as one row group
+     * @throws std::runtime_error if the group cannot be written
+     */
+    void flush() {
+        if (pending.empty()) return;
+        using Format = TranscriptFormat;
+        for (auto& column : columns) column.clear();
+        Format::GroupHeader header;
+        header.rows = static_cast<uint32_t>(pending.size());
+        header.firstStart = header.minStart = header.maxStart = pending.front().startMicros;
+        int64_t previous = header.firstStart;
+        columns[Format::Outcome].assign((pending.size() + 3) / 4, 0);
+        for (std::size_t i = 0; i < pending.size(); ++i) {
+            const GameTranscript& game = pending[i];
+            header.minStart = std::min(header.minStart, game.startMicros);
+            header.maxStart = std::max(header.maxStart, game.startMicros);
+            Format::putVarint(columns[Format::Start], Format::zigzag(game.startMicros - previous));
+            previous = game.startMicros;
+            Format::putVarint(columns[Format::Duration], game.durationMicros);
+            Format::putVarint(columns[Format::Questions], game.questions);
+            columns[Format::Guesses].push_back(static_cast<uint8_t>(std::min<uint32_t>(game.guesses, 255)));
+            columns[Format::Outcome][i / 4] |= static_cast<uint8_t>(static_cast<uint8_t>(game.outcome) << (i % 4 * 2));
+            Format::putVarint(columns[Format::Leaf], game.leaf);
+        }
+        std::size_t total = sizeof(header);
+        for (int c = 0; c < Format::ColumnCount; ++c) {
+            header.bytes[c] = static_cast<uint32_t>(columns[c].size());
+            total += columns[c].size();
+        }
+        // padding keeps the next group's header 8-byte aligned in a mapped file
+        static const char padding[8] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& column : columns) out.write(reinterpret_cast<const char*>(column.data()), static_cast<std::streamsize>(column.size()));
+        out.write(padding, static_cast<std::streamsize>((8 - total % 8) % 8));
+        out.flush();
+        if (!out) throw std::runtime_error("cannot write transcript file " + path);
+        pending.clear();
+    }
+};
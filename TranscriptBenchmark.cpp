@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "PerfCounters.h"
+#include "TranscriptQuery.h"
+
+static constexpr std::size_t kGames = 20000000;
+static constexpr std::size_t kLeaves = 50000;
+static const char* kColumnPath = "TranscriptBenchmark.transcript";
+static const char* kRowPath = "TranscriptBenchmark.rows";
+
+/**
+ * @struct Expected
+ * @brief the answers to the queries, worked out row by row while the games were generated
+ */
+struct Expected {
+    TranscriptQuery::Summary summary;
+    std::map<int64_t, TranscriptQuery::Week> weeks;
+    std::unordered_map<uint64_t, TranscriptQuery::LeafMisses> leaves;
+};
+
+/**
+ * @brief generates a year of games, writing them to the transcript store and, for comparison, as raw structs one row after another
+ * Start times increase with random gaps, players think of a skewed set of leaves, and guesses miss less often as the year goes on
+ */
+static Expected generate() {
+    Expected expected;
+    std::mt19937_64 rng(97);
+    std::vector<std::string> routes(kLeaves);
+    for (auto& route : routes) {
+        std::size_t depth = 8 + rng() % 13;
+        for (std::size_t d = 0; d < depth; ++d) route.push_back(rng() & 1 ? 'y' : 'n');
+    }
+    std::vector<double> popularity(kLeaves);
+    double total = 0.0;
+    for (std::size_t i = 0; i < kLeaves; ++i) popularity[i] = total += 1.0 / static_cast<double>(i + 1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    const int64_t yearStart = 1767571200LL * 1000000LL;  // Monday 2026-01-05
+    const int64_t year = 364LL * 86400LL * 1000000LL;
+    const int64_t meanGap = year / static_cast<int64_t>(kGames);
+    int64_t now = yearStart;
+
+    TranscriptWriter writer(kColumnPath);
+    std::ofstream rows(kRowPath, std::ios::binary | std::ios::trunc);
+    for (std::size_t g = 0; g < kGames; ++g) {
+        GameTranscript game;
+        now += static_cast<int64_t>(unit(rng) * 2.0 * static_cast<double>(meanGap));
+        game.startMicros = now;
+        game.durationMicros = static_cast<uint32_t>(5e6 + 60e6 * unit(rng) * unit(rng));
+        const std::string& route = routes[std::lower_bound(popularity.begin(), popularity.end(), unit(rng) * total) - popularity.begin()];
+        double missRate = 0.3 - 0.25 * static_cast<double>(now - yearStart) / static_cast<double>(year);
+        double roll = unit(rng);
+        game.outcome = roll < 0.02 ? GameOutcome::Abandoned
+                     : roll < 0.02 + missRate * 0.3 ? GameOutcome::Remembered
+                     : roll < 0.02 + missRate ? GameOutcome::Learned
+                     : GameOutcome::Guessed;
+        game.questions = static_cast<uint32_t>(game.outcome == GameOutcome::Abandoned ? rng() % route.size() : route.size());
+        game.guesses = game.outcome == GameOutcome::Abandoned ? 0 : 1 + static_cast<uint32_t>(rng() % 3 == 0);
+        game.leaf = TranscriptFormat::leafCode(route);
+        writer.record(game);
+        rows.write(reinterpret_cast<const char*>(&game), sizeof(game));
+
+        auto& sum = expected.summary;
+        if (sum.games == 0) sum.firstStart = now;
+        sum.lastStart = now;
+        ++sum.games;
+        ++sum.outcomes[static_cast<int>(game.outcome)];
+        sum.questions += game.questions;
+        sum.guesses += game.guesses;
+        sum.durationMicros += game.durationMicros;
+        bool missed = game.outcome == GameOutcome::Remembered || game.outcome == GameOutcome::Learned;
+        auto& week = expected.weeks[TranscriptQuery::weekOf(now)];
+        week.week = TranscriptQuery::weekOf(now);
+        ++week.games;
+        week.questions += game.questions;
+        week.guesses += game.guesses;
+        week.missed += missed;
+        if (game.outcome != GameOutcome::Abandoned) {
+            auto& leaf = expected.leaves[game.leaf];
+            leaf.leaf = game.leaf;
+            ++leaf.games;
+            leaf.missed += missed;
+        }
+    }
+    writer.flush();
+    if (!rows) throw std::runtime_error(std::string("cannot write ") + kRowPath);
+    return expected;
+}
+
+/**
+ * @brief times one query and reports its scan rate
+ */
+template <typename Query>
+static void runCase(const std::string& label, std::size_t rows, Query query) {
+    PerfCounters counters;
+    auto start = std::chrono::steady_clock::now();
+    counters.start();
+    query();
+    counters.stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << label << ": " << seconds * 1e3 << " ms, " << static_cast<double>(rows) / seconds / 1e6 << " M rows/s\n  ";
+    counters.print(std::cout);
+}
+
+int main() {
+    int problems = 0;
+    try {
+        std::remove(kColumnPath);
+        auto start = std::chrono::steady_clock::now();
+        Expected expected = generate();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        TranscriptFile file = TranscriptFile::open(kColumnPath);
+        MappedFile rowFile = MappedFile::open(kRowPath, false);
+        std::cout << kGames << " games generated and written in " << seconds << " s\n"
+                  << "columnar store: " << file.bytes() << " bytes, " << static_cast<double>(file.bytes()) / kGames << " bytes per game in "
+                  << file.groupCount() << " row groups\n"
+                  << "raw rows:       " << rowFile.size() << " bytes, " << sizeof(GameTranscript) << " bytes per game\n";
+        problems += file.rows() != kGames || file.torn() != 0;
+
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<unsigned> threadCounts{1, 2, 4};
+        if (cores > 4) threadCounts.push_back(cores);
+
+        // the same weekly question asked of the raw rows, one struct at a time, as a program without the store would
+        std::vector<TranscriptQuery::Week> rowWeeks;
+        runCase("weekly over raw rows, 1 thread", kGames, [&] {
+            std::map<int64_t, TranscriptQuery::Week> weeks;
+            const GameTranscript* games = rowFile.as<const GameTranscript>();
+            for (std::size_t i = 0; i < kGames; ++i) {
+                auto& week = weeks[TranscriptQuery::weekOf(games[i].startMicros)];
+                ++week.games;
+                week.questions += games[i].questions;
+                week.guesses += games[i].guesses;
+                week.missed += games[i].outcome == GameOutcome::Remembered || games[i].outcome == GameOutcome::Learned;
+            }
+            rowWeeks.clear();
+            for (auto& [key, week] : weeks) {
+                week.week = key;
+                rowWeeks.push_back(week);
+            }
+        });
+        problems += rowWeeks.size() != expected.weeks.size();
+
+        for (unsigned threads : threadCounts) {
+            std::string suffix = ", " + std::to_string(threads) + " thread(s)";
+            TranscriptQuery::Summary sum;
+            runCase("summary" + suffix, kGames, [&] { sum = TranscriptQuery::summary(file, threads); });
+            const auto& want = expected.summary;
+            problems += sum.games != want.games || sum.questions != want.questions || sum.guesses != want.guesses ||
+                        sum.durationMicros != want.durationMicros || sum.firstStart != want.firstStart || sum.lastStart != want.lastStart;
+            for (int o = 0; o < 4; ++o) problems += sum.outcomes[o] != want.outcomes[o];
+
+            std::vector<TranscriptQuery::Week> weeks;
+            runCase("weekly" + suffix, kGames, [&] { weeks = TranscriptQuery::weekly(file, threads); });
+            problems += weeks.size() != expected.weeks.size();
+            for (const auto& week : weeks) {
+                auto found = expected.weeks.find(week.week);
+                problems += found == expected.weeks.end() || found->second.games != week.games || found->second.questions != week.questions ||
+                            found->second.guesses != week.guesses || found->second.missed != week.missed;
+            }
+
+            std::vector<TranscriptQuery::LeafMisses> leaves;
+            runCase("most missed leaves" + suffix, kGames, [&] { leaves = TranscriptQuery::mostMissed(file, threads, 10); });
+            problems += leaves.size() != 10;
+            uint64_t previous = UINT64_MAX;
+            for (const auto& leaf : leaves) {
+                auto found = expected.leaves.find(leaf.leaf);
+                problems += found == expected.leaves.end() || found->second.games != leaf.games || found->second.missed != leaf.missed ||
+                            leaf.missed > previous;
+                previous = leaf.missed;
+            }
+            // nothing left out of the top ten missed more often than the last one in it
+            for (const auto& [code, entry] : expected.leaves) {
+                bool listed = std::any_of(leaves.begin(), leaves.end(), [code = code](const auto& leaf) { return leaf.leaf == code; });
+                problems += !listed && entry.missed > previous;
+            }
+        }
+
+        // a writer that died in the middle of a flush leaves a torn group, long or shorter than a header; the next session cuts it off
+        // before appending, so its group is read and nothing is reported torn
+        for (std::size_t cut : {std::size_t{40}, std::size_t{5}}) {
+            const char* tornPath = "TranscriptBenchmark.torn";
+            std::remove(tornPath);
+            auto session = [&](uint32_t rows) {
+                TranscriptWriter writer(tornPath);
+                for (uint32_t r = 0; r < rows; ++r) {
+                    GameTranscript game;
+                    game.startMicros = 1767571200LL * 1000000LL + r;
+                    game.questions = r % 20;
+                    game.outcome = GameOutcome::Guessed;
+                    writer.record(game);
+                }
+            };
+            session(100);
+            std::size_t whole = TranscriptFile::open(tornPath).bytes();
+            session(100);
+            std::filesystem::resize_file(tornPath, cut == 5 ? whole + cut : TranscriptFile::open(tornPath).bytes() - cut);
+            session(100);
+            TranscriptFile healed = TranscriptFile::open(tornPath);
+            std::cout << "after a torn group of " << (cut == 5 ? "5 bytes" : "a group missing its last 40 bytes") << ": " << healed.rows() << " rows in "
+                      << healed.groupCount() << " groups, " << healed.torn() << " bytes torn\n";
+            problems += healed.rows() != 200 || healed.groupCount() != 2 || healed.torn() != 0;
+            std::remove(tornPath);
+        }
+
+        // a route survives the leaf code and back
+        problems += TranscriptFormat::route(TranscriptFormat::leafCode("yynny")) != "yynny" || TranscriptFormat::route(1) != "";
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        ++problems;
+    }
+    std::remove(kColumnPath);
+    std::remove(kRowPath);
+    std::cout << (problems ? std::to_string(problems) + " problem(s) found" : std::string("every query matched the games generated")) << "\n";
+    return problems ? EXIT_FAILURE : EXIT_SUCCESS;
+}
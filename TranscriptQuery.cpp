@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "TranscriptQuery.h"
+
+/**
+ * @brief the settings of one query, filled in from the command line
+ */
+struct Options {
+    std::string file;
+    std::string query;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t limit = 20;
+};
+
+static void usage() {
+    std::cerr << "usage: TranscriptQuery [--threads K] [--limit N] FILE summary|weekly|missed\n"
+                 "Runs a query over a transcript file written by AnimalGame on K threads (every core by default).\n"
+                 "summary: totals for every game; weekly: questions and guesses per game, and how many guesses missed, by week;\n"
+                 "missed: the N leaves whose guesses were wrong most often.\n";
+}
+
+static bool parse(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--threads" && hasValue) options.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--limit" && hasValue) options.limit = std::stoul(argv[++i]);
+        else if (!arg.empty() && arg[0] == '-') return false;
+        else if (options.file.empty()) options.file = arg;
+        else if (options.query.empty()) options.query = arg;
+        else return false;
+    }
+    return !options.file.empty() && (options.query == "summary" || options.query == "weekly" || options.query == "missed");
+}
+
+// a day counted from the Unix epoch, as YYYY-MM-DD
+static std::string dateOf(int64_t day) {
+    std::chrono::year_month_day date{std::chrono::sys_days{std::chrono::days{day}}};
+    char text[16];
+    std::snprintf(text, sizeof(text), "%04d-%02u-%02u", static_cast<int>(date.year()), static_cast<unsigned>(date.month()),
+                  static_cast<unsigned>(date.day()));
+    return text;
+}
+
+static double perGame(uint64_t total, uint64_t games) { return games ? static_cast<double>(total) / static_cast<double>(games) : 0.0; }
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parse(argc, argv, options)) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        TranscriptFile file = TranscriptFile::open(options.file);
+        if (file.torn()) std::cerr << "ignoring " << file.torn() << " bytes of an unfinished row group at the end of " << options.file << "\n";
+        auto start = std::chrono::steady_clock::now();
+
+        if (options.query == "summary") {
+            auto sum = TranscriptQuery::summary(file, options.threads);
+            std::cout << sum.games << " games";
+            if (sum.games) {
+                std::cout << " from " << dateOf(sum.firstStart / 86400000000LL) << " to " << dateOf(sum.lastStart / 86400000000LL) << "\n"
+                          << perGame(sum.questions, sum.games) << " questions and " << perGame(sum.guesses, sum.games) << " guesses per game, "
+                          << perGame(sum.durationMicros, sum.games) / 1e6 << " s per game\n"
+                          << "guessed " << sum.outcomes[0] << ", added to a leaf " << sum.outcomes[1] << ", learned with a question "
+                          << sum.outcomes[2] << ", abandoned " << sum.outcomes[3];
+            }
+            std::cout << "\n";
+        } else if (options.query == "weekly") {
+            std::cout << "week of       games   questions/game  guesses/game  missed\n";
+            for (const auto& week : TranscriptQuery::weekly(file, options.threads)) {
+                std::printf("%s  %9llu  %14.3f  %12.3f  %5.2f%%\n", dateOf(TranscriptQuery::firstDayOf(week.week)).c_str(),
+                            static_cast<unsigned long long>(week.games), perGame(week.questions, week.games), perGame(week.guesses, week.games),
+                            100.0 * perGame(week.missed, week.games));
+            }
+        } else {
+            std::cout << "   missed    games  leaf (answers from the first question)\n";
+            for (const auto& leaf : TranscriptQuery::mostMissed(file, options.threads, options.limit)) {
+                std::printf("%9llu %8llu  %s\n", static_cast<unsigned long long>(leaf.missed), static_cast<unsigned long long>(leaf.games),
+                            TranscriptFormat::route(leaf.leaf).c_str());
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << file.rows() << " rows in " << file.groupCount() << " groups (" << file.bytes() << " bytes) scanned in " << seconds << " s\n";
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
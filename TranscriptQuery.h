@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "MappedFile.h"
+#include "Transcript.h"
+
+/**
+ * @class TranscriptFile
+ * @brief a transcript file mapped read-only, split into its row groups, with column decoding and a parallel scan over the groups
+ * A torn group at the end (a writer that died in the middle of a flush) is left out rather than treated as an error;
+ * the next TranscriptWriter to open the file cuts it off before appending
+ */
+class TranscriptFile {
+public:
+    using Format = TranscriptFormat;
+
+    /**
+     * @struct Batch
+     * @brief the decoded columns of one row group; only the columns a scan asked for are filled in, and a visitor can decode() more of the same group
+     */
+    struct Batch {
+        std::size_t group = 0;
+        std::size_t rows = 0;
+        int64_t minStart = 0, maxStart = 0;
+        std::vector<int64_t> start;
+        std::vector<uint32_t> duration;
+        std::vector<uint32_t> questions;
+        std::vector<uint8_t> guesses;
+        std::vector<uint8_t> outcome;
+        std::vector<uint64_t> leaf;
+    };
+
+private:
+    struct Group {
+        const Format::GroupHeader* header;
+        const uint8_t* column[Format::ColumnCount];
+    };
+
+    MappedFile file;
+    std::vector<Group> groups;
+    std::size_t rowCount = 0;
+    std::size_t tornBytes = 0;
+
+    explicit TranscriptFile(MappedFile mapped) : file(std::move(mapped)) {
+        const uint8_t* data = file.as<const uint8_t>();
+        std::size_t offset = 0;
+        while (file.size() - offset >= sizeof(Format::GroupHeader)) {
+            const auto* header = reinterpret_cast<const Format::GroupHeader*>(data + offset);
+            if (header->magic != Format::kMagic) throw std::runtime_error("not a transcript file, or corrupt at byte " + std::to_string(offset));
+            std::size_t total = Format::groupBytes(*header);
+            if (total > file.size() - offset) break;
+            Group group{header, {}};
+            const uint8_t* column = data + offset + sizeof(Format::GroupHeader);
+            for (int c = 0; c < Format::ColumnCount; ++c) {
+                group.column[c] = column;
+                column += header->bytes[c];
+            }
+            groups.push_back(group);
+            rowCount += header->rows;
+            offset += total;
+        }
+        tornBytes = file.size() - offset;
+    }
+
+    template <typename T>
+    static void decodeVarints(const uint8_t* in, const uint8_t* end, std::size_t rows, std::vector<T>& out) {
+        out.resize(rows);
+        // while a whole varint (at most 10 bytes) is sure to fit before the end, values are read without checking the bounds, and one-byte values,
+        // most of every column, take a single branch
+        const uint8_t* unchecked = end - std::min<std::ptrdiff_t>(end - in, 10);
+        std::size_t i = 0;
+        for (; i < rows && in < unchecked; ++i) {
+            uint64_t value = *in++;
+            if (value >= 0x80) {
+                value &= 0x7f;
+                for (int shift = 7;; shift += 7) {
+                    uint64_t byte = *in++;
+                    value |= (byte & 0x7f) << shift;
+                    if (byte < 0x80) break;
+                    if (shift >= 63) throw std::runtime_error("transcript column holds an overlong value");
+                }
+            }
+            out[i] = static_cast<T>(value);
+        }
+        uint64_t value = 0;
+        for (; i < rows; ++i) {
+            if (!Format::getVarint(in, end, value)) throw std::runtime_error("transcript column ends early");
+            out[i] = static_cast<T>(value);
+        }
+    }
+
+public:
+    /**
+     * @throws std::runtime_error if the file cannot be mapped or does not hold transcript groups
+     */
+    static TranscriptFile open(const std::string& path) { return TranscriptFile(MappedFile::open(path, false)); }
+
+    std::size_t groupCount() const { return groups.size(); }
+    std::size_t rows() const { return rowCount; }
+    std::size_t bytes() const { return file.size(); }
+    /**
+     * @brief the bytes at the end of the file that do not make up a whole group
+     */
+    std::size_t torn() const { return tornBytes; }
+
+    /**
+     * @brief decodes the columns in the mask (bits indexed by TranscriptFormat::Column) of one row group
+     * @throws std::runtime_error if a column is corrupt
+     */
+    void decode(std::size_t index, unsigned columns, Batch& batch) const {
+        const Group& group = groups[index];
+        const Format::GroupHeader& header = *group.header;
+        batch.group = index;
+        batch.rows = header.rows;
+        batch.minStart = header.minStart;
+        batch.maxStart = header.maxStart;
+        auto end = [&](int c) { return group.column[c] + header.bytes[c]; };
+        if (columns & (1u << Format::Start)) {
+            decodeVarints(group.column[Format::Start], end(Format::Start), batch.rows, batch.start);
+            // the column holds differences; a running sum turns them back into times
+            int64_t previous = header.firstStart;
+            for (int64_t& start : batch.start) start = previous += Format::unzigzag(static_cast<uint64_t>(start));
+        }
+        if (columns & (1u << Format::Duration)) decodeVarints(group.column[Format::Duration], end(Format::Duration), batch.rows, batch.duration);
+        if (columns & (1u << Format::Questions)) decodeVarints(group.column[Format::Questions], end(Format::Questions), batch.rows, batch.questions);
+        if (columns & (1u << Format::Guesses)) {
+            if (header.bytes[Format::Guesses] != batch.rows) throw std::runtime_error("transcript guesses column has the wrong length");
+            batch.guesses.assign(group.column[Format::Guesses], end(Format::Guesses));
+        }
+        if (columns & (1u << Format::Outcome)) {
+            if (header.bytes[Format::Outcome] != (batch.rows + 3) / 4) throw std::runtime_error("transcript outcome column has the wrong length");
+            batch.outcome.resize(batch.rows);
+            const uint8_t* packed = group.column[Format::Outcome];
+            for (std::size_t i = 0; i < batch.rows; ++i) batch.outcome[i] = (packed[i / 4] >> (i % 4 * 2)) & 3;
+        }
+        if (columns & (1u << Format::Leaf)) decodeVarints(group.column[Format::Leaf], end(Format::Leaf), batch.rows, batch.leaf);
+    }
+
+    /**
+     * @brief runs visit(partial, batch) over every row group on up to threads threads, one partial result per thread
+     * Threads take groups one at a time from a shared counter, so a thread that finishes early picks up more groups
+     * @return the partial results, for the caller to merge
+     */
+    template <typename Partial, typename Visit>
+    std::vector<Partial> scan(unsigned threads, unsigned columns, Visit visit) const {
+        threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(std::max<std::size_t>(groups.size(), 1))));
+        std::vector<Partial> partials(threads);
+        std::atomic<std::size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::string failure;
+        auto work = [&](unsigned t) {
+            Batch batch;
+            try {
+                for (std::size_t g = next++; g < groups.size() && !failed; g = next++) {
+                    decode(g, columns, batch);
+                    visit(partials[t], batch);
+                }
+            } catch (const std::exception& error) {
+                if (!failed.exchange(true)) failure = error.what();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads; ++t) workers.emplace_back(work, t);
+        work(0);
+        for (auto& worker : workers) worker.join();
+        if (failed) throw std::runtime_error(failure);
+        return partials;
+    }
+};
+
+/**
+ * @class TranscriptQuery
+ * @brief the aggregations the query tool runs over a transcript file
+ * Each one decodes only the columns it needs and works on whole decoded columns at a time, in loops simple enough for the compiler to vectorize
+ */
+class TranscriptQuery {
+    using Format = TranscriptFormat;
+
+    static constexpr int64_t kMicrosPerDay = 86400LL * 1000000LL;
+
+    static bool missed(uint8_t outcome) {
+        return outcome == static_cast<uint8_t>(GameOutcome::Remembered) || outcome == static_cast<uint8_t>(GameOutcome::Learned);
+    }
+
+public:
+    /**
+     * @brief the week a time falls in, counted in Monday-to-Sunday weeks from the one holding the Unix epoch (a Thursday)
+     */
+    static int64_t weekOf(int64_t micros) {
+        int64_t day = micros / kMicrosPerDay - (micros % kMicrosPerDay < 0);
+        int64_t shifted = day + 3;
+        return shifted / 7 - (shifted % 7 < 0);
+    }
+    /**
+     * @brief the first day (Monday) of a week from weekOf(), in days since the Unix epoch
+     */
+    static int64_t firstDayOf(int64_t week) { return week * 7 - 3; }
+
+    struct Summary {
+        std::size_t games = 0;
+        std::size_t outcomes[4] = {};
+        uint64_t questions = 0, guesses = 0, durationMicros = 0;
+        int64_t firstStart = 0, lastStart = 0;
+    };
+
+    struct Week {
+        int64_t week = 0;
+        uint64_t games = 0, questions = 0, guesses = 0, missed = 0;
+    };
+
+    struct LeafMisses {
+        uint64_t leaf = 1;
+        uint64_t games = 0, missed = 0;
+    };
+
+    static Summary summary(const TranscriptFile& file, unsigned threads) {
+        constexpr unsigned columns = 1u << Format::Duration | 1u << Format::Questions | 1u << Format::Guesses | 1u << Format::Outcome;
+        auto partials = file.scan<Summary>(threads, columns, [](Summary& sum, const TranscriptFile::Batch& batch) {
+            if (sum.games == 0 || batch.minStart < sum.firstStart) sum.firstStart = batch.minStart;
+            if (sum.games == 0 || batch.maxStart > sum.lastStart) sum.lastStart = batch.maxStart;
+            sum.games += batch.rows;
+            uint64_t questions = 0, guesses = 0, duration = 0;
+            std::size_t outcomes[4] = {};
+            for (std::size_t i = 0; i < batch.rows; ++i) {
+                questions += batch.questions[i];
+                guesses += batch.guesses[i];
+                duration += batch.duration[i];
+            }
+            for (int o = 0; o < 4; ++o) {
+                std::size_t count = 0;
+                for (std::size_t i = 0; i < batch.rows; ++i) count += batch.outcome[i] == o;
+                outcomes[o] = count;
+            }
+            sum.questions += questions;
+            sum.guesses += guesses;
+            sum.durationMicros += duration;
+            for (int o = 0; o < 4; ++o) sum.outcomes[o] += outcomes[o];
+        });
+        Summary total;
+        for (const Summary& part : partials) {
+            if (part.games == 0) continue;
+            if (total.games == 0 || part.firstStart < total.firstStart) total.firstStart = part.firstStart;
+            if (total.games == 0 || part.lastStart > total.lastStart) total.lastStart = part.lastStart;
+            total.games += part.games;
+            total.questions += part.questions;
+            total.guesses += part.guesses;
+            total.durationMicros += part.durationMicros;
+            for (int o = 0; o < 4; ++o) total.outcomes[o] += part.outcomes[o];
+        }
+        return total;
+    }
+
+    /**
+     * @brief games, questions, guesses and missed guesses per week, in week order
+     * A group whose earliest and latest games fall in the same week, which is nearly all of them, is summed without decoding its start column
+     */
+    static std::vector<Week> weekly(const TranscriptFile& file, unsigned threads) {
+        using Weeks = std::unordered_map<int64_t, Week>;
+        constexpr unsigned columns = 1u << Format::Questions | 1u << Format::Guesses | 1u << Format::Outcome;
+        auto partials = file.scan<Weeks>(threads, columns, [&file](Weeks& weeks, TranscriptFile::Batch& batch) {
+            int64_t first = weekOf(batch.minStart), last = weekOf(batch.maxStart);
+            if (first != last) file.decode(batch.group, 1u << Format::Start, batch);
+            std::vector<Week> local(static_cast<std::size_t>(last - first + 1));
+            if (first == last) {
+                Week& week = local[0];
+                uint64_t questions = 0, guesses = 0, miss = 0;
+                for (std::size_t i = 0; i < batch.rows; ++i) {
+                    questions += batch.questions[i];
+                    guesses += batch.guesses[i];
+                    miss += missed(batch.outcome[i]);
+                }
+                week.games = batch.rows;
+                week.questions = questions;
+                week.guesses = guesses;
+                week.missed = miss;
+            } else {
+                for (std::size_t i = 0; i < batch.rows; ++i) {
+                    Week& week = local[static_cast<std::size_t>(weekOf(batch.start[i]) - first)];
+                    ++week.games;
+                    week.questions += batch.questions[i];
+                    week.guesses += batch.guesses[i];
+                    week.missed += missed(batch.outcome[i]);
+                }
+            }
+            for (std::size_t w = 0; w < local.size(); ++w) {
+                if (local[w].games == 0) continue;
+                Week& total = weeks[first + static_cast<int64_t>(w)];
+                total.week = first + static_cast<int64_t>(w);
+                total.games += local[w].games;
+                total.questions += local[w].questions;
+                total.guesses += local[w].guesses;
+                total.missed += local[w].missed;
+            }
+        });
+        Weeks merged;
+        for (const Weeks& part : partials) {
+            for (const auto& [key, week] : part) {
+                Week& total = merged[key];
+                total.week = key;
+                total.games += week.games;
+                total.questions += week.questions;
+                total.guesses += week.guesses;
+                total.missed += week.missed;
+            }
+        }
+        std::vector<Week> result;
+        for (const auto& entry : merged) result.push_back(entry.second);
+        std::sort(result.begin(), result.end(), [](const Week& a, const Week& b) { return a.week < b.week; });
+        return result;
+    }
+
+    /**
+     * @brief the leaves whose guesses were wrong most often, most misses first, with how many games reached each
+     * Abandoned games are not counted, since they never reached a guess
+     */
+    static std::vector<LeafMisses> mostMissed(const TranscriptFile& file, unsigned threads, std::size_t limit) {
+        using Leaves = std::unordered_map<uint64_t, LeafMisses>;
+        constexpr unsigned columns = 1u << Format::Outcome | 1u << Format::Leaf;
+        auto partials = file.scan<Leaves>(threads, columns, [](Leaves& leaves, const TranscriptFile::Batch& batch) {
+            for (std::size_t i = 0; i < batch.rows; ++i) {
+                if (batch.outcome[i] == static_cast<uint8_t>(GameOutcome::Abandoned)) continue;
+                LeafMisses& entry = leaves[batch.leaf[i]];
+                ++entry.games;
+                entry.missed += missed(batch.outcome[i]);
+            }
+        });
+        Leaves merged = std::move(partials[0]);
+        for (std::size_t p = 1; p < partials.size(); ++p) {
+            for (const auto& [leaf, entry] : partials[p]) {
+                LeafMisses& total = merged[leaf];
+                total.games += entry.games;
+                total.missed += entry.missed;
+            }
+        }
+        std::vector<LeafMisses> result;
+        result.reserve(merged.size());
+        for (auto& [leaf, entry] : merged) {
+            entry.leaf = leaf;
+            result.push_back(entry);
+        }
+        limit = std::min(limit, result.size());
+        std::partial_sort(result.begin(), result.begin() + static_cast<std::ptrdiff_t>(limit), result.end(), [](const LeafMisses& a, const LeafMisses& b) {
+            return a.missed != b.missed ? a.missed > b.missed : a.leaf < b.leaf;
+        });
+        result.resize(limit);
+        return result;
+    }
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "AnimalTree.h"
+#include "MappedFile.h"
+
+/**
+ * @class TreeImage
+ * @brief a read-only question tree laid out in one block of memory without pointers, so a process can map it and play from it as it is
+ *
+ * An AnimalTree has to be rebuilt node by node when it is loaded, which for a large tree takes far longer than anything else a new process does.
+ * An image means the same thing at any address, so a process handed one only maps it, and every process mapping the same file shares its pages
+ *
+ * Opening an image maps it and checks the header, nothing more, so an image of any size opens in the same time;
+ * child indices and text offsets are checked as they are followed instead, so a damaged image cannot lead a walk outside the block
+ *
+ * Layout: a Header, then one Entry per node, the root first, each naming its yes and no children by index (kNone for both at a leaf)
+ * and its text by offset and length; then the text of every question and animal name back to back. A question asked at many nodes is stored once
+ */
+class TreeImage {
+public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Header {
+        char magic[8] = {'A', 'N', 'I', 'T', 'R', 'E', 'E', '1'};
+        uint64_t nodes = 0;
+        uint64_t textOffset = 0;
+        uint64_t textBytes = 0;
+    };
+
+    struct Entry {
+        uint32_t yes;
+        uint32_t no;
+        uint32_t text;
+        uint32_t length;
+    };
+
+private:
+    MappedFile mapping;
+    const Entry* entries = nullptr;
+    const char* texts = nullptr;
+    uint64_t nodes = 0;
+    uint64_t textBytes = 0;
+
+    static std::runtime_error damaged() { return std::runtime_error("the tree image is damaged"); }
+
+public:
+    // holds no tree until an opened image is moved into it
+    TreeImage() = default;
+
+    /**
+     * @brief lays a tree out as an image, ready to be written to a file and opened
+     * @throws std::length_error if the tree has too many nodes or too much text for 32-bit indices and offsets
+     */
+    static std::string build(const AnimalTree& tree) {
+        std::vector<Entry> built;
+        std::string text;
+        std::vector<uint32_t> questionText(tree.questions().questionCount(), kNone);
+        auto place = [&text](const std::string& piece) {
+            if (text.size() + piece.size() >= kNone) throw std::length_error("too much text for a tree image");
+            text += piece;
+            return static_cast<uint32_t>(text.size() - piece.size());
+        };
+
+        // each node waits with the index of its parent and which of the parent's children it is, so the parent can be pointed at it
+        struct Visit { const Node* node; uint32_t parent; bool yes; };
+        std::vector<Visit> pending{{tree.getRoot(), kNone, false}};
+        while (!pending.empty()) {
+            Visit visit = pending.back();
+            pending.pop_back();
+            if (built.size() >= kNone) throw std::length_error("too many nodes for a tree image");
+            auto index = static_cast<uint32_t>(built.size());
+            if (visit.parent != kNone) (visit.yes ? built[visit.parent].yes : built[visit.parent].no) = index;
+            if (visit.node->isLeaf()) {
+                std::string name = visit.node->animal->getName();
+                built.push_back({kNone, kNone, place(name), static_cast<uint32_t>(name.size())});
+            } else {
+                const std::string& question = tree.questionText(visit.node);
+                uint32_t& offset = questionText[visit.node->question];
+                if (offset == kNone) offset = place(question);
+                built.push_back({kNone, kNone, offset, static_cast<uint32_t>(question.size())});
+                pending.push_back({visit.node->no.get(), index, false});
+                pending.push_back({visit.node->yes.get(), index, true});
+            }
+        }
+
+        Header header;
+        header.nodes = built.size();
+        header.textOffset = sizeof(Header) + built.size() * sizeof(Entry);
+        header.textBytes = text.size();
+        std::string image(reinterpret_cast<const char*>(&header), sizeof(header));
+        image.append(reinterpret_cast<const char*>(built.data()), built.size() * sizeof(Entry));
+        image += text;
+        return image;
+    }
+
+    /**
+     * @brief plays from an image already mapped into memory, which the TreeImage keeps for as long as it lives
+     * @throws std::runtime_error if the mapping does not hold an image
+     */
+    static TreeImage open(MappedFile mapping) {
+        TreeImage image;
+        const std::size_t size = mapping.size();
+        const auto* base = mapping.as<const char>();
+        Header header;
+        if (size < sizeof(Header)) throw std::runtime_error("not a tree image");
+        std::memcpy(&header, base, sizeof(Header));
+        if (std::memcmp(header.magic, Header{}.magic, sizeof(header.magic)) != 0) throw std::runtime_error("not a tree image");
+        if (header.nodes == 0 || header.nodes >= kNone || header.nodes > (size - sizeof(Header)) / sizeof(Entry) ||
+            header.textOffset != sizeof(Header) + header.nodes * sizeof(Entry) || header.textBytes > size - header.textOffset) {
+            throw damaged();
+        }
+        image.entries = reinterpret_cast<const Entry*>(base + sizeof(Header));
+        image.texts = base + header.textOffset;
+        image.nodes = header.nodes;
+        image.textBytes = header.textBytes;
+        image.mapping = std::move(mapping);
+        return image;
+    }
+
+    uint32_t root() const { return 0; }
+    bool isLeaf(uint32_t node) const { return entries[node].yes == kNone && entries[node].no == kNone; }
+
+    /**
+     * @brief the node a yes or no answer leads to from a question
+     * @throws std::runtime_error if the image points outside itself
+     */
+    uint32_t child(uint32_t node, bool yes) const {
+        uint32_t next = yes ? entries[node].yes : entries[node].no;
+        if (next >= nodes) throw damaged();
+        return next;
+    }
+
+    /**
+     * @brief a question's text, or the name of the animal guessed at a leaf
+     * @throws std::runtime_error if the image points outside itself
+     */
+    std::string_view text(uint32_t node) const {
+        const Entry& entry = entries[node];
+        if (entry.text > textBytes || entry.length > textBytes - entry.text) throw damaged();
+        return {texts + entry.text, entry.length};
+    }
+
+    std::size_t nodeCount() const { return nodes; }
+    int descriptor() const { return mapping.descriptor(); }
+};
@@ -0,0 +1,167 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LatencyHistogram.h"
+#include "LiveTree.h"
+#include "PerfCounters.h"
+
+static constexpr int kAnimals = 200000;
+static constexpr int kReaders = 3;
+static constexpr auto kPhase = std::chrono::milliseconds(1500);
+static constexpr auto kReloadInterval = std::chrono::milliseconds(250);
+
+/**
+ * @brief builds a tree of kAnimals random animals whose names all end in the given tag, and returns it as written by save()
+ */
+static std::string buildTree(char tag, unsigned seed) {
+    AnimalTree tree;
+    std::mt19937 rng(seed);
+    for (int i = 0; i < kAnimals; ++i) {
+        Node* leaf = tree.getRoot();
+        while (!leaf->isLeaf()) leaf = (rng() & 1) ? leaf->yes.get() : leaf->no.get();
+        tree.learn(leaf, "Animal " + std::to_string(i) + " " + tag, "Question " + std::to_string(i % 1024) + "?", rng() & 1);
+    }
+    // the two starting animals are renamed too, so every leaf carries the tag
+    std::ostringstream out;
+    tree.save(out);
+    std::string text = out.str();
+    for (const char* original : {"\nA Dog\n", "\nA Snake\n"}) {
+        std::string name = original;
+        auto at = text.find(name);
+        if (at != std::string::npos) text.replace(at, name.size(), name.substr(0, name.size() - 1) + " " + tag + "\n");
+    }
+    return text;
+}
+
+/**
+ * @struct ReaderTotals
+ * @brief what the reader threads did during one phase
+ */
+struct ReaderTotals {
+    uint64_t sessions = 0;
+    uint64_t steps = 0;
+    uint64_t wrongVersion = 0;
+};
+
+/**
+ * @brief runs kReaders threads that play sessions back to back for one phase, each walking from the root to a random leaf,
+ * while reload() is called every kReloadInterval on the calling thread; prints throughput and the latency of whole sessions
+ * @param play plays one session with the given random generator and returns the number of steps, or -1 if it saw a tree from the wrong version
+ */
+template <typename Play, typename Reload>
+static ReaderTotals runPhase(const std::string& label, Play play, Reload reload) {
+    std::atomic<bool> stop{false};
+    std::vector<LatencyHistogram> latencies(kReaders);
+    std::vector<ReaderTotals> totals(kReaders);
+    std::vector<std::thread> readers;
+    PerfCounters counters;
+    counters.start();
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < kReaders; ++r) {
+        readers.emplace_back([&, r] {
+            std::mt19937 rng(100 + r);
+            while (!stop.load(std::memory_order_relaxed)) {
+                ScopedLatency timer(latencies[r]);
+                int steps = play(rng);
+                ++totals[r].sessions;
+                if (steps < 0) ++totals[r].wrongVersion;
+                else totals[r].steps += static_cast<uint64_t>(steps);
+            }
+        });
+    }
+    int reloads = 0;
+    for (auto next = begin + kReloadInterval; next < begin + kPhase; next += kReloadInterval) {
+        std::this_thread::sleep_until(next);
+        reloads += reload();
+    }
+    std::this_thread::sleep_until(begin + kPhase);
+    stop = true;
+    for (auto& reader : readers) reader.join();
+    counters.stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    ReaderTotals total;
+    LatencyHistogram combined;
+    for (int r = 0; r < kReaders; ++r) {
+        total.sessions += totals[r].sessions;
+        total.steps += totals[r].steps;
+        total.wrongVersion += totals[r].wrongVersion;
+        combined.merge(latencies[r]);
+    }
+    std::cout << label << ": " << reloads << " reloads, " << static_cast<double>(total.steps) / seconds / 1e6 << " M traversal steps/s, "
+              << total.wrongVersion << " sessions saw the wrong version\n";
+    counters.print(std::cout);
+    combined.printPercentiles(std::cout, "  session");
+    return total;
+}
+
+int main() {
+    std::cout << "building two trees of " << kAnimals << " animals\n";
+    const std::string trees[2] = {buildTree('a', 1), buildTree('b', 2)};
+
+    LiveTree live;
+    int next = 0;
+    // version 2 is tree a, and from then on even versions hold tree a and odd ones tree b
+    std::istringstream first(trees[next++]);
+    live.reload(first);
+
+    auto playLive = [&](std::mt19937& rng) {
+        auto version = live.acquire();
+        const Node* current = version->tree.getRoot();
+        int steps = 0;
+        while (!current->isLeaf()) {
+            current = (rng() & 1) ? current->yes.get() : current->no.get();
+            ++steps;
+        }
+        char expected = version->number % 2 == 0 ? 'a' : 'b';
+        return current->animal->getName().back() == expected ? steps : -1;
+    };
+    auto reloadLive = [&] {
+        std::istringstream in(trees[next++ % 2]);
+        return live.reload(in) ? 1 : 0;
+    };
+
+    uint64_t wrong = 0;
+    wrong += runPhase("atomic swap, no reloads", playLive, [] { return 0; }).wrongVersion;
+    wrong += runPhase("atomic swap, reloading", playLive, reloadLive).wrongVersion;
+    std::size_t stillRetired = live.collect();
+    std::cout << "  retired versions still held after the phase: " << stillRetired << "\n";
+
+    // the alternative without versions: one tree behind a reader-writer lock, replaced while every session waits
+    AnimalTree locked;
+    std::shared_mutex lock;
+    {
+        std::istringstream in(trees[0]);
+        locked.load(in);
+    }
+    char lockedTag = 'a';
+    auto playLocked = [&](std::mt19937& rng) {
+        std::shared_lock<std::shared_mutex> reading(lock);
+        const Node* current = locked.getRoot();
+        int steps = 0;
+        while (!current->isLeaf()) {
+            current = (rng() & 1) ? current->yes.get() : current->no.get();
+            ++steps;
+        }
+        return current->animal->getName().back() == lockedTag ? steps : -1;
+    };
+    int lockedNext = 1;
+    auto reloadLocked = [&] {
+        std::unique_lock<std::shared_mutex> writing(lock);
+        std::istringstream in(trees[lockedNext % 2]);
+        bool loaded = locked.load(in);
+        lockedTag = lockedNext++ % 2 == 0 ? 'a' : 'b';
+        return loaded ? 1 : 0;
+    };
+    wrong += runPhase("reader-writer lock, reloading", playLocked, reloadLocked).wrongVersion;
+    return wrong == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
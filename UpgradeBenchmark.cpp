@@ -0,0 +1,269 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "AnimalServer.h"
+#include "LatencyHistogram.h"
+
+static constexpr int kAnimals = 200000;
+static constexpr int kPlayers = 2000;
+// enough answers that their replies overflow the socket and wait in the server's output buffer
+static constexpr int kAheadAnswers = 20000;
+
+/**
+ * @class Player
+ * @brief one connected player, which keeps its own copy of where it is in the tree to check every question the server sends
+ */
+class Player {
+    int fd = -1;
+    const Node* at = nullptr;
+    std::string received;
+    const AnimalTree* tree = nullptr;
+    std::vector<bool> ahead;
+
+    std::string expectedPrompt() const {
+        if (at->isLeaf()) return "Is it a " + at->animal->getName() + "? (yes/no)";
+        return tree->questionText(at) + " (yes/no)";
+    }
+
+    // reads until a whole question has arrived, and checks it is the one expected here
+    bool readPrompt() {
+        while (true) {
+            auto end = received.find("(yes/no)\n");
+            if (end != std::string::npos) {
+                std::size_t start = received.rfind('\n', end);
+                std::string prompt = received.substr(start == std::string::npos ? 0 : start + 1, end + 8 - (start == std::string::npos ? 0 : start + 1));
+                received.erase(0, end + 9);
+                return prompt == expectedPrompt();
+            }
+            char buffer[1024];
+            ssize_t got = ::read(fd, buffer, sizeof(buffer));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            received.append(buffer, static_cast<std::size_t>(got));
+        }
+    }
+
+public:
+    Player(const std::string& socketPath, const AnimalTree& tree) : tree(&tree) {
+        fd = connectUnix(socketPath);
+        at = tree.getRoot();
+    }
+    Player(Player&& other) noexcept
+        : fd(std::exchange(other.fd, -1)), at(other.at), received(std::move(other.received)), tree(other.tree), ahead(std::move(other.ahead)) {}
+    ~Player() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool connected() { return fd >= 0 && readPrompt(); }
+
+    /**
+     * @brief answers the current question at random, and checks the next one
+     * @return false if the server sent the wrong question or the connection was lost
+     */
+    bool answer(std::mt19937& rng) {
+        bool yes = rng() & 1;
+        std::string line = yes ? "yes\n" : "no\n";
+        if (::send(fd, line.data(), line.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(line.size())) return false;
+        at = at->isLeaf() ? tree->getRoot() : (yes ? at->yes.get() : at->no.get());
+        return readPrompt();
+    }
+
+    /**
+     * @brief waits until the server hangs up, as it does on a player who stays quiet too long
+     * @return true if the server said why before hanging up
+     */
+    bool droppedForIdling() {
+        char buffer[1024];
+        ssize_t got;
+        while ((got = ::read(fd, buffer, sizeof(buffer))) != 0) {
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) return false;
+            received.append(buffer, static_cast<std::size_t>(got));
+        }
+        return received.find("idle too long") != std::string::npos;
+    }
+
+    /**
+     * @brief sends answers without reading any of the replies, like a player whose connection has stalled
+     */
+    bool answerAhead(std::mt19937& rng, int count) {
+        std::string lines;
+        for (int i = 0; i < count; ++i) {
+            ahead.push_back(rng() & 1);
+            lines += ahead.back() ? "yes\n" : "no\n";
+        }
+        return ::send(fd, lines.data(), lines.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(lines.size());
+    }
+
+    /**
+     * @brief reads and checks the replies to every answer sent ahead
+     * @return the number of them that arrived as expected
+     */
+    std::size_t catchUp() {
+        std::size_t matched = 0;
+        for (bool yes : ahead) {
+            at = at->isLeaf() ? tree->getRoot() : (yes ? at->yes.get() : at->no.get());
+            if (!readPrompt()) break;
+            ++matched;
+        }
+        ahead.clear();
+        return matched;
+    }
+};
+
+/**
+ * @brief starts a server process on socketPath, either fresh with the given tree or by taking over from the one running there
+ * @param idleTimeout how long the server lets a player stay quiet, or zero for its default
+ */
+static pid_t startServer(const std::string& socketPath, const std::string* treeText, std::chrono::milliseconds idleTimeout = {}) {
+    // the child flushes std::cout, so whatever the parent has buffered must go out first or it is printed twice
+    std::cout << std::flush;
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+    int status = EXIT_SUCCESS;
+    try {
+        std::signal(SIGTERM, AnimalServer::requestStop);
+        if (treeText) {
+            std::istringstream in(*treeText);
+            AnimalServer server(socketPath, in);
+            if (idleTimeout.count() > 0) server.setIdleTimeout(idleTimeout);
+            server.run();
+        } else {
+            AnimalServer server = AnimalServer::takeOver(socketPath);
+            const auto& stats = server.handoffStats();
+            std::cout << "new server took over " << stats.sessions << " sessions: tree mapped in " << stats.treeMapMs
+                      << " ms while the old server kept playing, then players waited " << stats.pauseMs << " ms\n"
+                      << std::flush;
+            server.run();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "server: " << e.what() << "\n";
+        status = EXIT_FAILURE;
+    }
+    _exit(status);
+}
+
+int main() {
+    rlimit files{};
+    getrlimit(RLIMIT_NOFILE, &files);
+    if (files.rlim_cur < 3 * kPlayers) {
+        files.rlim_cur = std::min<rlim_t>(files.rlim_max, 3 * kPlayers);
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    AnimalTree tree;
+    std::mt19937 rng(42);
+    for (int i = 0; i < kAnimals; ++i) {
+        Node* leaf = tree.getRoot();
+        while (!leaf->isLeaf()) leaf = (rng() & 1) ? leaf->yes.get() : leaf->no.get();
+        tree.learn(leaf, "Animal " + std::to_string(i), "Question " + std::to_string(i % 1024) + "?", rng() & 1);
+    }
+    std::ostringstream saved;
+    tree.save(saved);
+    const std::string treeText = saved.str();
+
+    const std::string socketPath = "/tmp/animal-upgrade-" + std::to_string(getpid()) + ".sock";
+    pid_t oldServer = startServer(socketPath, &treeText);
+    while (!AnimalServer::running(socketPath)) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    std::vector<Player> players;
+    std::size_t lost = 0;
+    for (int i = 0; i < kPlayers; ++i) {
+        players.emplace_back(socketPath, tree);
+        if (!players.back().connected()) ++lost;
+    }
+    // get everyone partway down the tree, so the sessions handed over are in the middle of their games
+    for (auto& player : players) {
+        for (int a = 0, n = static_cast<int>(rng() % 12); a < n; ++a) lost += !player.answer(rng);
+    }
+
+    // one player stops reading while its replies pile up; nobody else may wait on it, and its replies must survive the upgrade
+    Player stalled(socketPath, tree);
+    bool stalledSent = stalled.connected() && stalled.answerAhead(rng, kAheadAnswers);
+
+    // keep playing through the upgrade, one answer per player per round, timing every answer
+    LatencyHistogram during, after;
+    pid_t newServer = startServer(socketPath, nullptr);
+    int oldStatus = 0;
+    bool oldExited = false;
+    int roundsAfter = 0;
+    for (int round = 0; roundsAfter < 3; ++round) {
+        for (auto& player : players) {
+            ScopedLatency timer(oldExited ? after : during);
+            lost += !player.answer(rng);
+        }
+        if (!oldExited && waitpid(oldServer, &oldStatus, WNOHANG) == oldServer) oldExited = true;
+        if (oldExited) ++roundsAfter;
+        if (round > 10000) break;
+    }
+    during.printPercentiles(std::cout, "answers while upgrading");
+    after.printPercentiles(std::cout, "answers on the new server");
+    std::cout << "old server exited: " << (oldExited && WIFEXITED(oldStatus) && WEXITSTATUS(oldStatus) == 0 ? "cleanly" : "NO") << "\n";
+
+    std::size_t caughtUp = stalledSent ? stalled.catchUp() : 0;
+    std::cout << "a player that stopped reading for " << kAheadAnswers << " replies got " << caughtUp << " of them after the upgrade\n";
+
+    // a player arriving after the upgrade is served by the new process on the same socket
+    Player late(socketPath, tree);
+    bool lateServed = late.connected() && late.answer(rng);
+    std::cout << kPlayers << " players, " << lost << " lost or answered wrongly; a new player after the upgrade is " << (lateServed ? "" : "NOT ")
+              << "served\n";
+
+    kill(newServer, SIGTERM);
+    int newStatus = 0;
+    waitpid(newServer, &newStatus, 0);
+    bool clean = oldExited && WIFEXITED(oldStatus) && WEXITSTATUS(oldStatus) == 0 && WIFEXITED(newStatus) && WEXITSTATUS(newStatus) == 0;
+
+    // a server with no players at all takes the upgrade the same way: the new process connects while nothing else is being polled
+    const std::string idlePath = socketPath + ".idle";
+    pid_t idleOld = startServer(idlePath, &treeText);
+    while (!AnimalServer::running(idlePath)) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    pid_t idleNew = startServer(idlePath, nullptr);
+    int idleOldStatus = 0, idleNewStatus = 0;
+    waitpid(idleOld, &idleOldStatus, 0);
+    Player idlePlayer(idlePath, tree);
+    bool idleServed = idlePlayer.connected() && idlePlayer.answer(rng);
+    kill(idleNew, SIGTERM);
+    waitpid(idleNew, &idleNewStatus, 0);
+    bool idleClean = WIFEXITED(idleOldStatus) && WEXITSTATUS(idleOldStatus) == 0 && WIFEXITED(idleNewStatus) && WEXITSTATUS(idleNewStatus) == 0;
+    std::cout << "upgrading a server with no players: " << (idleServed && idleClean ? "" : "NOT ") << "clean, and the new server "
+              << (idleServed ? "serves" : "does NOT serve") << " a player arriving afterwards\n";
+
+    // a player who stops answering is dropped once the idle timeout has passed, while one who keeps answering stays
+    const std::string timeoutPath = socketPath + ".timeout";
+    const auto timeout = std::chrono::milliseconds(300);
+    pid_t timeoutServer = startServer(timeoutPath, &treeText, timeout);
+    while (!AnimalServer::running(timeoutPath)) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    Player quiet(timeoutPath, tree), busy(timeoutPath, tree);
+    auto connected = std::chrono::steady_clock::now();
+    bool busyServed = quiet.connected() && busy.connected();
+    std::thread answering([&] {
+        std::mt19937 busyRng(91);
+        for (int i = 0; i < 12 && busyServed; ++i) {
+            std::this_thread::sleep_for(timeout / 3);
+            busyServed = busy.answer(busyRng);
+        }
+    });
+    bool quietDropped = quiet.droppedForIdling();
+    double droppedAfter = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - connected).count();
+    answering.join();
+    kill(timeoutServer, SIGTERM);
+    int timeoutStatus = 0;
+    waitpid(timeoutServer, &timeoutStatus, 0);
+    bool timedOut = quietDropped && busyServed && droppedAfter >= static_cast<double>(timeout.count()) && droppedAfter < 3.0 * timeout.count() &&
+                    WIFEXITED(timeoutStatus) && WEXITSTATUS(timeoutStatus) == 0;
+    std::cout << "with a " << timeout.count() << " ms idle timeout, a quiet player was " << (quietDropped ? "" : "NOT ") << "dropped after "
+              << droppedAfter << " ms, and a player answering every " << timeout.count() / 3 << " ms was " << (busyServed ? "kept" : "NOT kept") << "\n";
+
+    bool caughtUpAll = caughtUp == static_cast<std::size_t>(kAheadAnswers);
+    return lost == 0 && lateServed && clean && caughtUpAll && idleServed && idleClean && timedOut ? EXIT_SUCCESS : EXIT_FAILURE;
+}